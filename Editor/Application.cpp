@@ -4,21 +4,25 @@
  * SPDX-License-Identifier: GPL-3.0-only
  */
 
+#include <AK/LexicalPath.h>
 #include <AK/MemoryStream.h>
 #include <AK/String.h>
 #include <Editor/Application.h>
+#include <Editor/WorldLoader.h>
 #include <GL/glew.h>
 #include <imgui/imgui.h>
 #include <LibCore/File.h>
 #include <LibGfx/PNGLoader.h>
 #include <LibTerraria/World.h>
 #include <LibTerraria/Model.h>
+#include <math.h>
 #include <nfd.h>
 
-static const char* s_tool_names[] = {"Select", "Place Object", "Paint"};
+static const char* s_tool_names[] = {"Select", "Place Object", "Paint", "Paint Wall", "Liquid"};
+static const char* s_liquid_names[] = {"Water", "Lava", "Honey", "Shimmer"};
 
-Application::Application(RefPtr<Terraria::World> world)
-        : m_current_world(world)
+Application::Application()
+        : m_tile_map_renderer(Terraria::s_total_tiles)
 {
     constexpr StringView content_directory = "Content";
     if (!Core::File::exists(content_directory) || !Core::File::is_directory(content_directory))
@@ -32,147 +36,401 @@ Application::Application(RefPtr<Terraria::World> world)
     load_all_tile_texture_sheets();
     load_all_item_texture_sheets();
 
-    if (m_current_world)
-        frame_implicit_tiles();
+    if (!Object::load_all_objects("Objects.txt"))
+    {
+        warnln("The object catalog could not be loaded, make sure Objects.txt is next to the Content directory.");
+        VERIFY_NOT_REACHED();
+    }
 
     m_selected_object = &Object::all_objects().at(0);
 }
 
+void Application::open_world(NonnullRefPtr<Terraria::World> world, String name)
+{
+    m_tabs.append(make<WorldTab>(move(world), move(name), m_next_tab_id++));
+    switch_to_tab(&m_tabs.last());
+
+    // TODO: Properly frame the edges of the world (starting at 1 and subtracting 1 shouldn't really happen)
+    auto& tab = *m_current_tab;
+    tab.thread->submit(EditCommand::frame_region(1, 1, tab.tiles->width() - 1, tab.tiles->height() - 1));
+}
+
+void Application::switch_to_tab(WorldTab* tab)
+{
+    if (m_current_tab == tab)
+        return;
+
+    // A stroke belongs to the world it was painted in, and nothing else will be painted there for a while
+    if (m_current_tab)
+    {
+        submit_stroke();
+        m_current_tab->thread->compress_soon();
+    }
+    m_stroke_end = {};
+
+    m_current_tab = tab;
+    m_tile_map_renderer.forget_tiles();
+
+    // The tile property checkboxes mirror whatever is selected, so they have to follow us into the other world
+    if (m_current_tab)
+        set_selected_tile(m_current_tab->selected_tile_x, m_current_tab->selected_tile_y);
+}
+
+void Application::close_tab(size_t index)
+{
+    auto* tab = &m_tabs.at(index);
+    if (m_current_tab == tab)
+    {
+        m_current_tab = nullptr;
+        m_stroke_tiles.clear();
+        m_stroke_end = {};
+        m_tile_map_renderer.forget_tiles();
+    }
+
+    m_tabs.remove(index);
+
+    if (!m_current_tab && !m_tabs.is_empty())
+        switch_to_tab(&m_tabs.at(min(index, m_tabs.size() - 1)));
+}
+
 void Application::process_event(SDL_Event* event)
 {
     if (event->type == SDL_MOUSEMOTION)
     {
-        auto last_hovered_x = m_hovered_visual_tile_x;
-        auto last_hovered_y = m_hovered_visual_tile_y;
-        m_hovered_visual_tile_x = ((event->motion.x - 1) | (m_tile_visual_size_x - 1)) + 1;
-        m_hovered_visual_tile_y = ((event->motion.y - 1) | (m_tile_visual_size_y - 1)) + 1;
+        m_mouse_x = event->motion.x;
+        m_mouse_y = event->motion.y;
+    }
+    else if (event->type == SDL_MOUSEBUTTONDOWN || event->type == SDL_MOUSEBUTTONUP)
+    {
+        m_mouse_x = event->button.x;
+        m_mouse_y = event->button.y;
+    }
+    else if (event->type == SDL_KEYDOWN || event->type == SDL_KEYUP)
+    {
+        // Already includes (or leaves out) the key itself, if it's a modifier
+        m_key_modifiers = event->key.keysym.mod;
+    }
+
+    if (!m_current_tab)
+        return;
+
+    auto& tab = *m_current_tab;
+    auto& camera = tab.camera;
+    auto is_over_ui = []
+    {
+        return ImGui::IsWindowHovered(ImGuiHoveredFlags_AnyWindow | ImGuiHoveredFlags_ChildWindows |
+                                      ImGuiHoveredFlags_AllowWhenBlockedByPopup) || ImGui::IsAnyItemHovered();
+    };
+
+    if (event->type == SDL_MOUSEMOTION)
+    {
+        camera.drag_to(event->motion.x, event->motion.y, event->motion.timestamp / 1000.0f);
 
-        if (last_hovered_x != m_hovered_visual_tile_x || last_hovered_y != m_hovered_visual_tile_y)
+        auto last_hovered_x = m_hovered_tile_x;
+        auto last_hovered_y = m_hovered_tile_y;
+        update_hovered_tile(event->motion.x, event->motion.y);
+
+        if (last_hovered_x != m_hovered_tile_x || last_hovered_y != m_hovered_tile_y)
         {
-            if (m_paint_allow_drag)
-            {
-                if ((SDL_GetMouseState(nullptr, nullptr) & SDL_BUTTON(SDL_BUTTON_LEFT)) != 0)
-                {
-                    if (m_current_tool == Tool::Paint)
-                    {
-                        auto clicked_tile_x = (m_hovered_visual_tile_x / m_tile_visual_size_x) + m_offset_x - 1;
-                        auto clicked_tile_y = (m_hovered_visual_tile_y / m_tile_visual_size_y) + m_offset_y - 1;
-                        paint_tile(clicked_tile_x, clicked_tile_y);
-                    }
-                }
-            }
+            if (m_paint_allow_drag && m_stroke_end.has_value())
+                continue_stroke(m_hovered_tile_x, m_hovered_tile_y);
         }
     }
     else if (event->type == SDL_MOUSEBUTTONDOWN)
     {
-        if (!ImGui::IsWindowHovered(ImGuiHoveredFlags_AnyWindow | ImGuiHoveredFlags_ChildWindows |
-                                    ImGuiHoveredFlags_AllowWhenBlockedByPopup) && !ImGui::IsAnyItemHovered())
+        if (!is_over_ui())
         {
             if (event->button.button == SDL_BUTTON_LEFT)
             {
-                auto clicked_tile_x = (m_hovered_visual_tile_x / m_tile_visual_size_x) + m_offset_x - 1;
-                auto clicked_tile_y = (m_hovered_visual_tile_y / m_tile_visual_size_y) + m_offset_y - 1;
-
                 switch (m_current_tool)
                 {
                     case Tool::Select:
-                        set_selected_tile(clicked_tile_x, clicked_tile_y);
+                        set_selected_tile(m_hovered_tile_x, m_hovered_tile_y);
+                        if (tab.wires)
+                            select_wire_network_at(m_hovered_tile_x, m_hovered_tile_y);
                         break;
                     case Tool::PlaceObject:
-                    {
-                        for (auto x = 0; x < m_selected_object->width(); x++)
-                        {
-                            for (auto y = 0; y < m_selected_object->height(); y++)
-                            {
-                                auto tile = m_selected_object->tiles().at(m_selected_object->index_for_position(x, y));
-                                if (m_selected_object->style_offset_x().has_value())
-                                    *tile.block()->frame_x() +=
-                                            *m_selected_object->style_offset_x() * m_selected_object_style_x;
-
-                                if (m_selected_object->style_offset_y().has_value())
-                                    *tile.block()->frame_y() +=
-                                            *m_selected_object->style_offset_y() * m_selected_object_style_y;
-                                m_current_world->tile_map()->at(clicked_tile_x + x + 1, clicked_tile_y + y + 1) = move(
-                                        tile);
-                            }
-                        }
-
-                        auto start_frame_x = clicked_tile_x - 2;
-                        auto start_frame_y = clicked_tile_y - 2;
-
-                        frame_region(start_frame_x, start_frame_y, clicked_tile_x + m_selected_object->width() + 2,
-                                     clicked_tile_y + m_selected_object->height() + 2);
+                        tab.thread->submit(EditCommand::place_object(m_hovered_tile_x, m_hovered_tile_y,
+                                                                     *m_selected_object, m_selected_object_style_x,
+                                                                     m_selected_object_style_y));
                         break;
-                    }
                     case Tool::Paint:
-                        paint_tile(clicked_tile_x, clicked_tile_y);
+                    case Tool::PaintWall:
+                        begin_stroke(m_hovered_tile_x, m_hovered_tile_y);
+                        break;
+                    case Tool::Liquid:
+                        if (m_liquid_fill_basin)
+                            tab.thread->submit(EditCommand::fill_liquid_basin(m_hovered_tile_x, m_hovered_tile_y,
+                                                                              liquid_to_fill()));
+                        else
+                            m_liquid_region_start = Gfx::IntPoint(m_hovered_tile_x, m_hovered_tile_y);
                         break;
                 }
             }
+            else if (event->button.button == SDL_BUTTON_MIDDLE)
+            {
+                camera.begin_drag(event->button.x, event->button.y, event->button.timestamp / 1000.0f);
+            }
+        }
+    }
+    else if (event->type == SDL_MOUSEBUTTONUP)
+    {
+        // Always let go, even over a window, otherwise we'd never stop dragging
+        if (event->button.button == SDL_BUTTON_MIDDLE)
+            camera.end_drag(event->button.timestamp / 1000.0f);
+
+        if (event->button.button == SDL_BUTTON_LEFT)
+            m_stroke_end = {};
+
+        if (event->button.button == SDL_BUTTON_LEFT && m_liquid_region_start.has_value())
+        {
+            auto start = *m_liquid_region_start;
+            tab.thread->submit(EditCommand::fill_liquid(min(start.x(), m_hovered_tile_x),
+                                                        min(start.y(), m_hovered_tile_y),
+                                                        max(start.x(), m_hovered_tile_x) + 1,
+                                                        max(start.y(), m_hovered_tile_y) + 1, liquid_to_fill()));
+            m_liquid_region_start = {};
         }
     }
     else if (event->type == SDL_MOUSEWHEEL)
     {
-        if (!ImGui::IsWindowHovered(ImGuiHoveredFlags_AnyWindow | ImGuiHoveredFlags_ChildWindows |
-                                    ImGuiHoveredFlags_AllowWhenBlockedByPopup) && !ImGui::IsAnyItemHovered())
+        if (!is_over_ui())
         {
-            if ((SDL_GetModState() & KMOD_CTRL) != 0)
+            if ((m_key_modifiers & KMOD_CTRL) != 0)
             {
-                // FIXME: Once we can handle non powers of two here, allow more refined zooming
-                // The problem is that our hover/selection box isn't being properly aligned, probably because
-                // the math is not meant for non powers of two.
-                if (event->wheel.y > 0)
-                {
-                    m_tile_visual_size_x += m_tile_visual_size_x;
-                    m_tile_visual_size_y += m_tile_visual_size_y;
-                }
-                else
-                {
-                    m_tile_visual_size_x -= m_tile_visual_size_x / 2;
-                    m_tile_visual_size_y -= m_tile_visual_size_y / 2;
-                }
+                camera.zoom_at(m_mouse_x, m_mouse_y, powf(1.1f, event->wheel.y));
+                update_hovered_tile(m_mouse_x, m_mouse_y);
             }
             else
             {
-                constexpr int offset_move_scale = 4;
-                if ((SDL_GetModState() & KMOD_SHIFT) != 0)
-                    m_offset_x -= event->wheel.y * offset_move_scale;
+                constexpr float tiles_per_scroll = 4.0f;
+                if ((m_key_modifiers & KMOD_SHIFT) != 0)
+                    camera.glide_by_tiles(-event->wheel.y * tiles_per_scroll, 0);
                 else
-                    m_offset_y -= event->wheel.y * offset_move_scale;
+                    camera.glide_by_tiles(0, -event->wheel.y * tiles_per_scroll);
             }
         }
     }
 }
 
-void Application::paint_tile(u16 x, u16 y)
+void Application::update_hovered_tile(float screen_x, float screen_y)
+{
+    auto tile = m_current_tab->camera.screen_to_tile(screen_x, screen_y);
+    m_hovered_tile_x = static_cast<int>(floorf(tile.x()));
+    m_hovered_tile_y = static_cast<int>(floorf(tile.y()));
+}
+
+void Application::begin_stroke(int x, int y)
 {
-    m_current_world->tile_map()->at(x, y) = m_tile_to_paint;
-    frame_region(x - 2, y - 2, x + 2, y + 2);
+    m_stroke_end = Gfx::IntPoint(x, y);
+    if (m_current_tab->tiles->contains(x, y))
+        m_stroke_tiles.append({x, y});
+}
+
+void Application::continue_stroke(int x, int y)
+{
+    // Bresenham's line, leaving out where we started since that was painted last time
+    auto from = *m_stroke_end;
+    auto delta_x = abs(x - from.x());
+    auto delta_y = -abs(y - from.y());
+    auto step_x = from.x() < x ? 1 : -1;
+    auto step_y = from.y() < y ? 1 : -1;
+    auto error = delta_x + delta_y;
+    auto line_x = from.x();
+    auto line_y = from.y();
+    while (line_x != x || line_y != y)
+    {
+        auto doubled_error = 2 * error;
+        if (doubled_error >= delta_y)
+        {
+            error += delta_y;
+            line_x += step_x;
+        }
+        if (doubled_error <= delta_x)
+        {
+            error += delta_x;
+            line_y += step_y;
+        }
+
+        if (m_current_tab->tiles->contains(line_x, line_y))
+            m_stroke_tiles.append({line_x, line_y});
+    }
+
+    m_stroke_end = Gfx::IntPoint(x, y);
+}
+
+void Application::submit_stroke()
+{
+    if (m_stroke_tiles.is_empty())
+        return;
+
+    auto& thread = *m_current_tab->thread;
+    if (m_current_tool == Tool::PaintWall)
+        thread.submit(EditCommand::paint_walls(move(m_stroke_tiles), m_wall_to_paint));
+    else
+        thread.submit(EditCommand::paint_tiles(move(m_stroke_tiles), m_tile_to_paint));
+
+    m_stroke_tiles.clear();
+}
+
+u8 Application::liquid_to_fill() const
+{
+    return LiquidLayer::pack(static_cast<LiquidLayer::Type>(m_liquid_type), m_liquid_amount);
+}
+
+void Application::select_wire_network_at(int x, int y)
+{
+    auto& tab = *m_current_tab;
+    tab.wires->update();
+
+    size_t first_color = 0;
+    if (tab.selected_wire_network.has_value())
+    {
+        auto& selected = *tab.selected_wire_network;
+        auto network = tab.wires->network_at(x, y, selected.color);
+        if (network.has_value() && *network == selected.network)
+            first_color = static_cast<size_t>(selected.color) + 1;
+    }
+
+    for (size_t i = 0; i < wire_color_count; i++)
+    {
+        auto color = static_cast<WireColor>((first_color + i) % wire_color_count);
+        auto network = tab.wires->network_at(x, y, color);
+        if (network.has_value())
+        {
+            tab.selected_wire_network = WorldTab::SelectedWireNetwork{color, x, y, *network,
+                                                                      tab.wires->summarize(color, *network)};
+            return;
+        }
+    }
+
+    tab.selected_wire_network = {};
 }
 
 void Application::draw()
 {
     draw_main_menu_bar();
+    draw_world_tabs();
+
+    if (!m_current_tab)
+        return;
+
+    auto& tab = *m_current_tab;
+
+    // However many mouse events came in this frame, the stroke is one command
+    submit_stroke();
 
-    if (m_current_world)
+    bool selection_changed = false;
+    auto selected_chunk = tab.tiles->chunk_index_for_position(tab.selected_tile_x, tab.selected_tile_y);
+    tab.thread->update_view(*tab.tiles, *tab.walls, *tab.liquids, [&](auto chunk_index)
     {
-        draw_tile_map();
-        draw_selection_window();
+        tab.objects.invalidate_chunk(chunk_index);
+        tab.render_cache.invalidate_chunk(chunk_index);
+        m_tile_map_renderer.invalidate_chunk(chunk_index);
+        if (tab.wires)
+            tab.wires->invalidate_chunk(chunk_index);
+        if (chunk_index == selected_chunk)
+            selection_changed = true;
+    });
+
+    if (selection_changed)
+        set_selected_tile(tab.selected_tile_x, tab.selected_tile_y);
+
+    if (tab.is_running_script)
+        finish_script();
+
+    auto& io = ImGui::GetIO();
+    tab.camera.set_viewport_size(io.DisplaySize.x, io.DisplaySize.y);
+    tab.camera.update(io.DeltaTime);
+
+    // The camera can glide along on its own, so what's under the mouse can change without it moving
+    update_hovered_tile(io.MousePos.x, io.MousePos.y);
+
+    if (tab.validator)
+        draw_validation_window();
+
+    if (m_show_export_window)
+        draw_export_window();
+
+    if (tab.diff)
+        draw_diff_window();
+
+    if (m_show_script_output)
+        draw_script_output_window();
+
+    if (m_show_chest_browser)
+        draw_chest_browser();
+
+    // The network we had selected might have been cut in two or joined onto another, so find it again from its tile
+    if (tab.wires && tab.wires->update() && tab.selected_wire_network.has_value())
+    {
+        auto& selected = *tab.selected_wire_network;
+        auto network = tab.wires->network_at(selected.x, selected.y, selected.color);
+        if (network.has_value())
+        {
+            selected.network = *network;
+            selected.summary = tab.wires->summarize(selected.color, *network);
+        }
+        else
+        {
+            tab.selected_wire_network = {};
+        }
     }
 
-    if (m_selected_chest)
+    draw_tile_map();
+    draw_selection_window();
+
+    if (tab.wires)
+        draw_wire_networks_window();
+
+    if (tab.selected_chest)
         draw_selected_chest_window();
 
-    if (m_selected_sign)
+    if (tab.selected_sign)
         draw_selected_sign_window();
 }
 
+void Application::draw_world_tabs()
+{
+    if (m_tabs.is_empty())
+        return;
+
+    if (ImGui::Begin("Worlds", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        if (ImGui::BeginTabBar("World Tabs", ImGuiTabBarFlags_AutoSelectNewTabs | ImGuiTabBarFlags_FittingPolicyScroll))
+        {
+            Optional<size_t> tab_to_close;
+            for (size_t i = 0; i < m_tabs.size(); i++)
+            {
+                auto& tab = m_tabs.at(i);
+                bool open = true;
+                if (ImGui::BeginTabItem(tab.label.characters(), &open))
+                {
+                    switch_to_tab(&tab);
+                    ImGui::EndTabItem();
+                }
+
+                if (!open)
+                    tab_to_close = i;
+            }
+
+            ImGui::EndTabBar();
+
+            if (tab_to_close.has_value())
+                close_tab(*tab_to_close);
+        }
+    }
+
+    ImGui::End();
+}
+
 void Application::set_selected_tile(int x, int y)
 {
-    m_selected_tile_x = x;
-    m_selected_tile_y = y;
+    auto& tab = *m_current_tab;
+    tab.selected_tile_x = x;
+    tab.selected_tile_y = y;
 
-    auto& tile = m_current_world->tile_map()->at(x, y);
+    auto tile = tab.tiles->tile_at(x, y);
     m_tile_properties_has_red_wire = tile.has_red_wire();
     m_tile_properties_has_blue_wire = tile.has_blue_wire();
     m_tile_properties_has_green_wire = tile.has_green_wire();
@@ -189,35 +447,298 @@ void Application::set_selected_tile(int x, int y)
             m_selected_frame_y = *tile.block()->frame_y();
     }
 
-    bool found_chest;
-    for (auto& kv : m_current_world->chests())
+    tab.selected_object = tab.objects.object_at(x, y);
+
+    // A script is still busy with the chests and signs, we'll look again once it's done
+    if (tab.is_running_script)
+        return;
+
+    bool found_chest = false;
+    for (auto& kv : tab.world->chests())
     {
-        if (kv.value.position().x() == m_selected_tile_x && kv.value.position().y() == m_selected_tile_y)
+        if (kv.value.position().x() == x && kv.value.position().y() == y)
         {
-            m_selected_chest = &kv.value;
-            m_selected_chest->name().copy_characters_to_buffer(m_selected_chest_name, sizeof(m_selected_chest_name));
+            tab.selected_chest = &kv.value;
+            tab.selected_chest->name().copy_characters_to_buffer(tab.selected_chest_name,
+                                                                 sizeof(tab.selected_chest_name));
             found_chest = true;
             break;
         }
     }
 
     if (!found_chest)
-        m_selected_chest = nullptr;
+        tab.selected_chest = nullptr;
 
-    bool found_sign;
-    for (auto& kv : m_current_world->signs())
+    bool found_sign = false;
+    for (auto& kv : tab.world->signs())
     {
-        if (kv.value.position().x() == m_selected_tile_x && kv.value.position().y() == m_selected_tile_y)
+        if (kv.value.position().x() == x && kv.value.position().y() == y)
         {
-            m_selected_sign = &kv.value;
-            m_selected_sign->text().copy_characters_to_buffer(m_selected_sign_text, sizeof(m_selected_sign_text));
+            tab.selected_sign = &kv.value;
+            tab.selected_sign->text().copy_characters_to_buffer(tab.selected_sign_text,
+                                                                sizeof(tab.selected_sign_text));
             found_sign = true;
             break;
         }
     }
 
     if (!found_sign)
-        m_selected_sign = nullptr;
+        tab.selected_sign = nullptr;
+}
+
+void Application::jump_to_tile(int x, int y)
+{
+    m_current_tab->camera.center_on(x + 0.5f, y + 0.5f);
+    set_selected_tile(x, y);
+}
+
+void Application::draw_validation_window()
+{
+    auto& tab = *m_current_tab;
+    auto& validator = *tab.validator;
+
+    bool open = true;
+    if (ImGui::Begin("Validation", &open))
+    {
+        if (!validator.is_finished())
+        {
+            ImGui::Text("Validating...");
+            ImGui::ProgressBar(static_cast<float>(validator.chunks_validated()) /
+                               static_cast<float>(validator.chunk_count()));
+        }
+        else
+        {
+            ImGui::Text("%zu issues found", validator.issues().size());
+            if (validator.unchecked_tile_count() > 0)
+            {
+                ImGui::TextDisabled("%zu tiles weren't checked, as their blocks or frames aren't in Objects.txt",
+                                    validator.unchecked_tile_count());
+            }
+
+            ImGui::Separator();
+
+            Optional<size_t> issue_to_jump_to;
+            ImGuiListClipper clipper;
+            clipper.Begin(validator.issues().size());
+            while (clipper.Step())
+            {
+                for (auto row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+                {
+                    auto& issue = validator.issues()[row];
+                    ImGui::PushID(row);
+                    if (ImGui::Selectable(String::formatted("{}, {}: {}", issue.x, issue.y,
+                                                            issue.description).characters()))
+                    {
+                        issue_to_jump_to = row;
+                    }
+                    ImGui::PopID();
+                }
+            }
+
+            if (issue_to_jump_to.has_value())
+            {
+                auto& issue = validator.issues()[*issue_to_jump_to];
+                jump_to_tile(issue.x, issue.y);
+            }
+        }
+    }
+
+    ImGui::End();
+
+    if (!open)
+        tab.validator = {};
+}
+
+void Application::compare_with_world(const String& path)
+{
+    auto& tab = *m_current_tab;
+
+    auto world_or_error = WorldLoader::load(path);
+    if (world_or_error.is_error())
+    {
+        warnln("{}", world_or_error.error());
+        return;
+    }
+
+    auto other_world = world_or_error.release_value();
+    auto other_tiles = ChunkedTileMap::create_from_world(*other_world);
+    auto other_walls = WallLayer::create_from_world(*other_world);
+    auto other_liquids = LiquidLayer::create_from_world(*other_world);
+
+    auto diff_or_error = WorldDiff::compute(*tab.world, *tab.tiles, *tab.walls, *tab.liquids, *other_world,
+                                            *other_tiles, *other_walls, *other_liquids);
+    if (diff_or_error.is_error())
+    {
+        warnln("Failed to compare worlds: {}", diff_or_error.error());
+        return;
+    }
+
+    tab.diff = make<WorldDiff>(diff_or_error.release_value());
+    tab.diff_name = LexicalPath(path).title();
+}
+
+void Application::run_script(const String& path)
+{
+    // Scripts can take as long as they like on the world thread, after everything we've already asked it to do. The
+    // chest and sign windows go away until it's done, see finish_script().
+    auto& tab = *m_current_tab;
+    tab.is_running_script = true;
+    tab.selected_chest = nullptr;
+    tab.selected_sign = nullptr;
+    tab.thread->submit(EditCommand::run_script(path));
+}
+
+void Application::finish_script()
+{
+    auto& tab = *m_current_tab;
+    auto output = tab.thread->take_script_output();
+    if (!output.has_value())
+        return;
+
+    tab.is_running_script = false;
+    m_script_output = output.release_value();
+    m_show_script_output = true;
+    tab.chests.invalidate();
+
+    // The script might have changed the selected chest or sign
+    set_selected_tile(tab.selected_tile_x, tab.selected_tile_y);
+}
+
+void Application::draw_script_output_window()
+{
+    if (ImGui::Begin("Script Output", &m_show_script_output))
+        ImGui::TextUnformatted(m_script_output.characters());
+
+    ImGui::End();
+}
+
+void Application::draw_diff_window()
+{
+    auto& tab = *m_current_tab;
+    auto& diff = *tab.diff;
+
+    bool open = true;
+    if (ImGui::Begin("Differences", &open))
+    {
+        ImGui::Text("Compared with %s", tab.diff_name.characters());
+        ImGui::Text("%zu tiles changed, in %zu chunks", diff.tile_changes().size(), diff.changed_chunk_count());
+        ImGui::Text("%zu walls and %zu liquids changed", diff.wall_changes().size(), diff.liquid_changes().size());
+
+        if (ImGui::Button("Save Patch"))
+        {
+            nfdchar_t* path;
+            nfdfilteritem_t filter[1] = {{"Tadapt Patch", "tdpatch"}};
+            if (NFD_SaveDialogN(&path, filter, 1, nullptr, "changes.tdpatch") == NFD_OKAY)
+            {
+                if (diff.save_patch(path))
+                    outln("Saved patch to {}", path);
+                NFD_FreePathN(path);
+            }
+        }
+
+        ImGui::Separator();
+
+        Optional<Gfx::IntPoint> position_to_jump_to;
+        if (ImGui::CollapsingHeader(String::formatted("{} Chests###Chests", diff.chest_changes().size()).characters()))
+        {
+            for (auto& change : diff.chest_changes())
+            {
+                ImGui::PushID(&change);
+                auto label = String::formatted("{}, {}: {}", change.x, change.y,
+                                               change.removed ? "Removed" : change.name.characters());
+                if (ImGui::Selectable(label.characters()))
+                    position_to_jump_to = Gfx::IntPoint(change.x, change.y);
+                ImGui::PopID();
+            }
+        }
+
+        if (ImGui::CollapsingHeader(String::formatted("{} Signs###Signs", diff.sign_changes().size()).characters()))
+        {
+            for (auto& change : diff.sign_changes())
+            {
+                ImGui::PushID(&change);
+                auto label = String::formatted("{}, {}: {}", change.x, change.y,
+                                               change.removed ? "Removed" : change.text.characters());
+                if (ImGui::Selectable(label.characters()))
+                    position_to_jump_to = Gfx::IntPoint(change.x, change.y);
+                ImGui::PopID();
+            }
+        }
+
+        if (position_to_jump_to.has_value())
+            jump_to_tile(position_to_jump_to->x(), position_to_jump_to->y());
+    }
+
+    ImGui::End();
+
+    if (!open)
+        tab.diff = {};
+}
+
+void Application::draw_export_window()
+{
+    auto& tab = *m_current_tab;
+
+    if (ImGui::Begin("Export Image", &m_show_export_window, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        if (tab.exporter && !tab.exporter->is_finished())
+        {
+            ImGui::Text("Exporting...");
+            ImGui::ProgressBar(static_cast<float>(tab.exporter->strips_written()) /
+                               static_cast<float>(tab.exporter->strip_count()));
+
+            if (ImGui::Button("Cancel"))
+                tab.exporter = {};
+        }
+        else
+        {
+            ImGui::InputInt4("Region", m_export_region);
+            if (ImGui::Button("Whole World"))
+            {
+                m_export_region[0] = 0;
+                m_export_region[1] = 0;
+                m_export_region[2] = tab.tiles->width();
+                m_export_region[3] = tab.tiles->height();
+            }
+
+            ImGui::SameLine();
+            if (ImGui::Button("Current View"))
+            {
+                auto visible_tiles = tab.camera.visible_tiles();
+                m_export_region[0] = visible_tiles.start_x;
+                m_export_region[1] = visible_tiles.start_y;
+                m_export_region[2] = visible_tiles.end_x - visible_tiles.start_x;
+                m_export_region[3] = visible_tiles.end_y - visible_tiles.start_y;
+            }
+
+            ImGui::SliderInt("Pixels Per Tile", &m_export_tile_size, 1, 16);
+            ImGui::Checkbox("Draw Wires", &m_export_draw_wires);
+
+            ImGui::Text("Image Size: %lldx%lld", static_cast<long long>(m_export_region[2]) * m_export_tile_size,
+                        static_cast<long long>(m_export_region[3]) * m_export_tile_size);
+
+            if (ImGui::Button("Export"))
+            {
+                nfdchar_t* path;
+                nfdfilteritem_t filter[1] = {{"PNG Image", "png"}};
+                if (NFD_SaveDialogN(&path, filter, 1, nullptr, "map.png") == NFD_OKAY)
+                {
+                    WorldExporter::Region region{m_export_region[0], m_export_region[1], m_export_region[2],
+                                                 m_export_region[3]};
+                    tab.exporter = make<WorldExporter>(tab.thread->tiles(), &tab.thread->walls(),
+                                                                       &tab.thread->liquids(), region,
+                                                                       m_export_tile_size, m_export_draw_wires);
+                    tab.exporter->start_export_png(path, *tab.thread);
+                    NFD_FreePathN(path);
+                }
+            }
+
+            if (tab.exporter)
+                ImGui::Text("%s", tab.exporter->succeeded() ? "Exported!" : "Export failed, see the log for why");
+        }
+    }
+
+    ImGui::End();
 }
 
 void Application::draw_main_menu_bar()
@@ -226,6 +747,9 @@ void Application::draw_main_menu_bar()
     {
         if (ImGui::BeginMenu("File"))
         {
+            // All of these look at (or change) the world's chests and signs, which a script might be busy with
+            auto can_touch_chests = m_current_tab != nullptr && !m_current_tab->is_running_script;
+
             if (ImGui::MenuItem("Open"))
             {
                 nfdchar_t* path;
@@ -233,41 +757,136 @@ void Application::draw_main_menu_bar()
                 auto file_dialog_result = NFD_OpenDialogN(&path, filter, 1, nullptr);
                 if (file_dialog_result == NFD_OKAY)
                 {
-                    m_current_world = nullptr;
+                    outln("Loading world");
+                    auto world_or_error = WorldLoader::load(path);
+                    if (world_or_error.is_error())
+                        warnln("{}", world_or_error.error());
+                    else
+                        open_world(world_or_error.release_value(), LexicalPath(path).title());
 
-                    auto file_or_error = Core::File::open(path, Core::OpenMode::ReadOnly);
+                    NFD_FreePathN(path);
+                }
+            }
+
+            if (ImGui::MenuItem("Compare With", nullptr, false, can_touch_chests))
+            {
+                nfdchar_t* path;
+                nfdfilteritem_t filter[1] = {{"World File", "wld"}};
+                if (NFD_OpenDialogN(&path, filter, 1, nullptr) == NFD_OKAY)
+                {
+                    compare_with_world(path);
+                    NFD_FreePathN(path);
+                }
+            }
 
-                    if (file_or_error.is_error())
+            if (ImGui::MenuItem("Apply Patch", nullptr, false, can_touch_chests))
+            {
+                nfdchar_t* path;
+                nfdfilteritem_t filter[1] = {{"Tadapt Patch", "tdpatch"}};
+                if (NFD_OpenDialogN(&path, filter, 1, nullptr) == NFD_OKAY)
+                {
+                    auto diff_or_error = WorldDiff::load_patch(path);
+                    NFD_FreePathN(path);
+
+                    auto& tab = *m_current_tab;
+                    if (diff_or_error.is_error())
+                    {
+                        warnln("Failed to load patch: {}", diff_or_error.error());
+                    }
+                    else if (diff_or_error.value().width() != tab.tiles->width() ||
+                             diff_or_error.value().height() != tab.tiles->height())
                     {
-                        warnln("Failed to open world file: {}", file_or_error.error());
+                        warnln("Can't apply a patch for a {}x{} world to a {}x{} world", diff_or_error.value().width(),
+                               diff_or_error.value().height(), tab.tiles->width(), tab.tiles->height());
                     }
                     else
                     {
-                        auto file_bytes = file_or_error.value()->read_all();
-                        auto bytes_stream = InputMemoryStream(file_bytes);
-
-                        outln("Loading world");
-                        m_current_world = Terraria::World::try_load_world(bytes_stream).release_value();
-                        set_selected_tile(0, 0);
-                        m_offset_x = 0;
-                        m_offset_y = 0;
-                        frame_implicit_tiles();
+                        auto unapplied_changes = diff_or_error.value().apply(*tab.world, *tab.thread);
+                        outln("Applied patch, {} changes couldn't be applied", unapplied_changes);
+                        tab.chests.invalidate();
+                        set_selected_tile(tab.selected_tile_x, tab.selected_tile_y);
                     }
+                }
+            }
 
+            if (ImGui::MenuItem("Run Script", nullptr, false, can_touch_chests))
+            {
+                nfdchar_t* path;
+                nfdfilteritem_t filter[1] = {{"Lua Script", "lua"}};
+                if (NFD_OpenDialogN(&path, filter, 1, nullptr) == NFD_OKAY)
+                {
+                    run_script(path);
                     NFD_FreePathN(path);
                 }
             }
+
+            ImGui::Separator();
+
+            if (ImGui::MenuItem("Validate", nullptr, false, can_touch_chests))
+            {
+                auto& tab = *m_current_tab;
+                tab.validator = {};
+                tab.validator = make<WorldValidator>(*tab.world, tab.thread->tiles(), *tab.thread);
+            }
+
+            if (ImGui::MenuItem("Wire Networks", nullptr, false, m_current_tab != nullptr))
+            {
+                auto& tab = *m_current_tab;
+                if (!tab.wires)
+                    tab.wires = make<WireNetworks>(*tab.tiles);
+            }
+
+            if (ImGui::MenuItem("Export Image", nullptr, false, m_current_tab != nullptr))
+            {
+                m_export_region[0] = 0;
+                m_export_region[1] = 0;
+                m_export_region[2] = m_current_tab->tiles->width();
+                m_export_region[3] = m_current_tab->tiles->height();
+                m_show_export_window = true;
+            }
+
+            if (ImGui::MenuItem("Close", nullptr, false, m_current_tab != nullptr))
+            {
+                for (size_t i = 0; i < m_tabs.size(); i++)
+                {
+                    if (&m_tabs.at(i) == m_current_tab)
+                    {
+                        close_tab(i);
+                        break;
+                    }
+                }
+            }
             ImGui::EndMenu();
         }
 
-        if (ImGui::BeginMenu("View"))
+        if (m_current_tab && ImGui::BeginMenu("View"))
         {
-            ImGui::DragInt("Offset X", &m_offset_x);
-            ImGui::DragInt("Offset Y", &m_offset_y);
-            ImGui::Separator();
-            ImGui::DragInt("Tile X Visual Size", &m_tile_visual_size_x);
-            ImGui::DragInt("Tile Y Visual Size", &m_tile_visual_size_y);
+            auto& camera = m_current_tab->camera;
+            float position[2] = {camera.x(), camera.y()};
+            if (ImGui::DragFloat2("Position", position))
+                camera.set_position(position[0], position[1]);
+
+            auto zoom = camera.zoom();
+            if (ImGui::SliderFloat("Zoom", &zoom, Camera::min_zoom, Camera::max_zoom, "%.1f px/tile",
+                                   ImGuiSliderFlags_Logarithmic))
+            {
+                camera.set_zoom(zoom);
+            }
+            ImGui::Checkbox("Show Walls", &m_show_walls);
+            ImGui::Checkbox("Show Liquids", &m_show_liquids);
+            ImGui::Checkbox("Chest Browser", &m_show_chest_browser);
+            if (ImGui::Checkbox("Draw Tiles on GPU", &m_draw_tile_map_on_gpu) && m_draw_tile_map_on_gpu &&
+                !m_tile_map_renderer.is_initialized())
+            {
+                m_render_thread->run_and_wait([&]
+                {
+                    m_draw_tile_map_on_gpu = m_tile_map_renderer.initialize();
+                });
+            }
             // TODO: Customizable wire alpha
+            ImGui::Separator();
+            ImGui::Text("Decompressed Chunks: %zu/%zu", m_current_tab->thread->resident_chunk_count(),
+                        m_current_tab->tiles->chunk_count());
 
             ImGui::EndMenu();
         }
@@ -283,12 +902,35 @@ void Application::draw_main_menu_bar()
                     ImGui::Separator();
                     if (ImGui::BeginCombo("Objects", m_selected_object->name().characters()))
                     {
-                        for (auto& object : Object::all_objects())
+                        if (ImGui::IsWindowAppearing())
+                            ImGui::SetKeyboardFocusHere();
+
+                        auto& search = m_objects_combo_search;
+                        if (ImGui::InputTextWithHint("##Search", "Search", search.text, sizeof(search.text)))
+                            search.needs_update = true;
+
+                        if (search.needs_update)
+                        {
+                            search.ids.clear();
+                            Object::names().for_each_id_with_prefix(search.text, [&](auto id)
+                            {
+                                search.ids.append(id);
+                            });
+                            search.needs_update = false;
+                        }
+
+                        ImGuiListClipper clipper;
+                        clipper.Begin(search.ids.size());
+                        while (clipper.Step())
                         {
-                            if (ImGui::Selectable(object.name().characters()))
+                            for (auto row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
                             {
-                                m_selected_object = &object;
-                                m_selected_object_style_x = m_selected_object_style_y = 0;
+                                auto& object = Object::all_objects()[search.ids[row]];
+                                if (ImGui::Selectable(object.name().characters()))
+                                {
+                                    m_selected_object = &object;
+                                    m_selected_object_style_x = m_selected_object_style_y = 0;
+                                }
                             }
                         }
                         ImGui::EndCombo();
@@ -309,11 +951,49 @@ void Application::draw_main_menu_bar()
                         }
                     }
                     break;
-                case Tool::Paint:
+                case Tool::Paint:
+                {
+                    draw_tile_properties(m_tile_to_paint);
+                    ImGui::Separator();
+                    ImGui::Checkbox("Allow Dragging", &m_paint_allow_drag);
+                    break;
+                }
+                case Tool::PaintWall:
+                {
+                    ImGui::Separator();
+                    if (ImGui::InputInt("Wall", &m_wall_to_paint))
+                        m_wall_to_paint = clamp(m_wall_to_paint, 0, WallLayer::wall_count - 1);
+
+                    // The middle of a wall surrounded by walls, which is what most of a painted wall looks like
+                    auto texture = m_wall_textures.get(m_wall_to_paint);
+                    if (texture.has_value())
+                    {
+                        ImGui::SameLine();
+                        ImGui::Image(reinterpret_cast<void*>(texture->gl_texture_id), ImVec2(16, 16),
+                                     ImVec2(44.0f / texture->width, 44.0f / texture->height),
+                                     ImVec2(60.0f / texture->width, 60.0f / texture->height));
+                    }
+
+                    ImGui::Checkbox("Allow Dragging", &m_paint_allow_drag);
+                    break;
+                }
+                case Tool::Liquid:
                 {
-                    draw_tile_properties(m_tile_to_paint);
                     ImGui::Separator();
-                    ImGui::Checkbox("Allow Dragging", &m_paint_allow_drag);
+                    ImGui::Combo("Liquid", &m_liquid_type, s_liquid_names, IM_ARRAYSIZE(s_liquid_names));
+                    ImGui::SliderInt("Amount", &m_liquid_amount, 0, LiquidLayer::max_amount,
+                                     m_liquid_amount == 0 ? "Drain" : "%d");
+
+                    if (ImGui::RadioButton("Basin", m_liquid_fill_basin))
+                        m_liquid_fill_basin = true;
+                    ImGui::SameLine();
+                    if (ImGui::RadioButton("Region", !m_liquid_fill_basin))
+                        m_liquid_fill_basin = false;
+
+                    if (m_liquid_fill_basin)
+                        ImGui::TextUnformatted("Click to fill the basin up to there, or drain the liquid there");
+                    else
+                        ImGui::TextUnformatted("Drag out a region to fill or drain");
                     break;
                 }
                 default:
@@ -323,7 +1003,8 @@ void Application::draw_main_menu_bar()
             ImGui::EndMenu();
         }
 
-        ImGui::Text("Selected Tile: %d, %d", m_selected_tile_x, m_selected_tile_y);
+        if (m_current_tab)
+            ImGui::Text("Selected Tile: %d, %d", m_current_tab->selected_tile_x, m_current_tab->selected_tile_y);
 
         ImGui::EndMainMenuBar();
     }
@@ -331,153 +1012,260 @@ void Application::draw_main_menu_bar()
 
 void Application::draw_tile_map()
 {
-    auto& io = ImGui::GetIO();
+    auto& tab = *m_current_tab;
     auto* draw_list = ImGui::GetBackgroundDrawList();
+    auto& camera = tab.camera;
 
-    // +1 to be sure we don't have an empty edge on other resolutions/tile visual sizes
-    auto tiles_to_draw_x = (static_cast<int>(io.DisplaySize.x) / m_tile_visual_size_x) + 1;
-    auto tiles_to_draw_y = (static_cast<int>(io.DisplaySize.y) / m_tile_visual_size_y) + 1;
-
-    for (int x = 0; x < tiles_to_draw_x; x++)
+    auto draw_sprite = [&](const Texture& texture, float tile_x, float tile_y, float frame_x, float frame_y,
+                           u32 color)
     {
-        auto real_x = x + m_offset_x;
-        if (real_x >= m_current_world->m_max_tiles_x)
-            break;
-
-        for (int y = 0; y < tiles_to_draw_y; y++)
+        auto top_left = camera.tile_to_screen(tile_x, tile_y);
+        auto bottom_right = camera.tile_to_screen(tile_x + 1.0f, tile_y + 1.0f);
+        draw_list->AddImage(reinterpret_cast<void*>(texture.gl_texture_id), ImVec2(top_left.x(), top_left.y()),
+                            ImVec2(bottom_right.x(), bottom_right.y()),
+                            ImVec2(frame_x / (float) texture.width, frame_y / (float) texture.height),
+                            ImVec2((frame_x + 16.0f) / (float) texture.width,
+                                   (frame_y + 16.0f) / (float) texture.height), color);
+    };
+
+    // Only the chunks we can see are ever looked at, and those are drawn from the render cache
+    auto visible_tiles = camera.visible_tiles();
+    auto visible_chunks = camera.visible_chunks(ChunkedTileMap::chunk_size);
+    tab.render_cache.evict_chunks_outside(visible_chunks);
+
+    // Walls go behind everything else. They hang over the edges of their tile, so one tile past what we can see has
+    // to be drawn too.
+    if (m_show_walls)
+    {
+        for (auto chunk_y = visible_chunks.start_y; chunk_y < visible_chunks.end_y; chunk_y++)
         {
-            auto real_y = y + m_offset_y;
-            if (real_y >= m_current_world->m_max_tiles_y)
-                break;
-
-            auto& tile = m_current_world->tile_map()->at(real_x, real_y);
-            if (tile.block().has_value())
+            for (auto chunk_x = visible_chunks.start_x; chunk_x < visible_chunks.end_x; chunk_x++)
             {
-                auto& tex = *m_tile_textures.get(static_cast<int>(tile.block()->id()));
-                short frame_x = 0;
-                short frame_y = 0;
-
-                if (tile.block()->frame_x().has_value())
-                    frame_x = *tile.block()->frame_x();
+                auto chunk_index = chunk_x + (tab.tiles->chunks_x() * chunk_y);
+                if (!tab.walls->chunk_has_walls(chunk_index))
+                    continue;
 
-                if (tile.block()->frame_y().has_value())
-                    frame_y = *tile.block()->frame_y();
-
-                auto color = tile.is_actuated() ? 0x5fffffff : 0xffffffff;
+                tab.walls->for_each_wall_in_chunk(chunk_index, [&](auto x, auto y, auto& wall)
+                {
+                    if (x < visible_tiles.start_x - 1 || x > visible_tiles.end_x || y < visible_tiles.start_y - 1 ||
+                        y > visible_tiles.end_y)
+                    {
+                        return;
+                    }
 
-                draw_list->AddImage(reinterpret_cast<void*>(tex.gl_texture_id),
-                                    ImVec2(x * m_tile_visual_size_x, y * m_tile_visual_size_y),
-                                    ImVec2((x + 1.0f) * m_tile_visual_size_x, (y + 1.0f) * m_tile_visual_size_y),
-                                    ImVec2((float) frame_x / (float) tex.width,
-                                           (float) frame_y / (float) tex.height),
-                                    ImVec2(((float) frame_x + 16.0f) / (float) tex.width,
-                                           ((float) frame_y + 16.0f) / (float) tex.height), color);
+                    auto texture = m_wall_textures.find(wall.id);
+                    if (texture == m_wall_textures.end())
+                        return;
+
+                    auto& wall_texture = texture->value;
+                    auto frame_x = wall.frame_x * 36.0f;
+                    auto frame_y = wall.frame_y * 36.0f;
+                    auto top_left = camera.tile_to_screen(x - 0.5f, y - 0.5f);
+                    auto bottom_right = camera.tile_to_screen(x + 1.5f, y + 1.5f);
+                    draw_list->AddImage(reinterpret_cast<void*>(wall_texture.gl_texture_id),
+                                        ImVec2(top_left.x(), top_left.y()), ImVec2(bottom_right.x(), bottom_right.y()),
+                                        ImVec2(frame_x / wall_texture.width, frame_y / wall_texture.height),
+                                        ImVec2((frame_x + 32.0f) / wall_texture.width,
+                                               (frame_y + 32.0f) / wall_texture.height));
+                });
             }
+        }
+    }
 
-            if (tile.has_red_wire())
+    if (m_draw_tile_map_on_gpu)
+    {
+        m_tile_map_renderer.draw(*tab.tiles, camera, draw_list, *m_render_thread);
+    }
+    else
+    {
+        for (auto chunk_y = visible_chunks.start_y; chunk_y < visible_chunks.end_y; chunk_y++)
+        {
+            for (auto chunk_x = visible_chunks.start_x; chunk_x < visible_chunks.end_x; chunk_x++)
             {
-                auto& top = m_current_world->tile_map()->at(real_x, real_y - 1);
-                auto& bottom = m_current_world->tile_map()->at(real_x, real_y + 1);
-                auto& left = m_current_world->tile_map()->at(real_x - 1, real_y);
-                auto& right = m_current_world->tile_map()->at(real_x + 1, real_y);
-
-                auto frames = Terraria::Tile::frames_for_wire(top.has_red_wire(), bottom.has_red_wire(),
-                                                              left.has_red_wire(), right.has_red_wire());
-
-                draw_list->AddImage(reinterpret_cast<void*>(m_red_wire_texture.gl_texture_id),
-                                    ImVec2(x * m_tile_visual_size_x, y * m_tile_visual_size_y),
-                                    ImVec2((x + 1.0f) * m_tile_visual_size_x, (y + 1.0f) * m_tile_visual_size_y),
-                                    ImVec2((float) frames.x / (float) m_red_wire_texture.width,
-                                           (float) frames.y / (float) m_red_wire_texture.height),
-                                    ImVec2(((float) frames.x + 16.0f) / (float) m_red_wire_texture.width,
-                                           ((float) frames.y + 16.0f) / (float) m_red_wire_texture.height), 0x7fffffff);
-            }
+                auto chunk_index = chunk_x + (tab.tiles->chunks_x() * chunk_y);
+                auto chunk_start_x = chunk_x * ChunkedTileMap::chunk_size;
+                auto chunk_start_y = chunk_y * ChunkedTileMap::chunk_size;
 
-            if (tile.has_blue_wire())
-            {
-                auto& top = m_current_world->tile_map()->at(real_x, real_y - 1);
-                auto& bottom = m_current_world->tile_map()->at(real_x, real_y + 1);
-                auto& left = m_current_world->tile_map()->at(real_x - 1, real_y);
-                auto& right = m_current_world->tile_map()->at(real_x + 1, real_y);
+                for (auto& sprite : tab.render_cache.sprites_for_chunk(chunk_index))
+                {
+                    auto x = chunk_start_x + sprite.x;
+                    auto y = chunk_start_y + sprite.y;
+                    if (x < visible_tiles.start_x || x >= visible_tiles.end_x || y < visible_tiles.start_y ||
+                        y >= visible_tiles.end_y)
+                    {
+                        continue;
+                    }
 
-                auto frames = Terraria::Tile::frames_for_wire(top.has_blue_wire(), bottom.has_blue_wire(),
-                                                              left.has_blue_wire(), right.has_blue_wire());
+                    const Texture* texture = nullptr;
+                    switch (sprite.sheet)
+                    {
+                        case ChunkRenderCache::Sprite::Sheet::Tile:
+                        {
+                            auto tile_texture = m_tile_textures.find(sprite.id);
+                            if (tile_texture != m_tile_textures.end())
+                                texture = &tile_texture->value;
+                            break;
+                        }
+                        case ChunkRenderCache::Sprite::Sheet::RedWire:
+                            texture = &m_red_wire_texture;
+                            break;
+                        case ChunkRenderCache::Sprite::Sheet::BlueWire:
+                            texture = &m_blue_wire_texture;
+                            break;
+                        case ChunkRenderCache::Sprite::Sheet::GreenWire:
+                            texture = &m_green_wire_texture;
+                            break;
+                        case ChunkRenderCache::Sprite::Sheet::YellowWire:
+                            texture = &m_yellow_wire_texture;
+                            break;
+                        case ChunkRenderCache::Sprite::Sheet::Actuator:
+                        {
+                            // The actuator texture is just the one sprite, so stretch all of it over the tile
+                            auto top_left = camera.tile_to_screen(x, y);
+                            auto bottom_right = camera.tile_to_screen(x + 1.0f, y + 1.0f);
+                            draw_list->AddImage(reinterpret_cast<void*>(m_actuator_texture.gl_texture_id),
+                                                ImVec2(top_left.x(), top_left.y()),
+                                                ImVec2(bottom_right.x(), bottom_right.y()), ImVec2(0.0f, 0.0f),
+                                                ImVec2(1.0f, 1.0f), sprite.color);
+                            continue;
+                        }
+                    }
 
-                draw_list->AddImage(reinterpret_cast<void*>(m_blue_wire_texture.gl_texture_id),
-                                    ImVec2(x * m_tile_visual_size_x, y * m_tile_visual_size_y),
-                                    ImVec2((x + 1.0f) * m_tile_visual_size_x, (y + 1.0f) * m_tile_visual_size_y),
-                                    ImVec2((float) frames.x / (float) m_blue_wire_texture.width,
-                                           (float) frames.y / (float) m_blue_wire_texture.height),
-                                    ImVec2(((float) frames.x + 16.0f) / (float) m_blue_wire_texture.width,
-                                           ((float) frames.y + 16.0f) / (float) m_blue_wire_texture.height),
-                                    0x7fffffff);
+                    if (texture)
+                        draw_sprite(*texture, x, y, sprite.frame_x, sprite.frame_y, sprite.color);
+                }
             }
+        }
+    }
 
-            if (tile.has_green_wire())
+    // Liquids go over the blocks. Tiles next to each other in a row with the same liquid become one rectangle, so a
+    // lake is a rectangle per row rather than one per tile.
+    if (m_show_liquids)
+    {
+        for (auto chunk_y = visible_chunks.start_y; chunk_y < visible_chunks.end_y; chunk_y++)
+        {
+            for (auto chunk_x = visible_chunks.start_x; chunk_x < visible_chunks.end_x; chunk_x++)
             {
-                auto& top = m_current_world->tile_map()->at(real_x, real_y - 1);
-                auto& bottom = m_current_world->tile_map()->at(real_x, real_y + 1);
-                auto& left = m_current_world->tile_map()->at(real_x - 1, real_y);
-                auto& right = m_current_world->tile_map()->at(real_x + 1, real_y);
+                auto chunk_index = chunk_x + (tab.tiles->chunks_x() * chunk_y);
+                if (!tab.liquids->chunk_has_liquid(chunk_index))
+                    continue;
+
+                int run_x = 0;
+                int run_end_x = 0;
+                int run_y = 0;
+                u8 run_liquid = 0;
+                auto draw_run = [&]
+                {
+                    if (run_liquid == 0)
+                        return;
+
+                    // Liquid settles at the bottom of its tile
+                    auto fullness = LiquidLayer::amount_of(run_liquid) / static_cast<float>(LiquidLayer::max_amount);
+                    auto top_left = camera.tile_to_screen(run_x, run_y + 1.0f - fullness);
+                    auto bottom_right = camera.tile_to_screen(run_end_x, run_y + 1.0f);
+                    draw_list->AddRectFilled(ImVec2(top_left.x(), top_left.y()),
+                                             ImVec2(bottom_right.x(), bottom_right.y()),
+                                             LiquidLayer::colors[static_cast<u8>(LiquidLayer::type_of(run_liquid))]);
+                };
+
+                tab.liquids->for_each_liquid_in_chunk(chunk_index, [&](auto x, auto y, auto liquid)
+                {
+                    if (x < visible_tiles.start_x || x >= visible_tiles.end_x || y < visible_tiles.start_y ||
+                        y >= visible_tiles.end_y)
+                    {
+                        return;
+                    }
 
-                auto frames = Terraria::Tile::frames_for_wire(top.has_green_wire(), bottom.has_green_wire(),
-                                                              left.has_green_wire(), right.has_green_wire());
+                    if (y == run_y && x == run_end_x && liquid == run_liquid)
+                    {
+                        run_end_x++;
+                        return;
+                    }
 
-                draw_list->AddImage(reinterpret_cast<void*>(m_green_wire_texture.gl_texture_id),
-                                    ImVec2(x * m_tile_visual_size_x, y * m_tile_visual_size_y),
-                                    ImVec2((x + 1.0f) * m_tile_visual_size_x, (y + 1.0f) * m_tile_visual_size_y),
-                                    ImVec2((float) frames.x / (float) m_green_wire_texture.width,
-                                           (float) frames.y / (float) m_green_wire_texture.height),
-                                    ImVec2(((float) frames.x + 16.0f) / (float) m_green_wire_texture.width,
-                                           ((float) frames.y + 16.0f) / (float) m_green_wire_texture.height),
-                                    0x7fffffff);
+                    draw_run();
+                    run_x = x;
+                    run_end_x = x + 1;
+                    run_y = y;
+                    run_liquid = liquid;
+                });
+                draw_run();
             }
+        }
+    }
+
+    auto draw_tile_rect = [&](float x, float y, float width, float height, u32 color)
+    {
+        auto top_left = camera.tile_to_screen(x, y);
+        auto bottom_right = camera.tile_to_screen(x + width, y + height);
+        draw_list->AddRect(ImVec2(top_left.x(), top_left.y()), ImVec2(bottom_right.x(), bottom_right.y()), color);
+    };
 
-            if (tile.has_yellow_wire())
+    if (tab.diff)
+    {
+        // Changed tiles are tinted red, changed chests and signs get a box around them
+        for (auto chunk_y = visible_chunks.start_y; chunk_y < visible_chunks.end_y; chunk_y++)
+        {
+            for (auto chunk_x = visible_chunks.start_x; chunk_x < visible_chunks.end_x; chunk_x++)
             {
-                auto& top = m_current_world->tile_map()->at(real_x, real_y - 1);
-                auto& bottom = m_current_world->tile_map()->at(real_x, real_y + 1);
-                auto& left = m_current_world->tile_map()->at(real_x - 1, real_y);
-                auto& right = m_current_world->tile_map()->at(real_x + 1, real_y);
+                for (auto& change : tab.diff->tile_changes_in_chunk(chunk_x + (tab.tiles->chunks_x() * chunk_y)))
+                {
+                    auto top_left = camera.tile_to_screen(change.x, change.y);
+                    auto bottom_right = camera.tile_to_screen(change.x + 1.0f, change.y + 1.0f);
+                    draw_list->AddRectFilled(ImVec2(top_left.x(), top_left.y()),
+                                             ImVec2(bottom_right.x(), bottom_right.y()), 0x600000ff);
+                }
+            }
+        }
 
-                auto frames = Terraria::Tile::frames_for_wire(top.has_yellow_wire(), bottom.has_yellow_wire(),
-                                                              left.has_yellow_wire(), right.has_yellow_wire());
+        for (auto& change : tab.diff->chest_changes())
+            draw_tile_rect(change.x, change.y, 2, 2, 0xff0080ff);
 
-                draw_list->AddImage(reinterpret_cast<void*>(m_yellow_wire_texture.gl_texture_id),
-                                    ImVec2(x * m_tile_visual_size_x, y * m_tile_visual_size_y),
-                                    ImVec2((x + 1.0f) * m_tile_visual_size_x, (y + 1.0f) * m_tile_visual_size_y),
-                                    ImVec2((float) frames.x / (float) m_yellow_wire_texture.width,
-                                           (float) frames.y / (float) m_yellow_wire_texture.height),
-                                    ImVec2(((float) frames.x + 16.0f) / (float) m_yellow_wire_texture.width,
-                                           ((float) frames.y + 16.0f) / (float) m_yellow_wire_texture.height),
-                                    0x7fffffff);
-            }
+        for (auto& change : tab.diff->sign_changes())
+            draw_tile_rect(change.x, change.y, 2, 2, 0xff0080ff);
+    }
 
-            if (tile.has_actuator())
-            {
-                draw_list->AddImage(reinterpret_cast<void*>(m_actuator_texture.gl_texture_id),
-                                    ImVec2(x * m_tile_visual_size_x, y * m_tile_visual_size_y),
-                                    ImVec2((x + 1.0f) * m_tile_visual_size_x, (y + 1.0f) * m_tile_visual_size_y),
-                                    ImVec2(0.0f, 0.0f), ImVec2(1.0f, 1.0f), 0x7fffffff);
-            }
+    if (tab.wires && tab.selected_wire_network.has_value())
+    {
+        static constexpr u32 network_colors[wire_color_count] = {0x800000ff, 0x80ff0000, 0x8000ff00, 0x8000ffff};
 
-            if (real_x == m_selected_tile_x && real_y == m_selected_tile_y)
+        auto& selected = *tab.selected_wire_network;
+        auto color = network_colors[static_cast<size_t>(selected.color)];
+        for (auto chunk_y = visible_chunks.start_y; chunk_y < visible_chunks.end_y; chunk_y++)
+        {
+            for (auto chunk_x = visible_chunks.start_x; chunk_x < visible_chunks.end_x; chunk_x++)
             {
-                draw_list->AddRect(ImVec2(x * m_tile_visual_size_x, y * m_tile_visual_size_y),
-                                   ImVec2((x + 1.0f) * m_tile_visual_size_x, (y + 1.0f) * m_tile_visual_size_y),
-                                   0xff00ffff);
+                tab.wires->for_each_tile_in_network(chunk_x + (tab.tiles->chunks_x() * chunk_y), selected.color,
+                                                    selected.network, [&](auto x, auto y)
+                {
+                    auto top_left = camera.tile_to_screen(x, y);
+                    auto bottom_right = camera.tile_to_screen(x + 1.0f, y + 1.0f);
+                    draw_list->AddRectFilled(ImVec2(top_left.x(), top_left.y()),
+                                             ImVec2(bottom_right.x(), bottom_right.y()), color);
+                });
             }
         }
     }
 
+    draw_tile_rect(tab.selected_tile_x, tab.selected_tile_y, 1, 1, 0xff00ffff);
+
+    if (tab.selected_object.has_value())
+    {
+        auto& selected_object = *tab.selected_object;
+        draw_tile_rect(selected_object.origin_x, selected_object.origin_y, selected_object.object->width(),
+                       selected_object.object->height(), 0xffffff00);
+    }
+
     if (m_current_tool == Tool::PlaceObject)
     {
         for (auto x = 0; x < m_selected_object->width(); x++)
         {
             for (auto y = 0; y < m_selected_object->height(); y++)
             {
-                auto& tile = m_selected_object->tiles().at(m_selected_object->index_for_position(x, y));
-                auto tex = *m_tile_textures.get(static_cast<int>(tile.block()->id()));
+                auto tile = m_selected_object->tile_for_style(x, y, m_selected_object_style_x,
+                                                              m_selected_object_style_y);
+                auto texture = m_tile_textures.get(static_cast<int>(tile.block()->id()));
+                if (!texture.has_value())
+                    continue;
 
                 short frame_x = 0;
                 short frame_y = 0;
@@ -488,67 +1276,90 @@ void Application::draw_tile_map()
                 if (tile.block()->frame_y().has_value())
                     frame_y = *tile.block()->frame_y();
 
-                if (m_selected_object->style_offset_x().has_value())
-                {
-                    frame_x += (*m_selected_object->style_offset_x() * m_selected_object_style_x);
-                }
-
-                if (m_selected_object->style_offset_y().has_value())
-                {
-                    frame_y += (*m_selected_object->style_offset_y() * m_selected_object_style_y);
-                }
-
-                draw_list->AddImage(reinterpret_cast<void*>(tex.gl_texture_id),
-                                    ImVec2((x * m_tile_visual_size_x) + m_hovered_visual_tile_x,
-                                           (y * m_tile_visual_size_y) + m_hovered_visual_tile_y),
-                                    ImVec2(((x + 1.0f) * m_tile_visual_size_x + m_hovered_visual_tile_x),
-                                           ((y + 1.0f) * m_tile_visual_size_y) + m_hovered_visual_tile_y),
-                                    ImVec2((float) frame_x / (float) tex.width,
-                                           (float) frame_y / (float) tex.height),
-                                    ImVec2(((float) frame_x + 16.0f) / (float) tex.width,
-                                           ((float) frame_y + 16.0f) / (float) tex.height), 0x5fffffff);
+                draw_sprite(*texture, m_hovered_tile_x + x, m_hovered_tile_y + y, frame_x, frame_y, 0x5fffffff);
             }
         }
     }
+    else if (m_liquid_region_start.has_value())
+    {
+        auto start = *m_liquid_region_start;
+        draw_tile_rect(min(start.x(), m_hovered_tile_x), min(start.y(), m_hovered_tile_y),
+                       abs(start.x() - m_hovered_tile_x) + 1, abs(start.y() - m_hovered_tile_y) + 1, 0xffff00ff);
+    }
     else
     {
-        draw_list->AddRect(
-                ImVec2(static_cast<float>(m_hovered_visual_tile_x) - static_cast<float>(m_tile_visual_size_x),
-                       static_cast<float>(m_hovered_visual_tile_y) - static_cast<float>(m_tile_visual_size_y)),
-                ImVec2(static_cast<float>(m_hovered_visual_tile_x),
-                       static_cast<float>(m_hovered_visual_tile_y)), 0xffff00ff);
+        draw_tile_rect(m_hovered_tile_x, m_hovered_tile_y, 1, 1, 0xffff00ff);
     }
 }
 
-void Application::draw_tiles_combo_box(const StringView& preview, Function<void(Optional<int>)> on_select)
+void Application::draw_searchable_combo_box(const char* label, const char* preview, ComboSearch& search,
+                                            const NameTable& names, const HashMap<u16, Texture>& textures,
+                                            bool first_frame_only, Function<void(Optional<int>)> on_select)
 {
-    if (ImGui::BeginCombo("Blocks", preview.characters_without_null_termination()))
+    if (ImGui::BeginCombo(label, preview))
     {
+        if (ImGui::IsWindowAppearing())
+            ImGui::SetKeyboardFocusHere();
+
+        if (ImGui::InputTextWithHint("##Search", "Search", search.text, sizeof(search.text)))
+            search.needs_update = true;
+
+        // We only need to look through the names again when what the user typed changes, not every frame
+        if (search.needs_update)
+        {
+            search.ids.clear();
+            names.for_each_id_with_prefix(search.text, [&](auto id)
+            {
+                if (textures.contains(id))
+                    search.ids.append(id);
+            });
+            search.needs_update = false;
+        }
+
         if (ImGui::Selectable("None"))
             on_select({});
 
-        for (auto& tex_for_blocks_combo : m_tile_textures)
+        // Only the rows that are actually visible are submitted, there can be thousands of these
+        ImGuiListClipper clipper;
+        clipper.Begin(search.ids.size());
+        while (clipper.Step())
         {
-            ImGui::Image(reinterpret_cast<void*>(tex_for_blocks_combo.value.gl_texture_id), ImVec2(16, 16),
-                         ImVec2(0.0f, 0.0f),
-                         ImVec2(16.0f / (float) tex_for_blocks_combo.value.width,
-                                16.0f / (float) tex_for_blocks_combo.value.height));
-            ImGui::SameLine();
-            // FIXME: string allocation each time?? wtf, can't we just get the char* with a null term?
-            if (ImGui::Selectable(String::formatted("{}",
-                                                    Terraria::s_tiles[tex_for_blocks_combo.key].internal_name).characters()))
+            for (auto row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
             {
-                on_select(tex_for_blocks_combo.key);
+                auto id = search.ids[row];
+                auto& texture = *textures.get(id);
+
+                ImGui::PushID(id);
+                // FIXME: stretching?
+                ImGui::Image(reinterpret_cast<void*>(texture.gl_texture_id), ImVec2(16, 16), ImVec2(0.0f, 0.0f),
+                             first_frame_only ? ImVec2(16.0f / (float) texture.width, 16.0f / (float) texture.height)
+                                              : ImVec2(1.0f, 1.0f));
+                ImGui::SameLine();
+                if (ImGui::Selectable(names.name(id)))
+                    on_select(id);
+                ImGui::PopID();
             }
         }
 
         ImGui::EndCombo();
     }
+}
+
+void Application::draw_tiles_combo_box(const char* preview, Function<void(Optional<int>)> on_select)
+{
+    draw_searchable_combo_box("Blocks", preview, m_tiles_combo_search, NameTable::tiles(), m_tile_textures, true,
+                              move(on_select));
+}
 
+void Application::draw_items_combo_box(const char* preview, Function<void(Optional<int>)> on_select)
+{
+    draw_searchable_combo_box("Items", preview, m_items_combo_search, NameTable::items(), m_item_textures, false,
+                              move(on_select));
 }
 
-void Application::draw_tile_properties(Terraria::Tile& tile)
+bool Application::draw_tile_properties(Terraria::Tile& tile)
 {
+    bool changed = false;
     ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
     if (ImGui::BeginChild("Selection Image", ImVec2(64, 64), true,
                           ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse))
@@ -582,13 +1393,11 @@ void Application::draw_tile_properties(Terraria::Tile& tile)
 
     ImGui::EndChild();
 
-    auto preview_string = tile.block().has_value() ?
-                          String::formatted("{}",
-                                            Terraria::s_tiles[static_cast<int>(tile.block()->id())].internal_name)
-                                                   : String::empty();
+    auto* preview = tile.block().has_value() ? NameTable::tiles().name(static_cast<int>(tile.block()->id())) : "";
 
-    draw_tiles_combo_box(preview_string, [&tile](auto id)
+    draw_tiles_combo_box(preview, [&tile, &changed](auto id)
     {
+        changed = true;
         if (!id.has_value())
             tile.block() = {};
         else
@@ -599,177 +1408,357 @@ void Application::draw_tile_properties(Terraria::Tile& tile)
     {
         ImGui::SetNextItemWidth(75.0f);
         if (ImGui::InputInt("Frame X", &m_selected_frame_x, 18, 18) && tile.block().has_value())
+        {
             tile.block()->frame_x() = m_selected_frame_x;
+            changed = true;
+        }
 
         ImGui::SameLine();
 
         ImGui::SetNextItemWidth(75.0f);
         if (ImGui::InputInt("Frame Y", &m_selected_frame_y, 18, 18) && tile.block().has_value())
+        {
             tile.block()->frame_y() = m_selected_frame_y;
+            changed = true;
+        }
 
         ImGui::Separator();
     }
 
     if (ImGui::Checkbox("Red Wire", &m_tile_properties_has_red_wire))
+    {
         tile.set_red_wire(m_tile_properties_has_red_wire);
+        changed = true;
+    }
 
     if (ImGui::Checkbox("Green Wire", &m_tile_properties_has_green_wire))
+    {
         tile.set_green_wire(m_tile_properties_has_green_wire);
+        changed = true;
+    }
 
     if (ImGui::Checkbox("Blue Wire", &m_tile_properties_has_blue_wire))
+    {
         tile.set_blue_wire(m_tile_properties_has_blue_wire);
+        changed = true;
+    }
 
     if (ImGui::Checkbox("Yellow Wire", &m_tile_properties_has_yellow_wire))
+    {
         tile.set_yellow_wire(m_tile_properties_has_yellow_wire);
+        changed = true;
+    }
 
     if (ImGui::Checkbox("Actuator", &m_tile_properties_has_actuator))
+    {
         tile.set_has_actuator(m_tile_properties_has_actuator);
+        changed = true;
+    }
 
     if (ImGui::Checkbox("Actuated", &m_tile_properties_is_actuated))
+    {
         tile.set_is_actuated(m_tile_properties_is_actuated);
+        changed = true;
+    }
+
+    return changed;
 }
 
 void Application::draw_selection_window()
 {
     if (ImGui::Begin("Selection", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
     {
-        auto& tile = m_current_world->tile_map()->at(m_selected_tile_x, m_selected_tile_y);
-        draw_tile_properties(tile);
+        auto& tab = *m_current_tab;
+        auto tile = tab.tiles->tile_at(tab.selected_tile_x, tab.selected_tile_y);
+        if (draw_tile_properties(tile))
+            tab.thread->submit(EditCommand::set_tile(tab.selected_tile_x, tab.selected_tile_y, move(tile), false));
+
+        ImGui::Text("Wall: %d", tab.walls->wall_at(tab.selected_tile_x, tab.selected_tile_y));
+
+        auto liquid = tab.liquids->liquid_at(tab.selected_tile_x, tab.selected_tile_y);
+        if (liquid != 0)
+        {
+            ImGui::Text("Liquid: %s, %d/%d", s_liquid_names[static_cast<u8>(LiquidLayer::type_of(liquid))],
+                        LiquidLayer::amount_of(liquid), LiquidLayer::max_amount);
+        }
+
+        if (tab.selected_object.has_value())
+            draw_selected_object_properties();
     }
 
     ImGui::End();
 }
 
+void Application::draw_selected_object_properties()
+{
+    auto& tab = *m_current_tab;
+    auto& selected_object = *tab.selected_object;
+    auto& object = *selected_object.object;
+
+    ImGui::Separator();
+    ImGui::Text("Object: %s (at %d, %d)", object.name().characters(), selected_object.origin_x,
+                selected_object.origin_y);
+
+    if (object.style_offset_x().has_value() || object.style_offset_y().has_value())
+    {
+        bool restyled;
+        if (object.is_individually_styled())
+        {
+            restyled = ImGui::InputInt("Object Style X", &selected_object.style_x);
+            restyled |= ImGui::InputInt("Object Style Y", &selected_object.style_y);
+        }
+        else
+        {
+            restyled = ImGui::InputInt("Object Style", &selected_object.style_x);
+            selected_object.style_y = selected_object.style_x;
+        }
+
+        selected_object.style_x = max(selected_object.style_x, 0);
+        selected_object.style_y = max(selected_object.style_y, 0);
+
+        if (restyled)
+        {
+            tab.thread->submit(EditCommand::restyle_object(selected_object.origin_x, selected_object.origin_y, object,
+                                                           selected_object.style_x, selected_object.style_y));
+        }
+    }
+
+    if (ImGui::Button("Delete Object"))
+    {
+        tab.thread->submit(EditCommand::remove_object(selected_object.origin_x, selected_object.origin_y, object));
+        tab.selected_object = {};
+    }
+
+    ImGui::SameLine();
+
+    // Picking an object up removes it, and gets you ready to place it somewhere else
+    if (ImGui::Button("Pick Up Object"))
+    {
+        tab.thread->submit(EditCommand::remove_object(selected_object.origin_x, selected_object.origin_y, object));
+        m_current_tool = Tool::PlaceObject;
+        m_selected_object = &object;
+        m_selected_object_style_x = selected_object.style_x;
+        m_selected_object_style_y = selected_object.style_y;
+        tab.selected_object = {};
+    }
+}
+
 void Application::draw_selected_chest_window()
 {
+    auto& tab = *m_current_tab;
+    auto& chest = *tab.selected_chest;
     if (ImGui::Begin("Chest", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
     {
-        if (ImGui::InputText("Name", m_selected_chest_name, sizeof(m_selected_chest_name)))
-            m_selected_chest->set_name(m_selected_chest_name);
+        if (ImGui::InputText("Name", tab.selected_chest_name, sizeof(tab.selected_chest_name)))
+        {
+            chest.set_name(tab.selected_chest_name);
+            tab.chests.invalidate();
+        }
         ImGui::Separator();
 
-        // FIXME: Can we really assume chests will always have 40 slots? The world file doesn't.
-        for (auto i = 0; i < 40; i++)
-        {
-            auto formatted_name = String::formatted("ChestSlot{}", i);
-            ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
-            auto current_cursor = ImGui::GetCursorScreenPos();
-            if (ImGui::BeginChild(formatted_name.characters(), ImVec2(32, 32), true,
-                                  ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse))
-            {
-                ImGui::PopStyleVar();
-                auto maybe_item = m_selected_chest->contents().get(i);
-                // TODO: This is an annoying check to perform, can we improve it?
-                // We can't use IsItemHovered as this isn't an item, it's a child window
-                // and we can't check for a specific child window without it considering other windows/child windows
-                // down the line (like the tooltip or popup)
-                bool hovered = ImGui::IsMouseHoveringRect(current_cursor,
-                                                          ImVec2(current_cursor.x + 32, current_cursor.y + 32));
-                if (hovered && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
+        // One table for every slot, of which only the rows we can see are drawn
+        constexpr int slots_per_row = 10;
+        constexpr int max_visible_rows = 8;
+        constexpr float slot_size = 32.0f;
+        auto slots = ChestIndex::slot_count(chest);
+        auto rows = (slots + slots_per_row - 1) / slots_per_row;
+        auto row_height = slot_size + (ImGui::GetStyle().CellPadding.y * 2);
+
+        bool open_popup = false;
+        if (ImGui::BeginTable("Slots", slots_per_row, ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY,
+                              ImVec2(0, row_height * min(rows, max_visible_rows))))
+        {
+            for (auto column = 0; column < slots_per_row; column++)
+                ImGui::TableSetupColumn(nullptr, ImGuiTableColumnFlags_WidthFixed, slot_size);
+
+            auto* draw_list = ImGui::GetWindowDrawList();
+            ImGuiListClipper clipper;
+            clipper.Begin(rows, row_height);
+            while (clipper.Step())
+            {
+                for (auto row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
                 {
-                    if (maybe_item.has_value())
+                    ImGui::TableNextRow(ImGuiTableRowFlags_None, row_height);
+                    for (auto slot = row * slots_per_row; slot < min(slots, (row + 1) * slots_per_row); slot++)
                     {
-                        m_selected_chest_selected_item_stack = maybe_item->stack();
+                        ImGui::TableNextColumn();
+                        ImGui::PushID(slot);
+
+                        auto top_left = ImGui::GetCursorScreenPos();
+                        ImGui::InvisibleButton("Slot", ImVec2(slot_size, slot_size));
+                        auto hovered = ImGui::IsItemHovered();
+                        auto item = chest.contents().get(slot);
+                        if (hovered && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
+                        {
+                            m_selected_chest_slot = slot;
+                            if (item.has_value())
+                                m_selected_chest_selected_item_stack = item->stack();
+                            open_popup = true;
+                        }
+
+                        if (item.has_value())
+                        {
+                            auto id = static_cast<int>(item->id());
+                            if (hovered)
+                                ImGui::SetTooltip("%s", NameTable::items().name(id));
+
+                            auto texture = m_item_textures.get(id);
+                            if (texture.has_value())
+                            {
+                                auto image_x = top_left.x + ((slot_size - texture->width) * 0.5f);
+                                auto image_y = top_left.y + ((slot_size - texture->height) * 0.5f);
+                                draw_list->AddImage(reinterpret_cast<void*>(texture->gl_texture_id),
+                                                    ImVec2(image_x, image_y),
+                                                    ImVec2(image_x + texture->width, image_y + texture->height));
+                            }
+
+                            char stack[8];
+                            snprintf(stack, sizeof(stack), "%d", item->stack());
+                            draw_list->AddText(top_left, ImGui::GetColorU32(ImGuiCol_Text), stack);
+                        }
+
+                        ImGui::PopID();
                     }
-                    ImGui::OpenPopup("ModifyChestItem");
                 }
+            }
+
+            ImGui::EndTable();
+        }
+
+        // There's only ever one of these open, so it lives outside of the table, where rows come and go as we scroll
+        if (open_popup)
+            ImGui::OpenPopup("ModifyChestItem");
+
+        if (ImGui::BeginPopup("ModifyChestItem"))
+        {
+            auto slot = m_selected_chest_slot;
+            auto maybe_item = chest.contents().get(slot);
+            auto* preview = maybe_item.has_value() ? NameTable::items().name(static_cast<int>(maybe_item->id())) : "";
 
-                if (maybe_item.has_value())
+            draw_items_combo_box(preview, [&](auto id)
+            {
+                tab.chests.invalidate();
+                if (!id.has_value())
                 {
-                    auto id = static_cast<int>(maybe_item->id());
-                    if (hovered)
-                        ImGui::SetTooltip("%s", Terraria::s_items[id - 1].english_name.to_string().characters());
-
-                    auto tex = *m_item_textures.get(id);
-                    ImGui::SetCursorPosX((ImGui::GetWindowWidth() - tex.width) * 0.5f);
-                    ImGui::SetCursorPosY((ImGui::GetWindowHeight() - tex.height) * 0.5f);
-                    ImGui::Image(reinterpret_cast<void*>(tex.gl_texture_id), ImVec2(tex.width, tex.height));
-                    ImGui::SetCursorPos(ImVec2());
-                    ImGui::Text("%d", maybe_item->stack());
+                    chest.contents().remove(slot);
+                    maybe_item = {};
+                    return;
                 }
 
-                if (ImGui::BeginPopup("ModifyChestItem"))
+                if (!maybe_item.has_value())
                 {
-                    auto preview_string = maybe_item.has_value() ? String::formatted("{}", Terraria::s_items[
-                            static_cast<int>(maybe_item->id()) - 1].english_name) : String::empty();
-
-                    if (ImGui::BeginCombo("Items", preview_string.characters()))
-                    {
-                        if (ImGui::Selectable("None"))
-                            m_selected_chest->contents().remove(i);
+                    Terraria::Item item;
+                    item.set_stack(1);
+                    maybe_item = move(item);
+                    m_selected_chest_selected_item_stack = 1;
+                }
 
-                        for (auto& tex_for_items_combo : m_item_textures)
-                        {
-                            // FIXME: stretching?
-                            ImGui::Image(reinterpret_cast<void*>(tex_for_items_combo.value.gl_texture_id),
-                                         ImVec2(16, 16));
-                            ImGui::SameLine();
-                            // FIXME: string allocation each time?? wtf, can't we just get the char* with a null term?
-                            if (ImGui::Selectable(String::formatted("{}", Terraria::s_items[
-                                    static_cast<int>(tex_for_items_combo.key) - 1].english_name).characters()))
-                            {
-                                if (!maybe_item.has_value())
-                                {
-                                    Terraria::Item item;
-                                    item.set_stack(1);
-                                    maybe_item = move(item);
-                                    m_selected_chest_selected_item_stack = 1;
-                                }
+                maybe_item->set_id(static_cast<Terraria::Item::Id>(*id));
+                chest.contents().set(slot, *maybe_item);
+            });
 
-                                maybe_item->set_id(static_cast<Terraria::Item::Id>(tex_for_items_combo.key));
-                                m_selected_chest->contents().set(i, *maybe_item);
-                            }
-                        }
-                        ImGui::EndCombo();
-                    }
+            if (maybe_item.has_value())
+            {
+                ImGui::Separator();
+                if (ImGui::InputScalar("Stack", ImGuiDataType_S16, &m_selected_chest_selected_item_stack))
+                {
+                    maybe_item->set_stack(m_selected_chest_selected_item_stack);
+                    chest.contents().set(slot, *maybe_item);
+                    tab.chests.invalidate();
+                }
 
-                    if (maybe_item.has_value())
+                auto& prefixes = NameTable::prefixes();
+                if (ImGui::BeginCombo("Prefix", prefixes.name(static_cast<int>(maybe_item->prefix()))))
+                {
+                    // Prefix 0 is None, which gets to be first just like in the other combo boxes
+                    ImGuiListClipper clipper;
+                    clipper.Begin(prefixes.size());
+                    while (clipper.Step())
                     {
-                        ImGui::Separator();
-                        if (ImGui::InputScalar("Stack", ImGuiDataType_S16, &m_selected_chest_selected_item_stack))
-                        {
-                            maybe_item->set_stack(m_selected_chest_selected_item_stack);
-                            m_selected_chest->contents().set(i, *maybe_item);
-                        }
-
-                        auto preview_prefix =
-                                maybe_item.has_value() && maybe_item->prefix() != Terraria::Item::Prefix::None
-                                ? String::formatted("{}", Terraria::s_prefixes[
-                                        static_cast<int>(maybe_item->prefix()) - 1].english_name) : "None";
-
-                        if (ImGui::BeginCombo("Prefix", preview_prefix.characters()))
+                        for (auto j = clipper.DisplayStart; j < clipper.DisplayEnd; j++)
                         {
-                            if (ImGui::Selectable("None"))
-                            {
-                                maybe_item->set_prefix(Terraria::Item::Prefix::None);
-                                m_selected_chest->contents().set(i, *maybe_item);
-                            }
-
-                            for (auto j = 0; j < Terraria::s_total_prefixes; j++)
+                            ImGui::PushID(j);
+                            if (ImGui::Selectable(prefixes.name(j)))
                             {
-                                if (ImGui::Selectable(
-                                        Terraria::s_prefixes[j].english_name.characters_without_null_termination()))
-                                {
-                                    maybe_item->set_prefix(static_cast<Terraria::Item::Prefix>(j + 1));
-                                    m_selected_chest->contents().set(i, *maybe_item);
-                                }
+                                maybe_item->set_prefix(static_cast<Terraria::Item::Prefix>(j));
+                                chest.contents().set(slot, *maybe_item);
                             }
-                            ImGui::EndCombo();
+                            ImGui::PopID();
                         }
                     }
-                    ImGui::EndPopup();
+                    ImGui::EndCombo();
                 }
             }
-            else
+            ImGui::EndPopup();
+        }
+    }
+
+    ImGui::End();
+}
+
+void Application::draw_chest_browser()
+{
+    auto& tab = *m_current_tab;
+    if (ImGui::Begin("Chests", &m_show_chest_browser))
+    {
+        // A script is busy with the chests, and would leave the index out of date anyway
+        if (tab.is_running_script)
+        {
+            ImGui::TextDisabled("Waiting for the script to finish...");
+            ImGui::End();
+            return;
+        }
+
+        auto* preview = m_chest_browser_item.has_value() ? NameTable::items().name(*m_chest_browser_item) : "Any Item";
+        draw_items_combo_box(preview, [&](auto id)
+        {
+            m_chest_browser_item = id;
+        });
+
+        // Filtering by an item is just a lookup, so there's no reason to hold on to the matches
+        auto& entries = tab.chests.entries();
+        Span<const size_t> matching_entries;
+        if (m_chest_browser_item.has_value())
+            matching_entries = tab.chests.entries_with_item(static_cast<u16>(*m_chest_browser_item));
+
+        auto row_count = m_chest_browser_item.has_value() ? matching_entries.size() : entries.size();
+        ImGui::Text("%zu chests", row_count);
+
+        Optional<Gfx::IntPoint> position_to_jump_to;
+        if (ImGui::BeginTable("Chests", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                                           ImGuiTableFlags_Resizable))
+        {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Position", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Contents", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableHeadersRow();
+
+            ImGuiListClipper clipper;
+            clipper.Begin(row_count);
+            while (clipper.Step())
             {
-                ImGui::PopStyleVar();
+                for (auto row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+                {
+                    auto& entry = entries[m_chest_browser_item.has_value() ? matching_entries[row] : row];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::PushID(row);
+                    if (ImGui::Selectable(entry.position.characters(), false, ImGuiSelectableFlags_SpanAllColumns))
+                        position_to_jump_to = Gfx::IntPoint(entry.x, entry.y);
+                    ImGui::PopID();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(entry.chest->name().characters());
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(entry.summary.characters());
+                }
             }
 
-            ImGui::EndChild();
-
-            if ((i + 1) % 10 != 0)
-                ImGui::SameLine();
+            ImGui::EndTable();
         }
+
+        if (position_to_jump_to.has_value())
+            jump_to_tile(position_to_jump_to->x(), position_to_jump_to->y());
     }
 
     ImGui::End();
@@ -777,13 +1766,62 @@ void Application::draw_selected_chest_window()
 
 void Application::draw_selected_sign_window()
 {
+    auto& tab = *m_current_tab;
     if (ImGui::Begin("Sign", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
     {
-        if (ImGui::InputTextMultiline("Text", m_selected_sign_text, sizeof(m_selected_sign_text), ImVec2(400, 100)))
-            m_selected_sign->set_text(m_selected_sign_text);
+        if (ImGui::InputTextMultiline("Text", tab.selected_sign_text, sizeof(tab.selected_sign_text), ImVec2(400, 100)))
+            tab.selected_sign->set_text(tab.selected_sign_text);
+    }
+
+    ImGui::End();
+}
+
+void Application::draw_wire_networks_window()
+{
+    static constexpr const char* color_names[wire_color_count] = {"Red", "Blue", "Green", "Yellow"};
+
+    auto& tab = *m_current_tab;
+    bool open = true;
+    if (ImGui::Begin("Wire Networks", &open, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        for (size_t color = 0; color < wire_color_count; color++)
+        {
+            ImGui::Text("%s: %zu networks", color_names[color],
+                        tab.wires->network_count(static_cast<WireColor>(color)));
+        }
+
+        ImGui::Separator();
+
+        if (tab.selected_wire_network.has_value())
+        {
+            auto& selected = *tab.selected_wire_network;
+            ImGui::Text("%s network through %d, %d", color_names[static_cast<size_t>(selected.color)], selected.x,
+                        selected.y);
+            ImGui::Text("Tiles: %zu", selected.summary.tile_count);
+            ImGui::Text("Actuators: %zu", selected.summary.actuator_count);
+
+            if (ImGui::CollapsingHeader(String::formatted("{} Devices###Devices",
+                                                          selected.summary.device_tiles.size()).characters()))
+            {
+                for (auto& device : selected.summary.device_tiles)
+                {
+                    ImGui::Text("%s: %zu tiles", NameTable::tiles().name(device.key), device.value);
+                }
+            }
+        }
+        else
+        {
+            ImGui::TextUnformatted("Click on a wire to see its network");
+        }
     }
 
     ImGui::End();
+
+    if (!open)
+    {
+        tab.wires = {};
+        tab.selected_wire_network = {};
+    }
 }
 
 Application::Texture Application::load_texture(const RefPtr<Gfx::Bitmap>& bitmap)
@@ -824,16 +1862,39 @@ void Application::load_all_tile_texture_sheets()
         if (!image)
             continue;
 
-        m_tile_textures.set(i, load_texture(image));
+        auto texture = load_texture(image);
+        m_tile_textures.set(i, texture);
+        m_tile_map_renderer.set_tile_sheet(i, texture.gl_texture_id, texture.width, texture.height);
     }
 
     outln("Loaded {} tile texture sheets", m_tile_textures.size());
 
+    for (u16 i = 1; i < WallLayer::wall_count; i++)
+    {
+        auto image = Gfx::load_png(String::formatted("Content/images/Wall_{}.png", i));
+        if (!image)
+            continue;
+
+        m_wall_textures.set(i, load_texture(image));
+    }
+
+    outln("Loaded {} wall texture sheets", m_wall_textures.size());
+
     m_red_wire_texture = load_texture(Gfx::load_png("Content/images/Wires.png"));
     m_blue_wire_texture = load_texture(Gfx::load_png("Content/images/Wires2.png"));
     m_green_wire_texture = load_texture(Gfx::load_png("Content/images/Wires3.png"));
     m_yellow_wire_texture = load_texture(Gfx::load_png("Content/images/Wires4.png"));
     m_actuator_texture = load_texture(Gfx::load_png("Content/images/Actuator.png"));
+
+    auto set_extra_sheet = [&](auto sheet, auto& texture)
+    {
+        m_tile_map_renderer.set_extra_sheet(sheet, texture.gl_texture_id, texture.width, texture.height);
+    };
+    set_extra_sheet(TileMapRenderer::ExtraSheet::RedWire, m_red_wire_texture);
+    set_extra_sheet(TileMapRenderer::ExtraSheet::BlueWire, m_blue_wire_texture);
+    set_extra_sheet(TileMapRenderer::ExtraSheet::GreenWire, m_green_wire_texture);
+    set_extra_sheet(TileMapRenderer::ExtraSheet::YellowWire, m_yellow_wire_texture);
+    set_extra_sheet(TileMapRenderer::ExtraSheet::Actuator, m_actuator_texture);
 }
 
 
@@ -852,35 +1913,3 @@ void Application::load_all_item_texture_sheets()
 
     outln("Loaded {} item texture sheets", m_item_textures.size());
 }
-
-void Application::frame_region(i16 start_x, i16 start_y, i16 end_x, i16 end_y)
-{
-    for (i16 x = start_x; x < end_x; x++)
-    {
-        for (i16 y = start_y; y < end_y; y++)
-        {
-            auto& tile = m_current_world->tile_map()->at(x, y);
-            if (!tile.block().has_value())
-                continue;
-
-            auto& top = m_current_world->tile_map()->at(x, y - 1);
-            auto& bottom = m_current_world->tile_map()->at(x, y + 1);
-            auto& left = m_current_world->tile_map()->at(x - 1, y);
-            auto& right = m_current_world->tile_map()->at(x + 1, y);
-
-            auto frames = Terraria::Tile::Block::frame_for_block(tile, top, bottom, left, right);
-            if (frames.has_value())
-            {
-                tile.block()->frame_x() = frames->x;
-                tile.block()->frame_y() = frames->y;
-            }
-        }
-    }
-}
-
-void Application::frame_implicit_tiles()
-{
-    outln("Framing the world...");
-    // TODO: Properly frame the edges of the world (starting at 1 and subtracting 1 shouldn't really happen)
-    frame_region(1, 1, m_current_world->m_max_tiles_x - 1, m_current_world->m_max_tiles_y - 1);
-}
\ No newline at end of file
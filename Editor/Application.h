@@ -7,28 +7,44 @@
 #pragma once
 
 #include <AK/HashMap.h>
+#include <AK/NonnullOwnPtrVector.h>
 #include <LibTerraria/World.h>
 #include <SDL2/SDL_events.h>
 #include <LibGfx/Bitmap.h>
+#include <Editor/NameTable.h>
 #include <Editor/Object.h>
+#include <Editor/RenderThread.h>
+#include <Editor/TileMapRenderer.h>
+#include <Editor/WorldTab.h>
 
 class Application
 {
 public:
-    explicit Application(RefPtr<Terraria::World> world = {});
+    Application();
+
+    void open_world(NonnullRefPtr<Terraria::World>, String name);
 
     void process_event(SDL_Event*);
 
     void draw();
 
+    // Everything is loaded by the time there's a render thread, from then on all GL work happens there
+    void set_render_thread(RenderThread& render_thread)
+    { m_render_thread = &render_thread; }
+
     void set_selected_tile(int x, int y);
 
+    // Selects the tile, and moves the view so it's in the middle of the screen
+    void jump_to_tile(int x, int y);
+
 private:
     enum class Tool
     {
         Select,
         PlaceObject,
-        Paint
+        Paint,
+        PaintWall,
+        Liquid
     };
     struct Texture
     {
@@ -36,52 +52,118 @@ private:
         int width;
         int height;
     };
+    // What the user typed into a searchable combo box, and the ids that match it
+    struct ComboSearch
+    {
+        char text[64]{};
+        Vector<u16> ids;
+        bool needs_update{true};
+    };
+
+    // Painting (tiles or walls) collects every tile the mouse went over, and sends them all to the world thread
+    // once a frame
+    void begin_stroke(int x, int y);
+
+    // Adds every tile on the line from where the mouse last was, so fast strokes don't leave gaps
+    void continue_stroke(int x, int y);
+
+    void submit_stroke();
+
+    // What the liquid tool fills with, packed like LiquidLayer stores it
+    u8 liquid_to_fill() const;
 
-    void paint_tile(u16 x, u16 y);
+    // Clicking the same tile again picks the next color of wire on it
+    void select_wire_network_at(int x, int y);
+
+    void draw_wire_networks_window();
+
+    void update_hovered_tile(float screen_x, float screen_y);
 
     static Texture load_texture(const RefPtr<Gfx::Bitmap>&);
 
     void draw_main_menu_bar();
 
+    void draw_world_tabs();
+
+    void switch_to_tab(WorldTab*);
+
+    void close_tab(size_t index);
+
     void draw_tile_map();
 
-    void draw_tiles_combo_box(const StringView& preview, Function<void(Optional<int>)> on_select);
+    void draw_searchable_combo_box(const char* label, const char* preview, ComboSearch&, const NameTable&,
+                                   const HashMap<u16, Texture>&, bool first_frame_only,
+                                   Function<void(Optional<int>)> on_select);
+
+    void draw_tiles_combo_box(const char* preview, Function<void(Optional<int>)> on_select);
 
-    void draw_tile_properties(Terraria::Tile&);
+    void draw_items_combo_box(const char* preview, Function<void(Optional<int>)> on_select);
+
+    // Returns true if the tile was changed
+    bool draw_tile_properties(Terraria::Tile&);
 
     void draw_selection_window();
 
+    void draw_selected_object_properties();
+
     void draw_selected_chest_window();
 
+    // Every chest in the world, optionally only the ones with some item in them
+    void draw_chest_browser();
+
+    void draw_validation_window();
+
+    void draw_export_window();
+
+    // Loads another world, and shows how it's different from the current one
+    void compare_with_world(const String& path);
+
+    void draw_diff_window();
+
+    // Has the world thread run a Lua script on the current world, and frame whatever it changed
+    void run_script(const String& path);
+
+    // Picks up what the script printed, if it's done
+    void finish_script();
+
+    void draw_script_output_window();
+
     void draw_selected_sign_window();
 
     void load_all_tile_texture_sheets();
 
     void load_all_item_texture_sheets();
 
-    void frame_region(i16 x, i16 y, i16 end_x, i16 end_y);
-
-    void frame_implicit_tiles();
-
     Tool m_current_tool{};
 
+    // Texture sheets are shared by every open world, so opening another one costs nothing but the world itself
     HashMap<u16, Texture> m_tile_textures;
     HashMap<u16, Texture> m_item_textures;
-    RefPtr<Terraria::World> m_current_world;
+    HashMap<u16, Texture> m_wall_textures;
+    NonnullOwnPtrVector<WorldTab> m_tabs;
+    WorldTab* m_current_tab{};
+    u32 m_next_tab_id{};
     Texture m_red_wire_texture;
     Texture m_blue_wire_texture;
     Texture m_green_wire_texture;
     Texture m_yellow_wire_texture;
     Texture m_actuator_texture;
 
-    int m_offset_x{};
-    int m_offset_y{};
-    int m_hovered_visual_tile_x{};
-    int m_hovered_visual_tile_y{};
-    int m_selected_tile_x{};
-    int m_selected_tile_y{};
-    int m_tile_visual_size_x{16};
-    int m_tile_visual_size_y{16};
+    RenderThread* m_render_thread{};
+
+    // Only set up the first time it's turned on, since it needs a copy of every texture sheet
+    TileMapRenderer m_tile_map_renderer;
+    bool m_draw_tile_map_on_gpu{};
+
+    // The tile under the mouse
+    int m_hovered_tile_x{};
+    int m_hovered_tile_y{};
+
+    // Where the mouse is and which modifier keys are down, as far as the events we've been given say. A replay
+    // gives us the recorded events, so these never come from SDL itself, which only knows about the real ones.
+    int m_mouse_x{};
+    int m_mouse_y{};
+    u16 m_key_modifiers{};
 
     int m_selected_frame_x{};
     int m_selected_frame_y{};
@@ -90,15 +172,47 @@ private:
     int m_selected_object_style_x{};
     int m_selected_object_style_y{};
 
-    Terraria::Chest* m_selected_chest{};
-    char m_selected_chest_name[20]{};
+    // The slot being edited in the chest's popup
+    int m_selected_chest_slot{};
     i16 m_selected_chest_selected_item_stack{};
 
+    bool m_show_chest_browser{};
+    // Only chests with this in them are shown, if it's set
+    Optional<int> m_chest_browser_item;
+
+    ComboSearch m_tiles_combo_search;
+    ComboSearch m_items_combo_search;
+    ComboSearch m_objects_combo_search;
+
     Terraria::Tile m_tile_to_paint;
     bool m_paint_allow_drag{};
-
-    Terraria::Sign* m_selected_sign{};
-    char m_selected_sign_text[512]{};
+    // Where the stroke being painted is up to, if we're painting one
+    Optional<Gfx::IntPoint> m_stroke_end;
+    // Tiles painted this frame that haven't been sent to the world thread yet
+    Vector<Gfx::IntPoint> m_stroke_tiles;
+    int m_wall_to_paint{1};
+
+    // Walls are drawn in their own pass, which isn't even looked at when they're hidden
+    bool m_show_walls{true};
+    // Same goes for liquids, which are drawn over the blocks
+    bool m_show_liquids{true};
+
+    int m_liquid_type{};
+    // 0 drains instead
+    int m_liquid_amount{LiquidLayer::max_amount};
+    bool m_liquid_fill_basin{true};
+    // Where the region being dragged out started, if we're dragging one out
+    Optional<Gfx::IntPoint> m_liquid_region_start;
+
+    bool m_show_export_window{};
+    // x, y, width and height, in tiles
+    int m_export_region[4]{};
+    int m_export_tile_size{16};
+    bool m_export_draw_wires{true};
+
+    // What the last script printed
+    String m_script_output;
+    bool m_show_script_output{};
 
     bool m_tile_properties_has_red_wire{};
     bool m_tile_properties_has_blue_wire{};
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Noncopyable.h>
+#include <AK/Span.h>
+#include <AK/Vector.h>
+#include <AK/kmalloc.h>
+#include <type_traits>
+
+// Hands out memory from big blocks by just bumping a pointer along, and frees all of it at once when it's destroyed.
+// Nothing in it is ever destructed, so it only takes things that don't need to be.
+class Arena
+{
+    AK_MAKE_NONCOPYABLE(Arena);
+    AK_MAKE_NONMOVABLE(Arena);
+
+public:
+    static constexpr size_t block_size = 256 * 1024;
+
+    Arena() = default;
+
+    ~Arena()
+    {
+        for (auto* block : m_blocks)
+            kfree(block);
+    }
+
+    template<typename T>
+    Span<T> allocate(size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+        if (count == 0)
+            return {};
+
+        auto size = count * sizeof(T);
+        auto offset = (m_block_used + alignof(T) - 1) & ~(alignof(T) - 1);
+        if (m_blocks.is_empty() || offset + size > m_block_size)
+        {
+            // Anything bigger than a block gets a block of its own
+            m_block_size = max(block_size, size);
+            m_blocks.append(static_cast<u8*>(kmalloc(m_block_size)));
+            offset = 0;
+        }
+
+        m_block_used = offset + size;
+        m_used_bytes += size;
+        return {reinterpret_cast<T*>(m_blocks.last() + offset), count};
+    }
+
+    // Everything handed out so far, whether or not anybody is still using it
+    size_t used_bytes() const
+    { return m_used_bytes; }
+
+private:
+    Vector<u8*> m_blocks;
+    size_t m_block_size{};
+    size_t m_block_used{};
+    size_t m_used_bytes{};
+};
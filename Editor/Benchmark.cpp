@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/Format.h>
+#include <AK/Function.h>
+#include <Editor/Benchmark.h>
+#include <Editor/ChunkRenderCache.h>
+#include <Editor/FrameTable.h>
+#include <Editor/ObjectRecognizer.h>
+#include <chrono>
+
+static void measure(const char* name, Function<void()> callback)
+{
+    auto start = std::chrono::steady_clock::now();
+    callback();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    outln("{:>24}: {:.1} ms", name, elapsed.count());
+}
+
+void Benchmark::run(ChunkedTileMap& tiles)
+{
+    outln("{}x{} tiles, {} chunks", tiles.width(), tiles.height(), tiles.chunk_count());
+
+    // Everything is read without decompressing first, like the renderer and validator do
+    measure("Read every tile", [&]
+    {
+        size_t blocks = 0;
+        for (size_t chunk_index = 0; chunk_index < tiles.chunk_count(); chunk_index++)
+        {
+            tiles.for_each_tile_in_chunk(chunk_index, [&](auto, auto, auto& tile)
+            {
+                if (tile.block().has_value())
+                    blocks++;
+            });
+        }
+        outln("{} blocks", blocks);
+    });
+
+    measure("Build every chunk's sprites", [&]
+    {
+        ChunkRenderCache render_cache(tiles);
+        size_t sprites = 0;
+        for (size_t chunk_index = 0; chunk_index < tiles.chunk_count(); chunk_index++)
+        {
+            sprites += render_cache.sprites_for_chunk(chunk_index).size();
+            render_cache.invalidate_chunk(chunk_index);
+        }
+        outln("{} sprites", sprites);
+    });
+
+    measure("Recognize every object", [&]
+    {
+        ObjectRecognizer objects(tiles);
+        size_t recognized = 0;
+        for (auto y = 0; y < tiles.height(); y++)
+        {
+            for (auto x = 0; x < tiles.width(); x++)
+            {
+                if (objects.object_at(x, y).has_value())
+                    recognized++;
+            }
+        }
+        outln("{} object tiles", recognized);
+    });
+
+    measure("Decompress everything", [&]
+    {
+        for (size_t chunk_index = 0; chunk_index < tiles.chunk_count(); chunk_index++)
+        {
+            auto x = static_cast<int>(chunk_index % tiles.chunks_x()) * ChunkedTileMap::chunk_size;
+            auto y = static_cast<int>(chunk_index / tiles.chunks_x()) * ChunkedTileMap::chunk_size;
+            tiles.at(x, y);
+        }
+    });
+
+    // Both work out every block's frame without writing it, so they're asked about the same tiles, and should
+    // come up with the same frames
+    auto work_out_frames = [&](auto frame_for_block)
+    {
+        u64 checksum = 0;
+        for (auto y = 1; y < tiles.height() - 1; y++)
+        {
+            for (auto x = 1; x < tiles.width() - 1; x++)
+            {
+                auto& tile = tiles.at(x, y);
+                if (!tile.block().has_value())
+                    continue;
+
+                auto frame = frame_for_block(tile, tiles.at(x, y - 1), tiles.at(x, y + 1), tiles.at(x - 1, y),
+                                             tiles.at(x + 1, y));
+                if (frame.has_value())
+                    checksum = checksum * 31 + ((static_cast<u16>(frame->x) << 16) | static_cast<u16>(frame->y));
+            }
+        }
+        return checksum;
+    };
+
+    u64 worked_out_checksum = 0;
+    measure("Work out every frame", [&]
+    {
+        worked_out_checksum = work_out_frames([](auto&... tiles_to_frame)
+        {
+            return Terraria::Tile::Block::frame_for_block(tiles_to_frame...);
+        });
+    });
+
+    u64 looked_up_checksum = 0;
+    measure("Look up every frame", [&]
+    {
+        looked_up_checksum = work_out_frames([](auto&... tiles_to_frame)
+        {
+            return FrameTable::block_frame(tiles_to_frame...);
+        });
+    });
+
+    if (worked_out_checksum != looked_up_checksum)
+        outln("The frame table disagrees with LibTerraria!");
+
+    measure("Frame everything", [&]
+    {
+        tiles.frame_region(0, 0, tiles.width(), tiles.height());
+    });
+
+    measure("Rehash every chunk", [&]
+    {
+        tiles.update_chunk_hashes();
+    });
+
+    measure("Compress everything", [&]
+    {
+        tiles.compress_all();
+    });
+
+    outln("Fingerprint: {:016x}", tiles.fingerprint());
+    outln("Compressed chunks: {} KiB, in {} KiB of arenas", tiles.compressed_bytes() / 1024,
+          tiles.arena_bytes() / 1024);
+}
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <Editor/ChunkedTileMap.h>
+
+// Times the things the editor does to a whole world (or could have to, when it's big enough), printing how long
+// each one took. Meant for comparing before and after a change, on the same (probably generated) world.
+class Benchmark
+{
+public:
+    static void run(ChunkedTileMap&);
+};
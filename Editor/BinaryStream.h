@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Span.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+
+// Reads and writes the files the editor makes itself (like patches and input recordings), where everything is little
+// endian, and strings are their length and then their characters.
+class BinaryWriter
+{
+public:
+    template<typename T>
+    void write(T value)
+    {
+        for (size_t i = 0; i < sizeof(T); i++)
+            m_bytes.append(static_cast<u8>(static_cast<u64>(value) >> (i * 8)));
+    }
+
+    void write_string(const String& string)
+    {
+        write<u32>(string.length());
+        m_bytes.append(reinterpret_cast<const u8*>(string.characters()), string.length());
+    }
+
+    const Vector<u8>& bytes() const
+    { return m_bytes; }
+
+    // Starts over, keeping the memory around for whatever gets written next
+    void clear()
+    { m_bytes.clear_with_capacity(); }
+
+private:
+    Vector<u8> m_bytes;
+};
+
+class BinaryReader
+{
+public:
+    explicit BinaryReader(ReadonlyBytes bytes)
+            : m_bytes(bytes)
+    {
+    }
+
+    template<typename T>
+    bool read(T& value)
+    {
+        if (m_offset + sizeof(T) > m_bytes.size())
+            return false;
+
+        u64 raw_value = 0;
+        for (size_t i = 0; i < sizeof(T); i++)
+            raw_value |= static_cast<u64>(m_bytes[m_offset++]) << (i * 8);
+
+        value = static_cast<T>(raw_value);
+        return true;
+    }
+
+    bool read_string(String& string)
+    {
+        u32 length;
+        if (!read(length) || m_offset + length > m_bytes.size())
+            return false;
+
+        string = String(reinterpret_cast<const char*>(m_bytes.offset_pointer(m_offset)), length);
+        m_offset += length;
+        return true;
+    }
+
+    bool is_at_end() const
+    { return m_offset == m_bytes.size(); }
+
+    size_t offset() const
+    { return m_offset; }
+
+private:
+    ReadonlyBytes m_bytes;
+    size_t m_offset{};
+};
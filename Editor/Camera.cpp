@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/Camera.h>
+#include <math.h>
+
+// How quickly a fling slows down, the velocity is multiplied by e^(-friction) every second
+static constexpr float friction = 6.0f;
+
+// Below this many pixels a second we just stop, instead of crawling along forever
+static constexpr float min_velocity = 5.0f;
+
+// If you stop moving the mouse for this long before letting go, you wanted to stop there, not fling
+static constexpr float max_fling_pause = 0.1f;
+
+void Camera::set_position(float x, float y)
+{
+    m_x = x;
+    m_y = y;
+    clamp_position();
+}
+
+void Camera::set_zoom(float zoom)
+{
+    m_zoom = clamp(zoom, min_zoom, max_zoom);
+    clamp_position();
+}
+
+void Camera::set_world_size(int width, int height)
+{
+    m_world_width = width;
+    m_world_height = height;
+    clamp_position();
+}
+
+void Camera::set_viewport_size(float width, float height)
+{
+    m_viewport_width = width;
+    m_viewport_height = height;
+}
+
+void Camera::pan_by_pixels(float x, float y)
+{
+    set_position(m_x + (x / m_zoom), m_y + (y / m_zoom));
+}
+
+void Camera::zoom_at(float screen_x, float screen_y, float factor)
+{
+    auto anchor = screen_to_tile(screen_x, screen_y);
+    m_zoom = clamp(m_zoom * factor, min_zoom, max_zoom);
+    set_position(anchor.x() - (screen_x / m_zoom), anchor.y() - (screen_y / m_zoom));
+}
+
+void Camera::center_on(float tile_x, float tile_y)
+{
+    set_position(tile_x - (m_viewport_width / m_zoom / 2.0f), tile_y - (m_viewport_height / m_zoom / 2.0f));
+}
+
+void Camera::fling(float velocity_x, float velocity_y)
+{
+    m_velocity_x = velocity_x;
+    m_velocity_y = velocity_y;
+}
+
+void Camera::glide_by_tiles(float x, float y)
+{
+    // Slowing down by friction, a fling covers exactly velocity / friction pixels. Adding to the velocity we already
+    // have means scrolling a few times quickly keeps speeding us up.
+    fling(m_velocity_x + (x * m_zoom * friction), m_velocity_y + (y * m_zoom * friction));
+}
+
+void Camera::begin_drag(float screen_x, float screen_y, float time)
+{
+    m_is_dragging = true;
+    m_drag_last_x = screen_x;
+    m_drag_last_y = screen_y;
+    m_drag_last_time = time;
+    m_velocity_x = 0;
+    m_velocity_y = 0;
+}
+
+void Camera::drag_to(float screen_x, float screen_y, float time)
+{
+    if (!m_is_dragging)
+        return;
+
+    auto delta_x = m_drag_last_x - screen_x;
+    auto delta_y = m_drag_last_y - screen_y;
+    pan_by_pixels(delta_x, delta_y);
+
+    // Mouse events come in unevenly, so smooth the velocity out a bit so one odd event doesn't decide the fling
+    auto delta_time = time - m_drag_last_time;
+    if (delta_time > 0)
+    {
+        m_velocity_x = (m_velocity_x * 0.5f) + ((delta_x / delta_time) * 0.5f);
+        m_velocity_y = (m_velocity_y * 0.5f) + ((delta_y / delta_time) * 0.5f);
+    }
+
+    m_drag_last_x = screen_x;
+    m_drag_last_y = screen_y;
+    m_drag_last_time = time;
+}
+
+void Camera::end_drag(float time)
+{
+    m_is_dragging = false;
+    if (time - m_drag_last_time > max_fling_pause)
+        fling(0, 0);
+}
+
+void Camera::update(float delta_time)
+{
+    // While dragging the velocity is only being measured, the mouse is what moves us
+    if (m_is_dragging || (m_velocity_x == 0 && m_velocity_y == 0))
+        return;
+
+    pan_by_pixels(m_velocity_x * delta_time, m_velocity_y * delta_time);
+
+    auto decay = expf(-friction * delta_time);
+    m_velocity_x *= decay;
+    m_velocity_y *= decay;
+
+    if (fabsf(m_velocity_x) < min_velocity && fabsf(m_velocity_y) < min_velocity)
+        fling(0, 0);
+}
+
+Gfx::FloatPoint Camera::screen_to_tile(float screen_x, float screen_y) const
+{
+    return {m_x + (screen_x / m_zoom), m_y + (screen_y / m_zoom)};
+}
+
+Gfx::FloatPoint Camera::tile_to_screen(float tile_x, float tile_y) const
+{
+    // Snapped to whole pixels, so neighbouring tiles always meet exactly, whatever the zoom
+    return {floorf((tile_x - m_x) * m_zoom), floorf((tile_y - m_y) * m_zoom)};
+}
+
+Camera::Range Camera::visible_tiles() const
+{
+    Range range{};
+    range.start_x = clamp(static_cast<int>(floorf(m_x)), 0, m_world_width);
+    range.start_y = clamp(static_cast<int>(floorf(m_y)), 0, m_world_height);
+    range.end_x = clamp(static_cast<int>(ceilf(m_x + (m_viewport_width / m_zoom))), 0, m_world_width);
+    range.end_y = clamp(static_cast<int>(ceilf(m_y + (m_viewport_height / m_zoom))), 0, m_world_height);
+    return range;
+}
+
+Camera::Range Camera::visible_chunks(int chunk_size) const
+{
+    auto tiles = visible_tiles();
+    return {tiles.start_x / chunk_size, tiles.start_y / chunk_size, (tiles.end_x + chunk_size - 1) / chunk_size,
+            (tiles.end_y + chunk_size - 1) / chunk_size};
+}
+
+void Camera::clamp_position()
+{
+    // Allow going up to half a screen past the edges, it's nice to be able to see where the world ends
+    auto margin_x = m_viewport_width / m_zoom / 2.0f;
+    auto margin_y = m_viewport_height / m_zoom / 2.0f;
+    m_x = clamp(m_x, -margin_x, max(static_cast<float>(m_world_width) - margin_x, -margin_x));
+    m_y = clamp(m_y, -margin_y, max(static_cast<float>(m_world_height) - margin_y, -margin_y));
+
+    // If we're pushed against an edge, we aren't going anywhere
+    if (m_x == -margin_x || m_x == static_cast<float>(m_world_width) - margin_x)
+        m_velocity_x = 0;
+    if (m_y == -margin_y || m_y == static_cast<float>(m_world_height) - margin_y)
+        m_velocity_y = 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <LibGfx/Point.h>
+
+// Where we're looking at a world from. The position is the tile at the top left of the screen (fractional, so we can
+// be anywhere inside of a tile), and zoom is how many pixels wide a tile is on screen.
+class Camera
+{
+public:
+    // A range of tiles (or chunks), the end is exclusive
+    struct Range
+    {
+        int start_x;
+        int start_y;
+        int end_x;
+        int end_y;
+    };
+
+    static constexpr float min_zoom = 1.0f;
+    static constexpr float max_zoom = 128.0f;
+
+    float x() const
+    { return m_x; }
+
+    float y() const
+    { return m_y; }
+
+    float zoom() const
+    { return m_zoom; }
+
+    void set_position(float x, float y);
+
+    void set_zoom(float zoom);
+
+    // The world is kept (mostly) on screen, we never let you wander off into nothing
+    void set_world_size(int width, int height);
+
+    void set_viewport_size(float width, float height);
+
+    float viewport_width() const
+    { return m_viewport_width; }
+
+    float viewport_height() const
+    { return m_viewport_height; }
+
+    void pan_by_pixels(float x, float y);
+
+    // Zooms by the factor, keeping whatever tile is under the given point of the screen under it
+    void zoom_at(float screen_x, float screen_y, float factor);
+
+    void center_on(float tile_x, float tile_y);
+
+    // Keep moving this fast (in pixels a second), slowing down over time
+    void fling(float velocity_x, float velocity_y);
+
+    // Fling just hard enough to end up this many tiles further along
+    void glide_by_tiles(float x, float y);
+
+    // Dragging moves the camera with the mouse, and letting go flings it along at whatever speed you were going.
+    // Times are in seconds, counted from whenever you like.
+    void begin_drag(float screen_x, float screen_y, float time);
+
+    void drag_to(float screen_x, float screen_y, float time);
+
+    void end_drag(float time);
+
+    bool is_dragging() const
+    { return m_is_dragging; }
+
+    // Call this once a frame, with how long the frame took in seconds
+    void update(float delta_time);
+
+    Gfx::FloatPoint screen_to_tile(float screen_x, float screen_y) const;
+
+    Gfx::FloatPoint tile_to_screen(float tile_x, float tile_y) const;
+
+    // Every tile that's at least partly on screen, clipped to the world
+    Range visible_tiles() const;
+
+    // Every chunk that's at least partly on screen
+    Range visible_chunks(int chunk_size) const;
+
+private:
+    void clamp_position();
+
+    float m_x{};
+    float m_y{};
+    float m_zoom{16.0f};
+
+    int m_world_width{};
+    int m_world_height{};
+    float m_viewport_width{};
+    float m_viewport_height{};
+
+    float m_velocity_x{};
+    float m_velocity_y{};
+
+    bool m_is_dragging{};
+    float m_drag_last_x{};
+    float m_drag_last_y{};
+    float m_drag_last_time{};
+};
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/QuickSort.h>
+#include <AK/StringBuilder.h>
+#include <Editor/ChestIndex.h>
+#include <Editor/NameTable.h>
+
+// How many different items a summary names before it just says how many more there are
+static constexpr size_t summarized_items = 3;
+
+int ChestIndex::slot_count(Terraria::Chest& chest)
+{
+    auto slots = default_slot_count;
+    for (auto& kv : chest.contents())
+        slots = max(slots, static_cast<int>(kv.key) + 1);
+    return slots;
+}
+
+ChestIndex::ChestIndex(Terraria::World& world)
+        : m_world(world)
+{
+}
+
+const Vector<ChestIndex::Entry>& ChestIndex::entries()
+{
+    rebuild_if_stale();
+    return m_entries;
+}
+
+Span<const size_t> ChestIndex::entries_with_item(u16 item_id)
+{
+    rebuild_if_stale();
+    auto entries = m_entries_by_item.find(item_id);
+    if (entries == m_entries_by_item.end())
+        return {};
+
+    return entries->value.span();
+}
+
+void ChestIndex::rebuild_if_stale()
+{
+    if (!m_is_stale)
+        return;
+
+    m_entries.clear();
+    m_entries_by_item.clear();
+
+    for (auto& kv : m_world.chests())
+    {
+        auto position = kv.value.position();
+        m_entries.append({&kv.value, position.x(), position.y(), {}, {}});
+    }
+
+    // The chests came out of a hash map, so put them in an order that makes sense to look through
+    quick_sort(m_entries, [](auto& a, auto& b)
+    {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        auto& entry = m_entries[i];
+        auto& chest = *entry.chest;
+        entry.position = String::formatted("{}, {}", entry.x, entry.y);
+
+        // How many of each item, in the order they first show up
+        Vector<u16> item_ids;
+        HashMap<u16, int> stacks;
+        auto slots = slot_count(chest);
+        for (auto slot = 0; slot < slots; slot++)
+        {
+            auto item = chest.contents().get(slot);
+            if (!item.has_value())
+                continue;
+
+            auto id = static_cast<u16>(item->id());
+            if (!stacks.contains(id))
+            {
+                item_ids.append(id);
+                m_entries_by_item.ensure(id).append(i);
+            }
+            stacks.ensure(id) += item->stack();
+        }
+
+        if (item_ids.is_empty())
+        {
+            entry.summary = "Empty";
+            continue;
+        }
+
+        StringBuilder summary;
+        for (size_t j = 0; j < min(item_ids.size(), summarized_items); j++)
+        {
+            if (j > 0)
+                summary.append(", ");
+            summary.appendff("{} x{}", NameTable::items().name(item_ids[j]), *stacks.get(item_ids[j]));
+        }
+
+        if (item_ids.size() > summarized_items)
+            summary.appendff(", and {} more", item_ids.size() - summarized_items);
+
+        entry.summary = summary.to_string();
+    }
+
+    m_is_stale = false;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/HashMap.h>
+#include <AK/Span.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <LibTerraria/World.h>
+
+// Every chest in a world, sorted by position, with what's in them already summed up and written out so a list of
+// thousands of them only has to draw the rows we can see. Chests are also indexed by the items in them, so finding
+// every chest with some item in it is just a lookup.
+// Nothing notices when a chest changes, so invalidate() this whenever one might have, and it'll be rebuilt the next
+// time anybody looks at it.
+class ChestIndex
+{
+public:
+    // How many slots the game gives a chest
+    static constexpr int default_slot_count = 40;
+
+    // Worlds don't say how many slots a chest has, so this is as many as the game gives one, or more if there's an
+    // item in a slot past those
+    static int slot_count(Terraria::Chest&);
+
+    struct Entry
+    {
+        Terraria::Chest* chest;
+        int x;
+        int y;
+        String position;
+        // Like "Torch x99, Wood x20, and 3 more"
+        String summary;
+    };
+
+    explicit ChestIndex(Terraria::World&);
+
+    void invalidate()
+    { m_is_stale = true; }
+
+    const Vector<Entry>& entries();
+
+    // Which entries have the item in them, in order
+    Span<const size_t> entries_with_item(u16 item_id);
+
+private:
+    void rebuild_if_stale();
+
+    Terraria::World& m_world;
+    Vector<Entry> m_entries;
+    HashMap<u16, Vector<size_t>> m_entries_by_item;
+    bool m_is_stale{true};
+};
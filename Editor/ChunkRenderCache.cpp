@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/ChunkRenderCache.h>
+#include <Editor/FrameTable.h>
+
+ChunkRenderCache::ChunkRenderCache(const ChunkedTileMap& tiles)
+        : m_tiles(tiles)
+{
+}
+
+const Vector<ChunkRenderCache::Sprite>& ChunkRenderCache::sprites_for_chunk(size_t chunk_index)
+{
+    auto it = m_chunks.find(chunk_index);
+    if (it == m_chunks.end())
+    {
+        Vector<Sprite> sprites;
+        build_chunk(chunk_index, sprites);
+        m_chunks.set(chunk_index, move(sprites));
+        it = m_chunks.find(chunk_index);
+    }
+
+    return it->value;
+}
+
+void ChunkRenderCache::invalidate_chunk(size_t chunk_index)
+{
+    // Wires are framed from their neighbours, so a change on the edge of a chunk can change how the next one looks
+    auto chunk_x = static_cast<int>(chunk_index % m_tiles.chunks_x());
+    auto chunk_y = static_cast<int>(chunk_index / m_tiles.chunks_x());
+    m_chunks.remove(chunk_index);
+
+    if (chunk_x > 0)
+        m_chunks.remove(chunk_index - 1);
+    if (chunk_x < m_tiles.chunks_x() - 1)
+        m_chunks.remove(chunk_index + 1);
+    if (chunk_y > 0)
+        m_chunks.remove(chunk_index - m_tiles.chunks_x());
+    if (chunk_y < m_tiles.chunks_y() - 1)
+        m_chunks.remove(chunk_index + m_tiles.chunks_x());
+}
+
+void ChunkRenderCache::evict_chunks_outside(const Camera::Range& visible_chunks)
+{
+    Vector<size_t> chunks_to_evict;
+    for (auto& kv : m_chunks)
+    {
+        auto chunk_x = static_cast<int>(kv.key % m_tiles.chunks_x());
+        auto chunk_y = static_cast<int>(kv.key / m_tiles.chunks_x());
+        if (chunk_x < visible_chunks.start_x - 1 || chunk_x > visible_chunks.end_x ||
+            chunk_y < visible_chunks.start_y - 1 || chunk_y > visible_chunks.end_y)
+        {
+            chunks_to_evict.append(kv.key);
+        }
+    }
+
+    for (auto chunk_index : chunks_to_evict)
+        m_chunks.remove(chunk_index);
+}
+
+void ChunkRenderCache::build_chunk(size_t chunk_index, Vector<Sprite>& sprites) const
+{
+    constexpr int chunk_size = ChunkedTileMap::chunk_size;
+    auto start_x = static_cast<int>(chunk_index % m_tiles.chunks_x()) * chunk_size;
+    auto start_y = static_cast<int>(chunk_index / m_tiles.chunks_x()) * chunk_size;
+    auto width = min(chunk_size, m_tiles.width() - start_x);
+    auto height = min(chunk_size, m_tiles.height() - start_y);
+
+    // The chunk with a border of one tile around it, so wires on the edge can see their neighbours
+    auto padded_width = width + 2;
+    Vector<Terraria::Tile> tiles;
+    tiles.resize(padded_width * (height + 2));
+
+    auto set_tile = [&](int x, int y, const Terraria::Tile& tile)
+    {
+        tiles[(x - start_x + 1) + (padded_width * (y - start_y + 1))] = tile;
+    };
+
+    m_tiles.for_each_tile_in_chunk(chunk_index, set_tile);
+    for (auto x = start_x - 1; x <= start_x + width; x++)
+    {
+        set_tile(x, start_y - 1, m_tiles.tile_at(x, start_y - 1));
+        set_tile(x, start_y + height, m_tiles.tile_at(x, start_y + height));
+    }
+    for (auto y = start_y; y < start_y + height; y++)
+    {
+        set_tile(start_x - 1, y, m_tiles.tile_at(start_x - 1, y));
+        set_tile(start_x + width, y, m_tiles.tile_at(start_x + width, y));
+    }
+
+    for (auto y = 0; y < height; y++)
+    {
+        for (auto x = 0; x < width; x++)
+        {
+            auto index = (x + 1) + (padded_width * (y + 1));
+            auto& tile = tiles[index];
+            auto local_x = static_cast<u8>(x);
+            auto local_y = static_cast<u8>(y);
+
+            if (tile.block().has_value())
+            {
+                auto& block = *tile.block();
+                sprites.append({local_x, local_y, Sprite::Sheet::Tile, static_cast<u16>(block.id()),
+                                block.frame_x().has_value() ? *block.frame_x() : static_cast<i16>(0),
+                                block.frame_y().has_value() ? *block.frame_y() : static_cast<i16>(0),
+                                tile.is_actuated() ? 0x5fffffffu : 0xffffffffu});
+            }
+
+            auto& top = tiles[index - padded_width];
+            auto& bottom = tiles[index + padded_width];
+            auto& left = tiles[index - 1];
+            auto& right = tiles[index + 1];
+
+            auto add_wire = [&](Sprite::Sheet sheet, auto has_wire)
+            {
+                if (!has_wire(tile))
+                    return;
+
+                auto frame = FrameTable::wire_frame(FrameTable::wire_neighbours(has_wire(top), has_wire(bottom),
+                                                                                has_wire(left), has_wire(right)));
+                sprites.append({local_x, local_y, sheet, 0, frame.x, frame.y, 0x7fffffff});
+            };
+
+            add_wire(Sprite::Sheet::RedWire, [](auto& wire_tile) { return wire_tile.has_red_wire(); });
+            add_wire(Sprite::Sheet::BlueWire, [](auto& wire_tile) { return wire_tile.has_blue_wire(); });
+            add_wire(Sprite::Sheet::GreenWire, [](auto& wire_tile) { return wire_tile.has_green_wire(); });
+            add_wire(Sprite::Sheet::YellowWire, [](auto& wire_tile) { return wire_tile.has_yellow_wire(); });
+
+            if (tile.has_actuator())
+                sprites.append({local_x, local_y, Sprite::Sheet::Actuator, 0, 0, 0, 0x7fffffff});
+        }
+    }
+}
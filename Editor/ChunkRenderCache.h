@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/HashMap.h>
+#include <AK/Vector.h>
+#include <Editor/Camera.h>
+#include <Editor/ChunkedTileMap.h>
+
+// What has to be drawn for every tile of a chunk, worked out once when the chunk comes into view (or changes), so
+// drawing a frame never has to look at the tiles themselves. Chunks are read without decompressing them, so just
+// looking around a world doesn't make it any bigger in memory.
+class ChunkRenderCache
+{
+public:
+    struct Sprite
+    {
+        enum class Sheet : u8
+        {
+            Tile,
+            RedWire,
+            BlueWire,
+            GreenWire,
+            YellowWire,
+            Actuator,
+        };
+
+        // Position within the chunk
+        u8 x;
+        u8 y;
+        Sheet sheet;
+        // Which tile sheet, for Sheet::Tile
+        u16 id;
+        i16 frame_x;
+        i16 frame_y;
+        u32 color;
+    };
+
+    explicit ChunkRenderCache(const ChunkedTileMap&);
+
+    // The tile map must not be written to while this is running
+    const Vector<Sprite>& sprites_for_chunk(size_t chunk_index);
+
+    void invalidate_chunk(size_t chunk_index);
+
+    // Forget about every chunk that's not in (or right next to) this range of chunks, so memory use only depends
+    // on how much we can see at once
+    void evict_chunks_outside(const Camera::Range& visible_chunks);
+
+private:
+    void build_chunk(size_t chunk_index, Vector<Sprite>&) const;
+
+    const ChunkedTileMap& m_tiles;
+    HashMap<size_t, Vector<Sprite>> m_chunks;
+};
@@ -0,0 +1,559 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/Atomic.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/FrameTable.h>
+#include <thread>
+
+// How many compressed chunks' tiles we keep around to decompress into, instead of allocating new ones
+static constexpr size_t max_spare_tiles = 64;
+// The arenas are only compacted once at least this much of them is garbage, and more of them is garbage than isn't
+static constexpr size_t min_garbage_bytes_to_compact = 4 * 1024 * 1024;
+
+static u64 mix(u64 value)
+{
+    // The splitmix64 finalizer, good enough that similar keys end up nowhere near each other
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111eb;
+    value ^= value >> 31;
+    return value;
+}
+
+ChunkedTileMap::ChunkedTileMap(u16 width, u16 height)
+        : m_width(width),
+          m_height(height),
+          m_chunks_x((width + chunk_size - 1) / chunk_size),
+          m_chunks_y((height + chunk_size - 1) / chunk_size)
+{
+    m_chunks.resize(m_chunks_x * m_chunks_y);
+    m_arenas.append(make<Arena>());
+
+    for (size_t i = 0; i < m_chunks.size(); i++)
+    {
+        auto& chunk = m_chunks[i];
+        chunk.palette = m_arenas.first()->allocate<u64>(1);
+        chunk.palette[0] = key_for_tile({});
+        chunk.runs = m_arenas.first()->allocate<Run>(1);
+        chunk.runs[0] = {0, static_cast<u16>(chunk_width(i) * chunk_height(i))};
+        chunk.hash = compute_chunk_hash(i);
+        m_fingerprint ^= chunk.hash;
+        m_compressed_bytes += chunk.compressed_bytes();
+    }
+}
+
+NonnullOwnPtr<ChunkedTileMap> ChunkedTileMap::create_from_world(Terraria::World& world)
+{
+    auto tile_map = make<ChunkedTileMap>(world.m_max_tiles_x, world.m_max_tiles_y);
+    auto& map = *tile_map;
+
+    // The empty chunks we were made with are about to be replaced, so start the arenas over
+    auto thread_count = max(std::thread::hardware_concurrency(), 1u);
+    map.m_arenas.clear();
+    for (auto i = 0u; i < thread_count; i++)
+        map.m_arenas.append(make<Arena>());
+
+    // Every chunk is copied, compressed and hashed on its own, so spread them over every core we have. Threads just
+    // grab the next chunk nobody has taken yet, as some chunks take a lot longer to compress than others. Each one
+    // copies tiles into the same buffer every time, and compresses into its own arena.
+    Atomic<size_t> next_chunk{0};
+    auto build_chunks = [&](size_t thread_index)
+    {
+        auto& arena = *map.m_arenas[thread_index];
+        Vector<Terraria::Tile> tiles;
+        tiles.ensure_capacity(chunk_size * chunk_size);
+        for (;;)
+        {
+            auto i = next_chunk.fetch_add(1);
+            if (i >= map.m_chunks.size())
+                return;
+
+            auto& chunk = map.m_chunks[i];
+            auto start_x = (i % map.m_chunks_x) * chunk_size;
+            auto start_y = (i / map.m_chunks_x) * chunk_size;
+            auto width = map.chunk_width(i);
+            auto height = map.chunk_height(i);
+
+            tiles.clear_with_capacity();
+            for (auto y = 0; y < height; y++)
+            {
+                for (auto x = 0; x < width; x++)
+                    tiles.unchecked_append(world.tile_map()->at(start_x + x, start_y + y));
+            }
+
+            compress_tiles(chunk, tiles.span(), arena);
+            chunk.hash = map.compute_chunk_hash(i);
+        }
+    };
+
+    Vector<std::thread> threads;
+    for (auto i = 1u; i < thread_count; i++)
+        threads.append(std::thread(build_chunks, i));
+
+    build_chunks(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    map.m_fingerprint = 0;
+    map.m_compressed_bytes = 0;
+    for (auto& chunk : map.m_chunks)
+    {
+        map.m_fingerprint ^= chunk.hash;
+        map.m_compressed_bytes += chunk.compressed_bytes();
+    }
+
+    return tile_map;
+}
+
+NonnullOwnPtr<ChunkedTileMap> ChunkedTileMap::clone() const
+{
+    auto tile_map = make<ChunkedTileMap>(m_width, m_height);
+    for (size_t i = 0; i < m_chunks.size(); i++)
+        tile_map->replace_chunk(i, snapshot_chunk(i));
+
+    return tile_map;
+}
+
+u16 ChunkedTileMap::chunk_width(size_t chunk_index) const
+{
+    auto start_x = (chunk_index % m_chunks_x) * chunk_size;
+    return static_cast<u16>(min<size_t>(chunk_size, m_width - start_x));
+}
+
+u16 ChunkedTileMap::chunk_height(size_t chunk_index) const
+{
+    auto start_y = (chunk_index / m_chunks_x) * chunk_size;
+    return static_cast<u16>(min<size_t>(chunk_size, m_height - start_y));
+}
+
+ChunkedTileMap::Chunk& ChunkedTileMap::resident_chunk_for_position(u16 x, u16 y)
+{
+    auto& chunk = m_chunks[chunk_index_for_position(x, y)];
+    if (!chunk.is_resident())
+        decompress(chunk);
+
+    return chunk;
+}
+
+Terraria::Tile& ChunkedTileMap::at(int x, int y)
+{
+    if (!contains(x, y))
+    {
+        m_out_of_bounds_tile = {};
+        return m_out_of_bounds_tile;
+    }
+
+    auto& chunk = resident_chunk_for_position(x, y);
+    if (!chunk.hash_is_stale)
+    {
+        chunk.hash_is_stale = true;
+        m_stale_chunks.append(chunk_index_for_position(x, y));
+    }
+
+    auto local_x = x % chunk_size;
+    auto local_y = y % chunk_size;
+    return chunk.tiles[local_x + (chunk_width(chunk_index_for_position(x, y)) * local_y)];
+}
+
+Terraria::Tile ChunkedTileMap::tile_at(int x, int y) const
+{
+    if (!contains(x, y))
+        return {};
+
+    auto chunk_index = chunk_index_for_position(x, y);
+    auto& chunk = m_chunks[chunk_index];
+    auto index = (x % chunk_size) + (chunk_width(chunk_index) * (y % chunk_size));
+
+    if (chunk.is_resident())
+        return chunk.tiles[index];
+
+    for (auto& run : chunk.runs)
+    {
+        if (index < run.length)
+            return tile_for_key(chunk.palette[run.palette_index]);
+
+        index -= run.length;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+void ChunkedTileMap::for_each_tile_in_chunk(size_t chunk_index,
+                                            Function<void(int x, int y, const Terraria::Tile&)> callback) const
+{
+    auto& chunk = m_chunks[chunk_index];
+    auto start_x = (chunk_index % m_chunks_x) * chunk_size;
+    auto start_y = (chunk_index / m_chunks_x) * chunk_size;
+    auto width = chunk_width(chunk_index);
+
+    size_t index = 0;
+    auto visit = [&](const Terraria::Tile& tile)
+    {
+        callback(start_x + (index % width), start_y + (index / width), tile);
+        index++;
+    };
+
+    if (chunk.is_resident())
+    {
+        for (auto& tile : chunk.tiles)
+            visit(tile);
+        return;
+    }
+
+    for (auto& run : chunk.runs)
+    {
+        auto tile = tile_for_key(chunk.palette[run.palette_index]);
+        for (auto i = 0; i < run.length; i++)
+            visit(tile);
+    }
+}
+
+void ChunkedTileMap::frame_region(int start_x, int start_y, int end_x, int end_y)
+{
+    for (auto x = start_x; x < end_x; x++)
+    {
+        for (auto y = start_y; y < end_y; y++)
+        {
+            auto& tile = at(x, y);
+            if (!tile.block().has_value())
+                continue;
+
+            auto& top = at(x, y - 1);
+            auto& bottom = at(x, y + 1);
+            auto& left = at(x - 1, y);
+            auto& right = at(x + 1, y);
+
+            auto frame = FrameTable::block_frame(tile, top, bottom, left, right);
+            if (frame.has_value())
+            {
+                tile.block()->frame_x() = frame->x;
+                tile.block()->frame_y() = frame->y;
+            }
+        }
+    }
+}
+
+void ChunkedTileMap::compress_all()
+{
+    for (auto& chunk : m_chunks)
+    {
+        if (chunk.is_resident())
+            compress(chunk);
+    }
+}
+
+void ChunkedTileMap::compress(Chunk& chunk)
+{
+    VERIFY(chunk.is_resident());
+    compress_tiles(chunk, chunk.tiles.span(), *m_arenas.first());
+    m_compressed_bytes += chunk.compressed_bytes();
+    drop_tiles(chunk);
+    compact_arenas_if_needed();
+}
+
+void ChunkedTileMap::drop_tiles(Chunk& chunk)
+{
+    chunk.tiles.clear_with_capacity();
+    if (m_spare_tiles.size() < max_spare_tiles)
+        m_spare_tiles.append(move(chunk.tiles));
+    else
+        chunk.tiles.clear();
+
+    m_resident_chunks--;
+}
+
+void ChunkedTileMap::compact_arenas_if_needed()
+{
+    if (arena_bytes() - m_compressed_bytes >= max(min_garbage_bytes_to_compact, m_compressed_bytes))
+        compact_arenas();
+}
+
+void ChunkedTileMap::compress_tiles(Chunk& chunk, Span<const Terraria::Tile> tiles, Arena& arena)
+{
+    compress_tiles(tiles, [&](Span<const u64> palette, Span<const Run> runs)
+    {
+        chunk.palette = arena.allocate<u64>(palette.size());
+        palette.copy_to(chunk.palette);
+        chunk.runs = arena.allocate<Run>(runs.size());
+        runs.copy_to(chunk.runs);
+    });
+}
+
+template<typename Callback>
+void ChunkedTileMap::compress_tiles(Span<const Terraria::Tile> tiles, Callback callback)
+{
+    // Everything is worked out on the stack first, since we don't know how big the palette and runs will be until
+    // we're done. The palette is looked up through a little open addressed hash table, which holds palette indices
+    // plus one, with 0 meaning the slot is free.
+    static constexpr size_t max_tiles = chunk_size * chunk_size;
+    static constexpr size_t table_size = max_tiles * 2;
+    u64 palette[max_tiles];
+    Run runs[max_tiles];
+    u16 table[table_size]{};
+    size_t palette_size = 0;
+    size_t run_count = 0;
+
+    Optional<u64> last_key;
+    for (auto& tile : tiles)
+    {
+        auto key = key_for_tile(tile);
+        if (last_key.has_value() && *last_key == key)
+        {
+            runs[run_count - 1].length++;
+            continue;
+        }
+
+        auto slot = mix(key) & (table_size - 1);
+        while (table[slot] != 0 && palette[table[slot] - 1] != key)
+            slot = (slot + 1) & (table_size - 1);
+
+        if (table[slot] == 0)
+        {
+            palette[palette_size] = key;
+            table[slot] = static_cast<u16>(++palette_size);
+        }
+
+        runs[run_count++] = {static_cast<u16>(table[slot] - 1), 1};
+        last_key = key;
+    }
+
+    callback(Span<const u64>(palette, palette_size), Span<const Run>(runs, run_count));
+}
+
+ChunkedTileMap::ChunkSnapshot ChunkedTileMap::snapshot_chunk(size_t chunk_index) const
+{
+    auto& chunk = m_chunks[chunk_index];
+    ChunkSnapshot snapshot;
+    snapshot.hash = chunk_hash(chunk_index);
+
+    auto copy = [&](Span<const u64> palette, Span<const Run> runs)
+    {
+        snapshot.palette.append(palette.data(), palette.size());
+        snapshot.runs.append(runs.data(), runs.size());
+    };
+
+    if (chunk.is_resident())
+        compress_tiles(chunk.tiles.span(), copy);
+    else
+        copy(chunk.palette, chunk.runs);
+
+    return snapshot;
+}
+
+void ChunkedTileMap::replace_chunk(size_t chunk_index, const ChunkSnapshot& snapshot)
+{
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.is_resident())
+        drop_tiles(chunk);
+    else
+        m_compressed_bytes -= chunk.compressed_bytes();
+
+    auto& arena = *m_arenas.first();
+    chunk.palette = arena.allocate<u64>(snapshot.palette.size());
+    snapshot.palette.span().copy_to(chunk.palette);
+    chunk.runs = arena.allocate<Run>(snapshot.runs.size());
+    snapshot.runs.span().copy_to(chunk.runs);
+    m_compressed_bytes += chunk.compressed_bytes();
+
+    // If the chunk is stale, update_chunk_hashes() will just work out the same hash again
+    m_fingerprint ^= chunk.hash ^ snapshot.hash;
+    chunk.hash = snapshot.hash;
+
+    compact_arenas_if_needed();
+}
+
+void ChunkedTileMap::decompress(Chunk& chunk)
+{
+    VERIFY(!chunk.is_resident());
+
+    size_t total_length = 0;
+    for (auto& run : chunk.runs)
+        total_length += run.length;
+
+    if (!m_spare_tiles.is_empty())
+        chunk.tiles = m_spare_tiles.take_last();
+
+    chunk.tiles.ensure_capacity(total_length);
+    for (auto& run : chunk.runs)
+    {
+        auto tile = tile_for_key(chunk.palette[run.palette_index]);
+        for (auto i = 0; i < run.length; i++)
+            chunk.tiles.unchecked_append(tile);
+    }
+
+    // What's left of the palette and runs in the arena is garbage now, until the arenas are compacted
+    m_compressed_bytes -= chunk.compressed_bytes();
+    chunk.palette = {};
+    chunk.runs = {};
+    m_resident_chunks++;
+}
+
+size_t ChunkedTileMap::arena_bytes() const
+{
+    size_t bytes = 0;
+    for (auto& arena : m_arenas)
+        bytes += arena->used_bytes();
+    return bytes;
+}
+
+void ChunkedTileMap::compact_arenas()
+{
+    auto arena = make<Arena>();
+    for (auto& chunk : m_chunks)
+    {
+        if (chunk.is_resident())
+            continue;
+
+        auto palette = arena->allocate<u64>(chunk.palette.size());
+        chunk.palette.copy_to(palette);
+        chunk.palette = palette;
+
+        auto runs = arena->allocate<Run>(chunk.runs.size());
+        chunk.runs.copy_to(runs);
+        chunk.runs = runs;
+    }
+
+    m_arenas.clear();
+    m_arenas.append(move(arena));
+}
+
+u64 ChunkedTileMap::key_for_tile(const Terraria::Tile& tile)
+{
+    u64 key = 0;
+
+    if (tile.block().has_value())
+    {
+        auto& block = *tile.block();
+        key |= 1;
+        key |= static_cast<u64>(static_cast<u16>(block.id())) << 16;
+
+        if (block.frame_x().has_value())
+        {
+            key |= 1 << 1;
+            key |= static_cast<u64>(static_cast<u16>(*block.frame_x())) << 32;
+        }
+
+        if (block.frame_y().has_value())
+        {
+            key |= 1 << 2;
+            key |= static_cast<u64>(static_cast<u16>(*block.frame_y())) << 48;
+        }
+    }
+
+    key |= tile.has_red_wire() << 3;
+    key |= tile.has_blue_wire() << 4;
+    key |= tile.has_green_wire() << 5;
+    key |= tile.has_yellow_wire() << 6;
+    key |= tile.has_actuator() << 7;
+    key |= tile.is_actuated() << 8;
+
+    return key;
+}
+
+Terraria::Tile ChunkedTileMap::tile_for_key(u64 key)
+{
+    Terraria::Tile tile;
+
+    if ((key & 1) != 0)
+    {
+        Terraria::Tile::Block block(static_cast<Terraria::Tile::Block::Id>(static_cast<u16>(key >> 16)));
+        if ((key & (1 << 1)) != 0)
+            block.frame_x() = static_cast<i16>(key >> 32);
+
+        if ((key & (1 << 2)) != 0)
+            block.frame_y() = static_cast<i16>(key >> 48);
+
+        tile = Terraria::Tile(move(block));
+    }
+
+    tile.set_red_wire((key & (1 << 3)) != 0);
+    tile.set_blue_wire((key & (1 << 4)) != 0);
+    tile.set_green_wire((key & (1 << 5)) != 0);
+    tile.set_yellow_wire((key & (1 << 6)) != 0);
+    tile.set_has_actuator((key & (1 << 7)) != 0);
+    tile.set_is_actuated((key & (1 << 8)) != 0);
+
+    return tile;
+}
+
+u64 ChunkedTileMap::chunk_hash(size_t chunk_index) const
+{
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.hash_is_stale)
+        return compute_chunk_hash(chunk_index);
+
+    return chunk.hash;
+}
+
+void ChunkedTileMap::update_chunk_hashes()
+{
+    for (auto chunk_index : m_stale_chunks)
+    {
+        auto& chunk = m_chunks[chunk_index];
+        m_fingerprint ^= chunk.hash;
+        chunk.hash = compute_chunk_hash(chunk_index);
+        chunk.hash_is_stale = false;
+        m_fingerprint ^= chunk.hash;
+    }
+
+    m_stale_chunks.clear();
+}
+
+u64 ChunkedTileMap::fingerprint() const
+{
+    // The chunk hashes already depend on where the chunk is, so just XORing them together is enough, and means
+    // a chunk changing only has to swap its own hash out
+    auto fingerprint = m_fingerprint;
+    for (auto chunk_index : m_stale_chunks)
+        fingerprint ^= m_chunks[chunk_index].hash ^ compute_chunk_hash(chunk_index);
+
+    return fingerprint;
+}
+
+u64 ChunkedTileMap::compute_chunk_hash(size_t chunk_index) const
+{
+    // This hashes runs of tiles rather than the tiles themselves, which is what makes it cheap for compressed chunks.
+    // Compressed runs are always as long as they can be, so resident chunks just have to find the same runs.
+    u64 hash = mix(chunk_index);
+    auto hash_run = [&](u64 key, u32 length)
+    {
+        hash = mix(hash ^ mix(key) ^ (static_cast<u64>(length) << 48));
+    };
+
+    auto& chunk = m_chunks[chunk_index];
+    if (!chunk.is_resident())
+    {
+        for (auto& run : chunk.runs)
+            hash_run(chunk.palette[run.palette_index], run.length);
+
+        return hash;
+    }
+
+    Optional<u64> run_key;
+    u32 run_length = 0;
+    for (auto& tile : chunk.tiles)
+    {
+        auto key = key_for_tile(tile);
+        if (run_key.has_value() && *run_key == key)
+        {
+            run_length++;
+            continue;
+        }
+
+        if (run_key.has_value())
+            hash_run(*run_key, run_length);
+
+        run_key = key;
+        run_length = 1;
+    }
+
+    if (run_key.has_value())
+        hash_run(*run_key, run_length);
+
+    return hash;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Span.h>
+#include <AK/Vector.h>
+#include <Editor/Arena.h>
+#include <LibTerraria/Tile.h>
+#include <LibTerraria/World.h>
+
+// The editor's copy of a world's tiles, split into square chunks. Chunks that haven't been touched in a while are
+// kept palette + run-length compressed (most of a world is long runs of stone, dirt or air), and are decompressed
+// again the first time they're accessed through at().
+// Compressed chunks are plain keys and runs, all kept in arenas owned by the map, so building the map out of a world
+// doesn't allocate anything per chunk, and destroying it frees everything in a handful of blocks.
+class ChunkedTileMap
+{
+public:
+    static constexpr u16 chunk_size = 64;
+
+    ChunkedTileMap(u16 width, u16 height);
+
+    static NonnullOwnPtr<ChunkedTileMap> create_from_world(Terraria::World&);
+
+    // A copy of every tile in the map, compressed
+    NonnullOwnPtr<ChunkedTileMap> clone() const;
+
+    u16 width() const
+    { return m_width; }
+
+    u16 height() const
+    { return m_height; }
+
+    u16 chunks_x() const
+    { return m_chunks_x; }
+
+    u16 chunks_y() const
+    { return m_chunks_y; }
+
+    size_t chunk_count() const
+    { return m_chunks.size(); }
+
+    ALWAYS_INLINE constexpr size_t chunk_index_for_position(u16 x, u16 y) const
+    {
+        return (x / chunk_size) + (m_chunks_x * (y / chunk_size));
+    }
+
+    ALWAYS_INLINE constexpr bool contains(int x, int y) const
+    {
+        return x >= 0 && y >= 0 && x < m_width && y < m_height;
+    }
+
+    // The returned reference is only valid until the next call to compress_all() or replace_chunk(), as the chunk
+    // it lives in may be compressed or replaced then. Out of bounds positions give you an empty tile.
+    Terraria::Tile& at(int x, int y);
+
+    // Reads a tile without decompressing (or otherwise touching) its chunk, so it's safe to call from other threads
+    // as long as nobody is writing to the map.
+    Terraria::Tile tile_at(int x, int y) const;
+
+    // Calls the callback with every tile in the chunk, without decompressing it. Like tile_at(), this never
+    // modifies the map.
+    void for_each_tile_in_chunk(size_t chunk_index, Function<void(int x, int y, const Terraria::Tile&)>) const;
+
+    // Recalculates the frames of every block in the region, based on the blocks around them
+    void frame_region(int start_x, int start_y, int end_x, int end_y);
+
+    // Compress every chunk, for when nobody will be looking at this map for a while. The world thread does this
+    // once its world has gone untouched for a few seconds.
+    void compress_all();
+
+    size_t resident_chunk_count() const
+    { return m_resident_chunks; }
+
+    // How much the compressed chunks take up, and how much of the arenas they're in that is
+    size_t compressed_bytes() const
+    { return m_compressed_bytes; }
+
+    size_t arena_bytes() const;
+
+    // Everything the editor knows about a tile, packed into 64 bits. Two tiles with the same key are the same tile
+    // as far as we're concerned, which is what compression, hashing and diffing compare with.
+    static u64 key_for_tile(const Terraria::Tile&);
+
+    // The opposite of key_for_tile()
+    static Terraria::Tile tile_for_key(u64);
+
+    // A hash of every tile in the chunk. Chunks with the same tiles always have the same hash, whether they're
+    // compressed or not. Like tile_at(), this never modifies the map.
+    // Hashes are kept up to date by update_chunk_hashes(), so this is usually just a lookup. If the chunk has been
+    // written to since then, it's hashed again on the spot.
+    u64 chunk_hash(size_t chunk_index) const;
+
+    // Rehashes every chunk that might have changed through at() since the last time this was called
+    void update_chunk_hashes();
+
+    // A hash of the whole map, made out of the chunk hashes. Two maps with the same tiles always have the same
+    // fingerprint, so if it hasn't changed, nothing has.
+    u64 fingerprint() const;
+
+    struct Run
+    {
+        u16 palette_index;
+        u16 length;
+    };
+
+    // A compressed copy of a chunk, that doesn't point into the map it came from. This is how changed chunks are
+    // handed from one map to another of the same size, see replace_chunk().
+    struct ChunkSnapshot
+    {
+        Vector<u64> palette;
+        Vector<Run> runs;
+        u64 hash{};
+    };
+
+    // Like tile_at(), this never modifies the map.
+    ChunkSnapshot snapshot_chunk(size_t chunk_index) const;
+
+    // Throws away whatever the chunk had, and gives it the snapshot's tiles instead. The chunk stays compressed.
+    void replace_chunk(size_t chunk_index, const ChunkSnapshot&);
+
+private:
+    struct Chunk
+    {
+        bool is_resident() const
+        { return !tiles.is_empty(); }
+
+        size_t compressed_bytes() const
+        { return palette.size_in_bytes() + runs.size_in_bytes(); }
+
+        Vector<Terraria::Tile> tiles;
+        // The keys of every different tile in the chunk, when it's compressed. Both of these live in an arena.
+        Span<u64> palette;
+        Span<Run> runs;
+        u64 hash{};
+        // at() has handed out a reference into this chunk since it was last hashed
+        bool hash_is_stale{};
+    };
+
+    Chunk& resident_chunk_for_position(u16 x, u16 y);
+
+    void compress(Chunk&);
+
+    // Compresses the tiles into the chunk's palette and runs, without touching anything else, so it can be run on
+    // many chunks at once (as long as they each use their own arena)
+    static void compress_tiles(Chunk&, Span<const Terraria::Tile>, Arena&);
+
+    // Works out the palette and runs for the tiles, and hands them to the callback to copy wherever they need to go
+    template<typename Callback>
+    static void compress_tiles(Span<const Terraria::Tile>, Callback);
+
+    // Gives up a resident chunk's tiles, once it has its palette and runs
+    void drop_tiles(Chunk&);
+
+    // Compacts the arenas, if enough of them is garbage to be worth it
+    void compact_arenas_if_needed();
+
+    // Copies every compressed chunk into a new arena, dropping everything in the old ones that was decompressed since
+    void compact_arenas();
+
+    u64 compute_chunk_hash(size_t chunk_index) const;
+
+    void decompress(Chunk&);
+
+    u16 chunk_width(size_t chunk_index) const;
+
+    u16 chunk_height(size_t chunk_index) const;
+
+    u16 m_width;
+    u16 m_height;
+    u16 m_chunks_x;
+    u16 m_chunks_y;
+    Vector<Chunk> m_chunks;
+    size_t m_resident_chunks{};
+
+    // Loading fills one arena per thread, everything compressed after that goes in the first one
+    Vector<NonnullOwnPtr<Arena>> m_arenas;
+    size_t m_compressed_bytes{};
+    // The tiles of chunks we compressed, kept around to decompress other chunks into
+    Vector<Vector<Terraria::Tile>> m_spare_tiles;
+
+    Vector<size_t> m_stale_chunks;
+    // Every chunk's hash XORed together, as of the last update_chunk_hashes()
+    u64 m_fingerprint{};
+
+    Terraria::Tile m_out_of_bounds_tile;
+};
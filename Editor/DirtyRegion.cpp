@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/DirtyRegion.h>
+
+void DirtyRegion::add(int x, int y, int end_x, int end_y)
+{
+    if (x >= end_x || y >= end_y)
+        return;
+
+    Rect rect{x, y, end_x, end_y};
+
+    // Merging can make the rectangle big enough to overlap ones it didn't before, so keep going until nothing changes.
+    // Two rectangles are only merged if that doesn't cover more tiles than they did apart, otherwise a long diagonal
+    // stroke would turn into one huge rectangle that's mostly untouched tiles.
+    for (size_t i = 0; i < m_rects.size();)
+    {
+        auto& other = m_rects[i];
+        if (!rect.intersects(other) || rect.united(other).area() > rect.area() + other.area())
+        {
+            i++;
+            continue;
+        }
+
+        rect = rect.united(other);
+        m_rects.remove(i);
+        i = 0;
+    }
+
+    m_rects.append(rect);
+}
+
+bool DirtyRegion::intersects(int x, int y, int end_x, int end_y) const
+{
+    Rect rect{x, y, end_x, end_y};
+    for (auto& other : m_rects)
+    {
+        if (rect.intersects(other))
+            return true;
+    }
+
+    return false;
+}
+
+void DirtyRegion::for_each_rect(Function<void(const Rect&)> callback) const
+{
+    for (auto& rect : m_rects)
+        callback(rect);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/Vector.h>
+
+// A set of rectangles of tiles that have been touched, merging rectangles that overlap as they're added, so that
+// lots of small edits in the same place (like painting) turn into a few bigger rectangles that can each be dealt
+// with once.
+class DirtyRegion
+{
+public:
+    struct Rect
+    {
+        // End is exclusive
+        int x;
+        int y;
+        int end_x;
+        int end_y;
+
+        int area() const
+        { return (end_x - x) * (end_y - y); }
+
+        bool intersects(const Rect& other) const
+        { return x < other.end_x && other.x < end_x && y < other.end_y && other.y < end_y; }
+
+        Rect united(const Rect& other) const
+        { return {min(x, other.x), min(y, other.y), max(end_x, other.end_x), max(end_y, other.end_y)}; }
+    };
+
+    void add(int x, int y, int end_x, int end_y);
+
+    bool is_empty() const
+    { return m_rects.is_empty(); }
+
+    bool intersects(int x, int y, int end_x, int end_y) const;
+
+    void for_each_rect(Function<void(const Rect&)>) const;
+
+    void clear()
+    { m_rects.clear(); }
+
+private:
+    Vector<Rect> m_rects;
+};
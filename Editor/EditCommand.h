@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <Editor/Object.h>
+#include <LibGfx/Point.h>
+#include <LibTerraria/Tile.h>
+
+// A single change to a world's tiles, walls or liquids. The UI never writes to tiles itself, it makes one of these and
+// hands it to the WorldThread, which applies them in the order they were made.
+struct EditCommand
+{
+    enum class Type
+    {
+        SetTile,
+        PlaceObject,
+        RestyleObject,
+        RemoveObject,
+        FrameRegion,
+        SetWall,
+        PaintTiles,
+        PaintWalls,
+        PaintLiquid,
+        FillLiquid,
+        FillLiquidBasin,
+        RunScript,
+    };
+
+    static EditCommand set_tile(int x, int y, Terraria::Tile tile, bool frame)
+    {
+        EditCommand command;
+        command.type = Type::SetTile;
+        command.x = x;
+        command.y = y;
+        command.tile = move(tile);
+        command.frame = frame;
+        return command;
+    }
+
+    static EditCommand place_object(int x, int y, const Object& object, int style_x, int style_y)
+    {
+        EditCommand command;
+        command.type = Type::PlaceObject;
+        command.x = x;
+        command.y = y;
+        command.object = &object;
+        command.style_x = style_x;
+        command.style_y = style_y;
+        return command;
+    }
+
+    // Changes the style of an object that's already placed, without touching anything around it
+    static EditCommand restyle_object(int x, int y, const Object& object, int style_x, int style_y)
+    {
+        auto command = place_object(x, y, object, style_x, style_y);
+        command.type = Type::RestyleObject;
+        return command;
+    }
+
+    static EditCommand remove_object(int x, int y, const Object& object)
+    {
+        EditCommand command;
+        command.type = Type::RemoveObject;
+        command.x = x;
+        command.y = y;
+        command.object = &object;
+        return command;
+    }
+
+    static EditCommand frame_region(int x, int y, int end_x, int end_y)
+    {
+        EditCommand command;
+        command.type = Type::FrameRegion;
+        command.x = x;
+        command.y = y;
+        command.end_x = end_x;
+        command.end_y = end_y;
+        return command;
+    }
+
+    // Walls are framed by themselves, so this never frames any blocks
+    static EditCommand set_wall(int x, int y, u16 wall_id)
+    {
+        EditCommand command;
+        command.type = Type::SetWall;
+        command.x = x;
+        command.y = y;
+        command.wall_id = wall_id;
+        return command;
+    }
+
+    // Sets every tile in a brush stroke to the same tile, and frames around all of them once
+    static EditCommand paint_tiles(Vector<Gfx::IntPoint> positions, Terraria::Tile tile)
+    {
+        EditCommand command;
+        command.type = Type::PaintTiles;
+        command.positions = move(positions);
+        command.tile = move(tile);
+        return command;
+    }
+
+    static EditCommand paint_walls(Vector<Gfx::IntPoint> positions, u16 wall_id)
+    {
+        EditCommand command;
+        command.type = Type::PaintWalls;
+        command.positions = move(positions);
+        command.wall_id = wall_id;
+        return command;
+    }
+
+    // Sets the liquid of every tile given, whether or not liquid could really be there
+    static EditCommand paint_liquid(Vector<Gfx::IntPoint> positions, u8 liquid)
+    {
+        EditCommand command;
+        command.type = Type::PaintLiquid;
+        command.positions = move(positions);
+        command.liquid = liquid;
+        return command;
+    }
+
+    // Fills (or with 0, drains) every tile in the region that liquid can be in, see LiquidLayer::pack()
+    static EditCommand fill_liquid(int x, int y, int end_x, int end_y, u8 liquid)
+    {
+        auto command = frame_region(x, y, end_x, end_y);
+        command.type = Type::FillLiquid;
+        command.liquid = liquid;
+        return command;
+    }
+
+    // Fills the basin the tile is in up to its level, or with 0, drains the liquid it's in
+    static EditCommand fill_liquid_basin(int x, int y, u8 liquid)
+    {
+        EditCommand command;
+        command.type = Type::FillLiquidBasin;
+        command.x = x;
+        command.y = y;
+        command.liquid = liquid;
+        return command;
+    }
+
+    // Runs a Lua script against the world, which can touch its chests and signs as well as its tiles. Whatever the
+    // script printed can be picked up with WorldThread::take_script_output() once it's done.
+    static EditCommand run_script(String path)
+    {
+        EditCommand command;
+        command.type = Type::RunScript;
+        command.script_path = move(path);
+        return command;
+    }
+
+    Type type{};
+    int x{};
+    int y{};
+    int end_x{};
+    int end_y{};
+
+    Terraria::Tile tile;
+    bool frame{};
+
+    const Object* object{};
+    int style_x{};
+    int style_y{};
+
+    u16 wall_id{};
+    u8 liquid{};
+
+    Vector<Gfx::IntPoint> positions;
+
+    String script_path;
+};
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/Array.h>
+#include <AK/Vector.h>
+#include <Editor/FrameTable.h>
+#include <LibTerraria/Model.h>
+
+FrameTable::Frame FrameTable::wire_frame(u8 neighbours)
+{
+    static auto frames = []
+    {
+        Array<Frame, 16> frames;
+        for (u8 i = 0; i < frames.size(); i++)
+        {
+            auto frame = Terraria::Tile::frames_for_wire((i & 1) != 0, (i & 2) != 0, (i & 4) != 0, (i & 8) != 0);
+            frames[i] = {static_cast<i16>(frame.x), static_cast<i16>(frame.y)};
+        }
+        return frames;
+    }();
+
+    return frames[neighbours & 0xf];
+}
+
+static Optional<FrameTable::Frame> frame_from_libterraria(const Terraria::Tile& tile, const Terraria::Tile& top,
+                                                         const Terraria::Tile& bottom, const Terraria::Tile& left,
+                                                         const Terraria::Tile& right)
+{
+    auto frame = Terraria::Tile::Block::frame_for_block(tile, top, bottom, left, right);
+    if (!frame.has_value())
+        return {};
+
+    return FrameTable::Frame{static_cast<i16>(frame->x), static_cast<i16>(frame->y)};
+}
+
+Optional<FrameTable::Frame> FrameTable::block_frame(const Terraria::Tile& tile, const Terraria::Tile& top,
+                                                    const Terraria::Tile& bottom, const Terraria::Tile& left,
+                                                    const Terraria::Tile& right)
+{
+    struct Table
+    {
+        // Every block with every way its neighbours could merge with it, indexed by (id * 16) + neighbours
+        Vector<Optional<Frame>> frames;
+        // Blocks whose frame changes next to some other block, which LibTerraria always has to be asked about
+        Vector<bool> merges_with_others;
+    };
+
+    // Asking LibTerraria about a block next to nothing but air and copies of itself gives the same frame as the real
+    // neighbours would, as long as every other block looks like air to it. Which ones merge with other blocks (like
+    // grass with dirt) isn't visible from here, so every block is asked about being surrounded by every other one.
+    static auto table = []
+    {
+        Table table;
+        table.frames.resize(Terraria::s_total_tiles * 16);
+        table.merges_with_others.resize(Terraria::s_total_tiles);
+
+        Terraria::Tile air;
+        Terraria::Tile other;
+        for (u16 id = 0; id < Terraria::s_total_tiles; id++)
+        {
+            Terraria::Tile block;
+            block.block() = Terraria::Tile::Block(static_cast<Terraria::Tile::Block::Id>(id));
+            for (u8 i = 0; i < 16; i++)
+            {
+                auto neighbour = [&](u8 bit) -> const Terraria::Tile&
+                {
+                    return (i & bit) != 0 ? block : air;
+                };
+
+                table.frames[(id * 16) + i] = frame_from_libterraria(block, neighbour(1), neighbour(2), neighbour(4),
+                                                                     neighbour(8));
+            }
+
+            auto& alone = table.frames[id * 16];
+            for (u16 other_id = 0; other_id < Terraria::s_total_tiles && !table.merges_with_others[id]; other_id++)
+            {
+                if (other_id == id)
+                    continue;
+
+                other.block() = Terraria::Tile::Block(static_cast<Terraria::Tile::Block::Id>(other_id));
+                auto surrounded = frame_from_libterraria(block, other, other, other, other);
+                table.merges_with_others[id] = surrounded.has_value() != alone.has_value() ||
+                                               (alone.has_value() &&
+                                                (surrounded->x != alone->x || surrounded->y != alone->y));
+            }
+        }
+        return table;
+    }();
+
+    // Nothing LibTerraria knows about has anything in the table either
+    auto id = static_cast<u16>(tile.block()->id());
+    if (id >= Terraria::s_total_tiles || table.merges_with_others[id])
+        return frame_from_libterraria(tile, top, bottom, left, right);
+
+    auto merges = [&](const Terraria::Tile& neighbour)
+    {
+        return neighbour.block().has_value() && static_cast<u16>(neighbour.block()->id()) == id;
+    };
+
+    return table.frames[(id * 16) + wire_neighbours(merges(top), merges(bottom), merges(left), merges(right))];
+}
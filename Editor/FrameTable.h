@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Optional.h>
+#include <LibTerraria/Tile.h>
+
+// Looks frames up in tables, rather than having LibTerraria work them out again for every tile. LibTerraria's framing
+// isn't constexpr, so the tables are filled in at runtime, all at once the first time one is needed: there are only
+// 16 ways a wire can be connected, and 16 ways for each block that only merges with itself.
+class FrameTable
+{
+public:
+    struct Frame
+    {
+        i16 x;
+        i16 y;
+    };
+
+    // Which neighbours have the same wire (or merge with a block), from the lowest bit up: top, bottom, left, right
+    static constexpr u8 wire_neighbours(bool top, bool bottom, bool left, bool right)
+    { return static_cast<u8>(top | (bottom << 1) | (left << 2) | (right << 3)); }
+
+    static Frame wire_frame(u8 neighbours);
+
+    // The same as Terraria::Tile::Block::frame_for_block(). For most blocks, the frame only depends on the block and
+    // which of its neighbours are the same block, which is all the table is keyed on. Blocks that merge with other
+    // blocks are found out when the table is filled, and always go to LibTerraria.
+    static Optional<Frame> block_frame(const Terraria::Tile&, const Terraria::Tile& top, const Terraria::Tile& bottom,
+                                       const Terraria::Tile& left, const Terraria::Tile& right);
+};
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/WorldLoader.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Whatever the bytes are, loading them should either give a world or an error, and never crash
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    auto world_or_error = WorldLoader::load_from_bytes({data, size});
+    (void)world_or_error;
+    return 0;
+}
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/QuickSort.h>
+#include <AK/StringBuilder.h>
+#include <Editor/InputRecording.h>
+
+// A recording is the magic, the version, whether a world was opened and the CRC-32 of its file, and the size of the
+// window. Then every frame is how many events it had, and then the events: their type, their timestamp, and whatever
+// else that type of event has.
+static constexpr char recording_magic[8] = {'T', 'A', 'D', 'I', 'N', 'P', 'U', 'T'};
+static constexpr u32 recording_version = 1;
+
+static bool is_recorded(const SDL_Event& event)
+{
+    switch (event.type)
+    {
+        case SDL_MOUSEMOTION:
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+        case SDL_MOUSEWHEEL:
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        case SDL_TEXTINPUT:
+        case SDL_WINDOWEVENT:
+        case SDL_QUIT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Result<NonnullOwnPtr<InputRecorder>, String> InputRecorder::create(const String& path, Optional<u32> world_checksum,
+                                                                   int window_width, int window_height)
+{
+    auto file_or_error = Core::File::open(path, Core::OpenMode::WriteOnly);
+    if (file_or_error.is_error())
+        return String::formatted("Failed to open {} for writing: {}", path, file_or_error.error());
+
+    BinaryWriter header;
+    for (auto c : recording_magic)
+        header.write<u8>(c);
+    header.write<u32>(recording_version);
+    header.write<u8>(world_checksum.has_value());
+    header.write<u32>(world_checksum.value_or(0));
+    header.write<u16>(window_width);
+    header.write<u16>(window_height);
+
+    auto& file = file_or_error.value();
+    if (!file->write(header.bytes().data(), header.bytes().size()))
+        return String::formatted("Failed to write to {}", path);
+
+    return make<InputRecorder>(file);
+}
+
+InputRecorder::InputRecorder(NonnullRefPtr<Core::File> file)
+        : m_file(move(file))
+{
+}
+
+void InputRecorder::record(const SDL_Event& event)
+{
+    if (!is_recorded(event))
+        return;
+
+    m_frame_event_count++;
+    m_frame.write<u32>(event.type);
+    m_frame.write<u32>(event.common.timestamp);
+    switch (event.type)
+    {
+        case SDL_MOUSEMOTION:
+            m_frame.write<i32>(event.motion.x);
+            m_frame.write<i32>(event.motion.y);
+            m_frame.write<i32>(event.motion.xrel);
+            m_frame.write<i32>(event.motion.yrel);
+            m_frame.write<u32>(event.motion.state);
+            break;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            m_frame.write<u8>(event.button.button);
+            m_frame.write<u8>(event.button.clicks);
+            m_frame.write<i32>(event.button.x);
+            m_frame.write<i32>(event.button.y);
+            break;
+        case SDL_MOUSEWHEEL:
+            m_frame.write<i32>(event.wheel.x);
+            m_frame.write<i32>(event.wheel.y);
+            m_frame.write<u32>(event.wheel.direction);
+            break;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            m_frame.write<u8>(event.key.repeat);
+            m_frame.write<i32>(event.key.keysym.scancode);
+            m_frame.write<i32>(event.key.keysym.sym);
+            m_frame.write<u16>(event.key.keysym.mod);
+            break;
+        case SDL_TEXTINPUT:
+            m_frame.write_string(event.text.text);
+            break;
+        case SDL_WINDOWEVENT:
+            m_frame.write<u8>(event.window.event);
+            m_frame.write<i32>(event.window.data1);
+            m_frame.write<i32>(event.window.data2);
+            break;
+        default:
+            break;
+    }
+}
+
+void InputRecorder::end_frame()
+{
+    BinaryWriter event_count;
+    event_count.write<u32>(m_frame_event_count);
+
+    // Losing the end of a recording isn't worth stopping the editor over, just let whoever is recording know
+    if (!m_file->write(event_count.bytes().data(), event_count.bytes().size()) ||
+        !m_file->write(m_frame.bytes().data(), m_frame.bytes().size()))
+    {
+        warnln("Failed to write to the input recording");
+    }
+
+    m_frame.clear();
+    m_frame_event_count = 0;
+}
+
+Result<NonnullOwnPtr<InputPlayer>, String> InputPlayer::load(const String& path)
+{
+    auto file_or_error = Core::File::open(path, Core::OpenMode::ReadOnly);
+    if (file_or_error.is_error())
+        return String::formatted("Failed to open {}: {}", path, file_or_error.error());
+
+    auto contents = file_or_error.value()->read_all();
+    BinaryReader reader(contents.bytes());
+
+    for (auto c : recording_magic)
+    {
+        u8 byte;
+        if (!reader.read(byte) || byte != static_cast<u8>(c))
+            return String::formatted("{} isn't an input recording", path);
+    }
+
+    u32 version;
+    u8 has_world;
+    u32 world_checksum;
+    u16 window_width;
+    u16 window_height;
+    if (!reader.read(version))
+        return String::formatted("{} is truncated", path);
+
+    if (version != recording_version)
+    {
+        return String::formatted("{} is a version {} recording, we only know version {}", path, version,
+                                 recording_version);
+    }
+
+    if (!reader.read(has_world) || !reader.read(world_checksum) || !reader.read(window_width) ||
+        !reader.read(window_height))
+    {
+        return String::formatted("{} is truncated", path);
+    }
+
+    auto player = make<InputPlayer>();
+    if (has_world)
+        player->m_world_checksum = world_checksum;
+    player->m_window_width = window_width;
+    player->m_window_height = window_height;
+
+    // The editor might have crashed halfway through writing a frame, so everything up until the last whole frame
+    // is what we play
+    while (!reader.is_at_end())
+    {
+        u32 event_count;
+        if (!reader.read(event_count))
+            break;
+
+        Frame frame{player->m_events.size(), 0};
+        bool is_whole = true;
+        for (u32 i = 0; i < event_count && is_whole; i++)
+        {
+            SDL_Event event{};
+            if (!reader.read(event.type) || !reader.read(event.common.timestamp))
+            {
+                is_whole = false;
+                break;
+            }
+
+            switch (event.type)
+            {
+                case SDL_MOUSEMOTION:
+                    is_whole = reader.read(event.motion.x) && reader.read(event.motion.y) &&
+                               reader.read(event.motion.xrel) && reader.read(event.motion.yrel) &&
+                               reader.read(event.motion.state);
+                    break;
+                case SDL_MOUSEBUTTONDOWN:
+                case SDL_MOUSEBUTTONUP:
+                    event.button.state = event.type == SDL_MOUSEBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED;
+                    is_whole = reader.read(event.button.button) && reader.read(event.button.clicks) &&
+                               reader.read(event.button.x) && reader.read(event.button.y);
+                    break;
+                case SDL_MOUSEWHEEL:
+                    is_whole = reader.read(event.wheel.x) && reader.read(event.wheel.y) &&
+                               reader.read(event.wheel.direction);
+                    break;
+                case SDL_KEYDOWN:
+                case SDL_KEYUP:
+                {
+                    event.key.state = event.type == SDL_KEYDOWN ? SDL_PRESSED : SDL_RELEASED;
+                    i32 scancode;
+                    i32 sym;
+                    is_whole = reader.read(event.key.repeat) && reader.read(scancode) && reader.read(sym) &&
+                               reader.read(event.key.keysym.mod);
+                    event.key.keysym.scancode = static_cast<SDL_Scancode>(scancode);
+                    event.key.keysym.sym = sym;
+                    break;
+                }
+                case SDL_TEXTINPUT:
+                {
+                    String text;
+                    is_whole = reader.read_string(text);
+                    if (is_whole)
+                        text.copy_characters_to_buffer(event.text.text, sizeof(event.text.text));
+                    break;
+                }
+                case SDL_WINDOWEVENT:
+                    is_whole = reader.read(event.window.event) && reader.read(event.window.data1) &&
+                               reader.read(event.window.data2);
+                    break;
+                case SDL_QUIT:
+                    break;
+                default:
+                    return String::formatted("{} has an event we don't know about ({})", path, event.type);
+            }
+
+            if (is_whole)
+                player->m_events.append(event);
+        }
+
+        if (!is_whole)
+        {
+            player->m_events.shrink(frame.first_event);
+            break;
+        }
+
+        frame.event_count = event_count;
+        player->m_frames.append(frame);
+    }
+
+    return player;
+}
+
+bool InputPlayer::play_frame(Function<void(SDL_Event&)> callback)
+{
+    if (m_next_frame == m_frames.size())
+        return false;
+
+    auto& frame = m_frames[m_next_frame++];
+    for (auto i = frame.first_event; i < frame.first_event + frame.event_count; i++)
+    {
+        // Copied, since whoever we give it to is free to change it
+        auto event = m_events[i];
+        switch (event.type)
+        {
+            case SDL_MOUSEMOTION:
+                event.motion.windowID = m_window_id;
+                m_mouse_x = event.motion.x;
+                m_mouse_y = event.motion.y;
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+                event.button.windowID = m_window_id;
+                m_mouse_buttons |= SDL_BUTTON(event.button.button);
+                break;
+            case SDL_MOUSEBUTTONUP:
+                event.button.windowID = m_window_id;
+                m_mouse_buttons &= ~SDL_BUTTON(event.button.button);
+                break;
+            case SDL_MOUSEWHEEL:
+                event.wheel.windowID = m_window_id;
+                break;
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                event.key.windowID = m_window_id;
+                break;
+            case SDL_TEXTINPUT:
+                event.text.windowID = m_window_id;
+                break;
+            case SDL_WINDOWEVENT:
+                event.window.windowID = m_window_id;
+                break;
+            default:
+                break;
+        }
+
+        callback(event);
+    }
+
+    return true;
+}
+
+void InputPlayer::override_imgui_input(ImGuiIO& io) const
+{
+    io.DeltaTime = frame_delta_time;
+    io.MousePos = ImVec2(static_cast<float>(m_mouse_x), static_cast<float>(m_mouse_y));
+    io.MouseDown[0] = (m_mouse_buttons & SDL_BUTTON(SDL_BUTTON_LEFT)) != 0;
+    io.MouseDown[1] = (m_mouse_buttons & SDL_BUTTON(SDL_BUTTON_RIGHT)) != 0;
+    io.MouseDown[2] = (m_mouse_buttons & SDL_BUTTON(SDL_BUTTON_MIDDLE)) != 0;
+}
+
+void InputPlayer::print_frame_times() const
+{
+    if (m_frame_times.is_empty())
+    {
+        outln("No frames were played");
+        return;
+    }
+
+    auto sorted_times = m_frame_times;
+    quick_sort(sorted_times);
+
+    double total = 0;
+    size_t slow_frames = 0;
+    for (auto time : m_frame_times)
+    {
+        total += time;
+        if (time > 1000.0 / 60.0)
+            slow_frames++;
+    }
+
+    auto percentile = [&](double percent)
+    {
+        auto index = static_cast<size_t>(percent / 100.0 * static_cast<double>(sorted_times.size() - 1));
+        return sorted_times[index];
+    };
+
+    outln("{} frames in {:.1} ms", m_frame_times.size(), total);
+    outln("Mean {:.2} ms, median {:.2} ms, 95th percentile {:.2} ms, 99th percentile {:.2} ms, worst {:.2} ms",
+          total / static_cast<double>(m_frame_times.size()), percentile(50), percentile(95), percentile(99),
+          sorted_times.last());
+    outln("{} frames took longer than 60 FPS allows", slow_frames);
+}
+
+bool InputPlayer::save_frame_times(const String& path) const
+{
+    StringBuilder builder;
+    builder.append("frame,milliseconds\n");
+    for (size_t i = 0; i < m_frame_times.size(); i++)
+        builder.appendff("{},{:.3}\n", i, m_frame_times[i]);
+
+    auto file_or_error = Core::File::open(path, Core::OpenMode::WriteOnly);
+    if (file_or_error.is_error())
+    {
+        warnln("Failed to open {} for writing: {}", path, file_or_error.error());
+        return false;
+    }
+
+    auto contents = builder.to_string();
+    if (!file_or_error.value()->write(contents))
+    {
+        warnln("Failed to write to {}", path);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/Result.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <Editor/BinaryStream.h>
+#include <LibCore/File.h>
+#include <SDL2/SDL_events.h>
+#include <imgui/imgui.h>
+
+// A recording is the input the editor got, frame by frame, along with what it needs to start from the same place:
+// a checksum of the world file that was opened (if one was) and the size of the window. Only the events the editor
+// actually reacts to are kept (the mouse, the keyboard, text input, the window and quitting).
+
+// Writes every frame's events to the file as soon as the frame is over, so a recording of a session that crashed
+// still has everything up until the crash.
+class InputRecorder
+{
+public:
+    static Result<NonnullOwnPtr<InputRecorder>, String> create(const String& path, Optional<u32> world_checksum,
+                                                               int window_width, int window_height);
+
+    explicit InputRecorder(NonnullRefPtr<Core::File>);
+
+    void record(const SDL_Event&);
+
+    void end_frame();
+
+private:
+    NonnullRefPtr<Core::File> m_file;
+    BinaryWriter m_frame;
+    u32 m_frame_event_count{};
+};
+
+// Feeds a recording back to the editor a frame at a time, as if the events came from SDL, and keeps track of how
+// long every frame took.
+class InputPlayer
+{
+public:
+    static Result<NonnullOwnPtr<InputPlayer>, String> load(const String& path);
+
+    Optional<u32> world_checksum() const
+    { return m_world_checksum; }
+
+    int window_width() const
+    { return m_window_width; }
+
+    int window_height() const
+    { return m_window_height; }
+
+    // The events are given to the window we replay into, rather than whichever one they were recorded in
+    void set_window_id(u32 window_id)
+    { m_window_id = window_id; }
+
+    // Calls the callback with every event of the next frame. Returns false once there are no frames left.
+    bool play_frame(Function<void(SDL_Event&)>);
+
+    // Every frame is as long as every other one, and the mouse is wherever the recording left it, whatever the
+    // real one is doing. Call this after the ImGui backend starts a frame, as it reads those from SDL.
+    void override_imgui_input(ImGuiIO&) const;
+
+    void add_frame_time(double milliseconds)
+    { m_frame_times.append(milliseconds); }
+
+    void print_frame_times() const;
+
+    // Every frame's time, one per line, for comparing runs in something better at it than us
+    bool save_frame_times(const String& path) const;
+
+    static constexpr float frame_delta_time = 1.0f / 60.0f;
+
+private:
+    struct Frame
+    {
+        size_t first_event;
+        size_t event_count;
+    };
+
+    Optional<u32> m_world_checksum;
+    int m_window_width{};
+    int m_window_height{};
+    Vector<SDL_Event> m_events;
+    Vector<Frame> m_frames;
+    size_t m_next_frame{};
+    u32 m_window_id{};
+
+    int m_mouse_x{};
+    int m_mouse_y{};
+    u32 m_mouse_buttons{};
+
+    Vector<double> m_frame_times;
+};
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/LiquidLayer.h>
+#include <LibTerraria/Model.h>
+
+static constexpr u16 chunk_size = ChunkedTileMap::chunk_size;
+
+LiquidLayer::LiquidLayer(u16 width, u16 height)
+        : m_width(width),
+          m_height(height),
+          m_chunks_x((width + chunk_size - 1) / chunk_size)
+{
+    m_chunks.resize(m_chunks_x * ((height + chunk_size - 1) / chunk_size));
+}
+
+NonnullOwnPtr<LiquidLayer> LiquidLayer::create_from_world(Terraria::World& world)
+{
+    auto liquids = make<LiquidLayer>(world.m_max_tiles_x, world.m_max_tiles_y);
+
+    for (auto y = 0; y < liquids->m_height; y++)
+    {
+        for (auto x = 0; x < liquids->m_width; x++)
+        {
+            // The game counts up to 255, we only keep the top six bits, but never round a little liquid down to none
+            auto& tile = world.tile_map()->at(x, y);
+            auto amount = tile.liquid_amount();
+            if (amount != 0)
+                liquids->set_liquid(x, y, pack(static_cast<Type>(tile.liquid_type()), max(amount >> 2, 1)));
+        }
+    }
+
+    return liquids;
+}
+
+u16 LiquidLayer::chunk_width(size_t chunk_index) const
+{
+    auto start_x = (chunk_index % m_chunks_x) * chunk_size;
+    return static_cast<u16>(min<size_t>(chunk_size, m_width - start_x));
+}
+
+u16 LiquidLayer::chunk_height(size_t chunk_index) const
+{
+    auto start_y = (chunk_index / m_chunks_x) * chunk_size;
+    return static_cast<u16>(min<size_t>(chunk_size, m_height - start_y));
+}
+
+u8* LiquidLayer::liquid_pointer(int x, int y)
+{
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+        return nullptr;
+
+    auto chunk_index = (x / chunk_size) + (m_chunks_x * (y / chunk_size));
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.liquids.is_empty())
+        return nullptr;
+
+    return &chunk.liquids[(x % chunk_size) + (chunk_width(chunk_index) * (y % chunk_size))];
+}
+
+u8 LiquidLayer::liquid_at(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+        return 0;
+
+    auto chunk_index = (x / chunk_size) + (m_chunks_x * (y / chunk_size));
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.liquids.is_empty())
+        return 0;
+
+    return chunk.liquids[(x % chunk_size) + (chunk_width(chunk_index) * (y % chunk_size))];
+}
+
+void LiquidLayer::set_liquid(int x, int y, u8 liquid)
+{
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+        return;
+
+    auto chunk_index = (x / chunk_size) + (m_chunks_x * (y / chunk_size));
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.liquids.is_empty())
+    {
+        // Draining a chunk without any changes nothing
+        if (liquid == 0)
+            return;
+
+        chunk.liquids.resize(chunk_width(chunk_index) * chunk_height(chunk_index));
+    }
+
+    *liquid_pointer(x, y) = liquid;
+}
+
+bool LiquidLayer::blocks_liquid(const Terraria::Tile& tile)
+{
+    if (!tile.block().has_value() || tile.is_actuated())
+        return false;
+
+    return !Terraria::s_tiles[static_cast<u16>(tile.block()->id())].frame_important;
+}
+
+Optional<DirtyRegion::Rect> LiquidLayer::fill_region(const ChunkedTileMap& tiles, int start_x, int start_y,
+                                                     int end_x, int end_y, u8 liquid)
+{
+    start_x = max(start_x, 0);
+    start_y = max(start_y, 0);
+    end_x = min<int>(end_x, m_width);
+    end_y = min<int>(end_y, m_height);
+    if (start_x >= end_x || start_y >= end_y)
+        return {};
+
+    bool changed = false;
+    for (auto chunk_y = start_y / chunk_size; chunk_y <= (end_y - 1) / chunk_size; chunk_y++)
+    {
+        for (auto chunk_x = start_x / chunk_size; chunk_x <= (end_x - 1) / chunk_size; chunk_x++)
+        {
+            auto chunk_index = chunk_x + (m_chunks_x * chunk_y);
+            auto& chunk = m_chunks[chunk_index];
+            auto chunk_start_x = chunk_x * chunk_size;
+            auto chunk_start_y = chunk_y * chunk_size;
+            auto width = chunk_width(chunk_index);
+            auto height = chunk_height(chunk_index);
+
+            if (liquid == 0)
+            {
+                if (chunk.liquids.is_empty())
+                    continue;
+
+                // Draining a whole chunk just lets go of it
+                if (start_x <= chunk_start_x && start_y <= chunk_start_y && end_x >= chunk_start_x + width &&
+                    end_y >= chunk_start_y + height)
+                {
+                    chunk.liquids.clear();
+                    changed = true;
+                    continue;
+                }
+
+                for (auto y = max(start_y, chunk_start_y); y < min(end_y, chunk_start_y + height); y++)
+                {
+                    for (auto x = max(start_x, chunk_start_x); x < min(end_x, chunk_start_x + width); x++)
+                        chunk.liquids[(x - chunk_start_x) + (width * (y - chunk_start_y))] = 0;
+                }
+
+                changed = true;
+                continue;
+            }
+
+            if (chunk.liquids.is_empty())
+                chunk.liquids.resize(width * height);
+
+            // Reading the chunk like this never decompresses it, so filling a huge region doesn't either
+            tiles.for_each_tile_in_chunk(chunk_index, [&](auto x, auto y, auto& tile)
+            {
+                if (x < start_x || y < start_y || x >= end_x || y >= end_y || blocks_liquid(tile))
+                    return;
+
+                chunk.liquids[(x - chunk_start_x) + (width * (y - chunk_start_y))] = liquid;
+                changed = true;
+            });
+        }
+    }
+
+    if (!changed)
+        return {};
+
+    return DirtyRegion::Rect{start_x, start_y, end_x, end_y};
+}
+
+Optional<DirtyRegion::Rect> LiquidLayer::fill_basin(const ChunkedTileMap& tiles, int x, int y, u8 liquid)
+{
+    enum State : u8
+    {
+        Open,
+        Closed,
+        Visited,
+    };
+
+    // Whether liquid can go in each tile is worked out a chunk at a time, the first time the fill gets there, so
+    // we never look at more of the map than the basin covers
+    Vector<Vector<u8>> chunk_states;
+    chunk_states.resize(m_chunks.size());
+    auto state_at = [&](int state_x, int state_y) -> u8&
+    {
+        auto chunk_index = (state_x / chunk_size) + (m_chunks_x * (state_y / chunk_size));
+        auto chunk_start_x = static_cast<int>(chunk_index % m_chunks_x) * chunk_size;
+        auto chunk_start_y = static_cast<int>(chunk_index / m_chunks_x) * chunk_size;
+        auto width = chunk_width(chunk_index);
+        auto& states = chunk_states[chunk_index];
+        if (states.is_empty())
+        {
+            states.resize(width * chunk_height(chunk_index));
+            if (liquid == 0)
+            {
+                auto& liquids = m_chunks[chunk_index].liquids;
+                for (size_t i = 0; i < states.size(); i++)
+                    states[i] = liquids.is_empty() || liquids[i] == 0 ? Closed : Open;
+            }
+            else
+            {
+                tiles.for_each_tile_in_chunk(chunk_index, [&](auto tile_x, auto tile_y, auto& tile)
+                {
+                    if (blocks_liquid(tile))
+                        states[(tile_x - chunk_start_x) + (width * (tile_y - chunk_start_y))] = Closed;
+                });
+            }
+        }
+
+        return states[(state_x - chunk_start_x) + (width * (state_y - chunk_start_y))];
+    };
+
+    // Filling never goes above the tile we started at, draining follows the liquid wherever it goes
+    auto level = liquid == 0 ? 0 : y;
+    auto is_open = [&](int open_x, int open_y)
+    {
+        return open_x >= 0 && open_x < m_width && open_y >= level && open_y < m_height &&
+               state_at(open_x, open_y) == Open;
+    };
+
+    struct Seed
+    {
+        int x;
+        int y;
+    };
+
+    // A scanline fill, so every row of the basin is filled as one span and only the ends of spans are ever seeds
+    Optional<DirtyRegion::Rect> changed;
+    Vector<Seed> seeds;
+    seeds.append({x, y});
+    while (!seeds.is_empty())
+    {
+        auto seed = seeds.take_last();
+        if (!is_open(seed.x, seed.y))
+            continue;
+
+        auto left = seed.x;
+        while (is_open(left - 1, seed.y))
+            left--;
+
+        auto right = seed.x + 1;
+        while (is_open(right, seed.y))
+            right++;
+
+        for (auto span_x = left; span_x < right; span_x++)
+        {
+            state_at(span_x, seed.y) = Visited;
+            set_liquid(span_x, seed.y, liquid);
+        }
+
+        DirtyRegion::Rect span{left, seed.y, right, seed.y + 1};
+        changed = changed.has_value() ? changed->united(span) : span;
+
+        for (auto next_y : {seed.y - 1, seed.y + 1})
+        {
+            bool in_run = false;
+            for (auto span_x = left; span_x < right; span_x++)
+            {
+                auto open = is_open(span_x, next_y);
+                if (open && !in_run)
+                    seeds.append({span_x, next_y});
+                in_run = open;
+            }
+        }
+    }
+
+    return changed;
+}
+
+void LiquidLayer::for_each_liquid_in_chunk(size_t chunk_index, Function<void(int x, int y, u8 liquid)> callback) const
+{
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.liquids.is_empty())
+        return;
+
+    auto start_x = static_cast<int>(chunk_index % m_chunks_x) * chunk_size;
+    auto start_y = static_cast<int>(chunk_index / m_chunks_x) * chunk_size;
+    auto width = chunk_width(chunk_index);
+    for (size_t i = 0; i < chunk.liquids.size(); i++)
+    {
+        auto liquid = chunk.liquids[i];
+        if (liquid != 0)
+            callback(start_x + static_cast<int>(i % width), start_y + static_cast<int>(i / width), liquid);
+    }
+}
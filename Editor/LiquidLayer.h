@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/DirtyRegion.h>
+#include <LibTerraria/World.h>
+
+// The liquids of a world, one byte per tile: the type in the top two bits, and how full the tile is in the bottom
+// six (0 meaning no liquid at all). Split into the same chunks as the tile map, and like walls, a chunk that has
+// never had any liquid in it takes up no memory.
+class LiquidLayer
+{
+public:
+    enum class Type : u8
+    {
+        Water,
+        Lava,
+        Honey,
+        Shimmer,
+    };
+
+    static constexpr u8 max_amount = 63;
+
+    // What each type of liquid is drawn as, in the editor and in exports, as 0xAABBGGRR
+    static constexpr u32 colors[] = {0x90c06020, 0xc02060ff, 0xb020b0ff, 0xa0ffa0d0};
+
+    static constexpr u8 pack(Type type, u8 amount)
+    { return amount == 0 ? 0 : static_cast<u8>((static_cast<u8>(type) << 6) | min(amount, max_amount)); }
+
+    static constexpr Type type_of(u8 liquid)
+    { return static_cast<Type>(liquid >> 6); }
+
+    static constexpr u8 amount_of(u8 liquid)
+    { return liquid & max_amount; }
+
+    LiquidLayer(u16 width, u16 height);
+
+    static NonnullOwnPtr<LiquidLayer> create_from_world(Terraria::World&);
+
+    // 0 if there's no liquid, or the position is out of bounds
+    u8 liquid_at(int x, int y) const;
+
+    void set_liquid(int x, int y, u8 liquid);
+
+    // Fills every tile in the region that liquid can be in, or drains all of them if the liquid is 0. Returns the
+    // part of the region that actually changed, if any did.
+    Optional<DirtyRegion::Rect> fill_region(const ChunkedTileMap&, int start_x, int start_y, int end_x, int end_y,
+                                            u8 liquid);
+
+    // Fills the basin the tile is in up to its level: everything liquid can flow to from it without going any
+    // higher. With 0 this drains the body of liquid the tile is part of instead, however high it goes.
+    Optional<DirtyRegion::Rect> fill_basin(const ChunkedTileMap&, int x, int y, u8 liquid);
+
+    bool chunk_has_liquid(size_t chunk_index) const
+    { return !m_chunks[chunk_index].liquids.is_empty(); }
+
+    // A copy of the chunk's liquid (empty if it has never had any), which replace_chunk() can put in another layer of
+    // the same size
+    Vector<u8> copy_chunk(size_t chunk_index) const
+    { return m_chunks[chunk_index].liquids; }
+
+    void replace_chunk(size_t chunk_index, Vector<u8> liquids)
+    { m_chunks[chunk_index].liquids = move(liquids); }
+
+    // Calls the callback with every tile in the chunk that has liquid in it
+    void for_each_liquid_in_chunk(size_t chunk_index, Function<void(int x, int y, u8 liquid)>) const;
+
+    // Solid blocks keep liquid out, anything else (like air, furniture, or an actuated block) lets it in
+    static bool blocks_liquid(const Terraria::Tile&);
+
+private:
+    struct Chunk
+    {
+        // Empty if the chunk has never had any liquid
+        Vector<u8> liquids;
+    };
+
+    u8* liquid_pointer(int x, int y);
+
+    u16 chunk_width(size_t chunk_index) const;
+
+    u16 chunk_height(size_t chunk_index) const;
+
+    u16 m_width;
+    u16 m_height;
+    u16 m_chunks_x;
+    Vector<Chunk> m_chunks;
+};
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/QuickSort.h>
+#include <Editor/NameTable.h>
+#include <LibTerraria/Model.h>
+#include <ctype.h>
+#include <string.h>
+
+const NameTable& NameTable::tiles()
+{
+    static NameTable table(Terraria::s_total_tiles, [](auto id)
+    {
+        return Terraria::s_tiles[id].internal_name;
+    });
+
+    return table;
+}
+
+const NameTable& NameTable::items()
+{
+    // Item ids start at 1, so the table does too
+    static NameTable table(Terraria::s_total_items + 1, [](auto id)
+    {
+        if (id == 0)
+            return StringView("None");
+
+        return Terraria::s_items[id - 1].english_name;
+    });
+
+    return table;
+}
+
+const NameTable& NameTable::prefixes()
+{
+    // Same goes for prefixes, where 0 is Terraria::Item::Prefix::None
+    static NameTable table(Terraria::s_total_prefixes + 1, [](auto id)
+    {
+        if (id == 0)
+            return StringView("None");
+
+        return Terraria::s_prefixes[id - 1].english_name;
+    });
+
+    return table;
+}
+
+NameTable::NameTable(size_t count, Function<StringView(size_t)> name_for_id)
+{
+    m_offsets.ensure_capacity(count);
+    m_ids_by_name.ensure_capacity(count);
+
+    for (size_t id = 0; id < count; id++)
+    {
+        auto name = name_for_id(id);
+        m_offsets.unchecked_append(m_characters.size());
+        m_ids_by_name.unchecked_append(id);
+
+        for (auto character : name)
+        {
+            m_characters.append(character);
+            m_lowercase_characters.append(static_cast<char>(tolower(static_cast<unsigned char>(character))));
+        }
+
+        m_characters.append('\0');
+        m_lowercase_characters.append('\0');
+    }
+
+    quick_sort(m_ids_by_name, [this](auto a, auto b)
+    {
+        return strcmp(lowercase_name(a), lowercase_name(b)) < 0;
+    });
+}
+
+void NameTable::for_each_id_with_prefix(const StringView& prefix, Function<void(u16)> callback) const
+{
+    Vector<char> lowercase_prefix;
+    for (auto character : prefix)
+        lowercase_prefix.append(static_cast<char>(tolower(static_cast<unsigned char>(character))));
+    lowercase_prefix.append('\0');
+
+    auto starts_with_prefix = [&](auto id)
+    {
+        return strncmp(lowercase_name(id), lowercase_prefix.data(), prefix.length()) == 0;
+    };
+
+    // Find the first name that sorts at or after the prefix, everything starting with it comes right after that
+    size_t low = 0;
+    size_t high = m_ids_by_name.size();
+    while (low < high)
+    {
+        auto middle = low + (high - low) / 2;
+        if (strcmp(lowercase_name(m_ids_by_name[middle]), lowercase_prefix.data()) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    for (auto i = low; i < m_ids_by_name.size() && starts_with_prefix(m_ids_by_name[i]); i++)
+        callback(m_ids_by_name[i]);
+}
+
+Optional<u16> NameTable::find(const StringView& name) const
+{
+    Optional<u16> found;
+    for_each_id_with_prefix(name, [&](auto id)
+    {
+        if (!found.has_value() && name == this->name(id))
+            found = id;
+    });
+
+    return found;
+}
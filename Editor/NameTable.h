@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/Optional.h>
+#include <AK/StringView.h>
+#include <AK/Vector.h>
+
+// The names of every tile, item or prefix, stored back to back with null terminators so ImGui can use them directly,
+// plus an index sorted by lowercase name, for finding every name starting with what the user has typed so far.
+class NameTable
+{
+public:
+    static const NameTable& tiles();
+
+    static const NameTable& items();
+
+    static const NameTable& prefixes();
+
+    NameTable(size_t count, Function<StringView(size_t)> name_for_id);
+
+    const char* name(size_t id) const
+    { return &m_characters[m_offsets[id]]; }
+
+    size_t size() const
+    { return m_offsets.size(); }
+
+    // The ids of every name starting with the prefix, ignoring case, in alphabetical order
+    void for_each_id_with_prefix(const StringView& prefix, Function<void(u16)>) const;
+
+    // The id with exactly this name, if there is one
+    Optional<u16> find(const StringView& name) const;
+
+private:
+    const char* lowercase_name(size_t id) const
+    { return &m_lowercase_characters[m_offsets[id]]; }
+
+    Vector<char> m_characters;
+    Vector<char> m_lowercase_characters;
+    Vector<size_t> m_offsets;
+    Vector<u16> m_ids_by_name;
+};
@@ -5,52 +5,157 @@
  */
 
 #include <Editor/Object.h>
+#include <LibCore/File.h>
 
 Vector<Object> Object::s_all_objects;
+Vector<Terraria::Tile> Object::s_tile_templates;
+HashMap<u16, Vector<size_t>> Object::s_objects_by_block;
+HashMap<String, size_t> Object::s_objects_by_name;
+OwnPtr<NameTable> Object::s_names;
 
-Object::Object(String name, u8 width, u8 height, Vector<Terraria::Tile> tiles, Optional<int> style_offset_x,
-               Optional<int> style_offset_y, bool individual_styling)
+Object::Object(String name, u8 width, u8 height, Terraria::Tile::Block::Id id, size_t first_tile,
+               Optional<int> style_offset_x, Optional<int> style_offset_y, bool individual_styling)
         : m_name(move(name)),
           m_width(width),
           m_height(height),
-          m_tiles(move(tiles)),
+          m_block_id(id),
+          m_first_tile(first_tile),
           m_style_offset_x(move(style_offset_x)),
           m_style_offset_y(move(style_offset_y)),
           m_individual_styling(individual_styling)
 {
-    s_all_objects.append(*this);
 }
 
-Object::Object(String name, u8 width, u8 height, Terraria::Tile::Block::Id id, Optional<int> style_offset_x,
-               Optional<int> style_offset_y,
-               bool individual_styling)
-        : m_name(move(name)),
-          m_width(width),
-          m_height(height),
-          m_style_offset_x(move(style_offset_x)),
-          m_style_offset_y(move(style_offset_y)),
-          m_individual_styling(individual_styling)
+size_t Object::tile_templates_for(Terraria::Tile::Block::Id id, u8 width, u8 height)
+{
+    // Lots of objects are different styles of the same block (and therefore the same tiles), so share those
+    static HashMap<u32, size_t> s_first_tile_by_shape;
+    auto shape = static_cast<u32>(id) | (width << 16) | (height << 24);
+    if (auto first_tile = s_first_tile_by_shape.get(shape); first_tile.has_value())
+        return *first_tile;
+
+    auto first_tile = s_tile_templates.size();
+    for (auto y = 0; y < height; y++)
+    {
+        for (auto x = 0; x < width; x++)
+            s_tile_templates.append(Terraria::Tile(Terraria::Tile::Block(id, 18 * x, 18 * y)));
+    }
+
+    s_first_tile_by_shape.set(shape, first_tile);
+    return first_tile;
+}
+
+bool Object::load_all_objects(const String& path)
 {
-    for (auto y = 0; y < m_height; y++)
+    auto file_or_error = Core::File::open(path, Core::OpenMode::ReadOnly);
+    if (file_or_error.is_error())
+    {
+        warnln("Failed to open object catalog {}: {}", path, file_or_error.error());
+        return false;
+    }
+
+    auto contents = file_or_error.value()->read_all();
+    auto lines = StringView(contents).lines();
+
+    auto parse_style_offset = [](const StringView& token) -> Optional<int>
+    {
+        if (token == "-")
+            return {};
+
+        auto offset = token.to_uint();
+        if (!offset.has_value())
+            return {};
+
+        return static_cast<int>(*offset);
+    };
+
+    for (size_t line_number = 1; line_number <= lines.size(); line_number++)
     {
-        for (auto x = 0; x < m_width; x++)
+        auto line = lines[line_number - 1].trim_whitespace();
+        if (line.is_empty() || line.starts_with('#'))
+            continue;
+
+        // <block> <width> <height> <style offset x> <style offset y> <flags> <name, which may contain spaces>
+        auto tokens = line.split_view(' ');
+        if (tokens.size() < 7)
+        {
+            warnln("{}:{}: Expected 7 columns, got {}", path, line_number, tokens.size());
+            continue;
+        }
+
+        auto id = NameTable::tiles().find(tokens[0]);
+        if (!id.has_value())
+        {
+            warnln("{}:{}: Unknown block {}", path, line_number, tokens[0]);
+            continue;
+        }
+
+        auto width = tokens[1].to_uint();
+        auto height = tokens[2].to_uint();
+        if (!width.has_value() || !height.has_value() || *width == 0 || *height == 0 || *width > 255 ||
+            *height > 255)
+        {
+            warnln("{}:{}: Bad size {}x{}", path, line_number, tokens[1], tokens[2]);
+            continue;
+        }
+
+        auto name_start = tokens[6].characters_without_null_termination() - line.characters_without_null_termination();
+        String name = line.substring_view(name_start);
+        if (s_objects_by_name.contains(name))
         {
-            Terraria::Tile tile(Terraria::Tile::Block(id, 18 * x, 18 * y));
-            m_tiles.append(move(tile));
+            warnln("{}:{}: There is already an object named {}", path, line_number, name);
+            continue;
         }
+
+        auto block_id = static_cast<Terraria::Tile::Block::Id>(*id);
+        auto first_tile = tile_templates_for(block_id, *width, *height);
+
+        // One style can't say where an object is in both directions, so with both offsets it's always individual
+        auto style_offset_x = parse_style_offset(tokens[3]);
+        auto style_offset_y = parse_style_offset(tokens[4]);
+        auto individual_styling = tokens[5].contains('i') || (style_offset_x.has_value() && style_offset_y.has_value());
+
+        s_objects_by_block.ensure(*id).append(s_all_objects.size());
+        s_objects_by_name.set(name, s_all_objects.size());
+        s_all_objects.append(Object(name, *width, *height, block_id, first_tile, style_offset_x, style_offset_y,
+                                    individual_styling));
     }
 
-    s_all_objects.append(*this);
+    s_names = make<NameTable>(s_all_objects.size(), [](auto id)
+    {
+        return s_all_objects[id].name().view();
+    });
+
+    outln("Loaded {} objects", s_all_objects.size());
+    return !s_all_objects.is_empty();
 }
 
-static Object life_crystal("Life Crystal", 2, 2, Terraria::Tile::Block::Id::Heart);
-static Object work_bench("Work Bench", 2, 1, Terraria::Tile::Block::Id::WorkBenches, 18 * 2);
-static Object pot("Pot", 2, 2, Terraria::Tile::Block::Id::Pots, 18 * 2, 18 * 2);
-static Object bed("Bed", 4, 2, Terraria::Tile::Block::Id::Beds, 18 * 4, 18 * 2, true);
-static Object campfire("Campfire", 3, 2, Terraria::Tile::Block::Id::Campfire, 18 * 3);
-static Object anvil("Anvil", 2, 1, Terraria::Tile::Block::Id::Anvils, 18 * 2);
-static Object myhril_anvil("Mythril Anvil", 2, 1, Terraria::Tile::Block::Id::MythrilAnvil, 18 * 2);
-static Object furnace("Furnace", 3, 2, Terraria::Tile::Block::Id::Furnaces);
-static Object alchemy_table("Alchemy Table", 3, 3, Terraria::Tile::Block::Id::AlchemyTable);
-static Object statues("Statues", 2, 3, Terraria::Tile::Block::Id::Statues, 18 * 2, 18 * 3, true);
-static Object alphabet_statues("Alphabet Statues", 2, 3, Terraria::Tile::Block::Id::AlphabetStatues, 18 * 2);
\ No newline at end of file
+Terraria::Tile Object::tile_for_style(u8 x, u8 y, int style_x, int style_y) const
+{
+    auto tile = tiles().at(index_for_position(x, y));
+    if (m_style_offset_x.has_value())
+        *tile.block()->frame_x() += *m_style_offset_x * style_x;
+
+    if (m_style_offset_y.has_value())
+        *tile.block()->frame_y() += *m_style_offset_y * style_y;
+
+    return tile;
+}
+
+Span<const size_t> Object::objects_for_block(Terraria::Tile::Block::Id id)
+{
+    auto it = s_objects_by_block.find(static_cast<u16>(id));
+    if (it == s_objects_by_block.end())
+        return {};
+
+    return it->value.span();
+}
+
+const Object* Object::find_by_name(const StringView& name)
+{
+    auto index = s_objects_by_name.get(String(name));
+    if (!index.has_value())
+        return nullptr;
+
+    return &s_all_objects[*index];
+}
@@ -6,24 +6,31 @@
 
 #pragma once
 
-#include <AK/Types.h>
+#include <AK/HashMap.h>
+#include <AK/Span.h>
 #include <AK/String.h>
 #include <AK/Vector.h>
-#include <initializer_list>
+#include <Editor/NameTable.h>
 #include <LibTerraria/Tile.h>
 
 class Object
 {
 public:
-    Object(String name, u8 width, u8 height, Terraria::Tile::Block::Id, Optional<int> style_offset_x = {},
-           Optional<int> style_offset_y = {}, bool individual_styling = false);
-
-    Object(String name, u8 width, u8 height, Vector<Terraria::Tile> tiles, Optional<int> style_offset_x = {},
-           Optional<int> style_offset_y = {}, bool individual_styling = false);
+    // Loads the object catalog, see Objects.txt for what it looks like.
+    // Returns false (after complaining about why) if the file couldn't be read at all, bad lines are just skipped.
+    static bool load_all_objects(const String& path);
 
     static const Vector<Object>& all_objects()
     { return s_all_objects; }
 
+    // Indices into all_objects() of every object made out of this block
+    static Span<const size_t> objects_for_block(Terraria::Tile::Block::Id);
+
+    static const Object* find_by_name(const StringView&);
+
+    static const NameTable& names()
+    { return *s_names; }
+
     const String& name() const
     { return m_name; }
 
@@ -33,6 +40,9 @@ public:
     u8 height() const
     { return m_height; }
 
+    Terraria::Tile::Block::Id block_id() const
+    { return m_block_id; }
+
     const Optional<int>& style_offset_x() const
     { return m_style_offset_x; }
 
@@ -42,22 +52,36 @@ public:
     bool is_individually_styled() const
     { return m_individual_styling; }
 
-    const Vector<Terraria::Tile>& tiles() const
-    { return m_tiles; }
+    // Objects of the same block and size share the same tiles, so this points into a table shared by all of them
+    Span<const Terraria::Tile> tiles() const
+    { return s_tile_templates.span().slice(m_first_tile, m_width * m_height); }
 
     ALWAYS_INLINE constexpr size_t index_for_position(u8 x, u8 y) const
     {
         return x + (m_width * y);
     }
 
+    // The tile at this position of the object, framed for the given style
+    Terraria::Tile tile_for_style(u8 x, u8 y, int style_x, int style_y) const;
+
 private:
+    Object(String name, u8 width, u8 height, Terraria::Tile::Block::Id, size_t first_tile,
+           Optional<int> style_offset_x, Optional<int> style_offset_y, bool individual_styling);
+
+    static size_t tile_templates_for(Terraria::Tile::Block::Id, u8 width, u8 height);
+
     static Vector<Object> s_all_objects;
+    static Vector<Terraria::Tile> s_tile_templates;
+    static HashMap<u16, Vector<size_t>> s_objects_by_block;
+    static HashMap<String, size_t> s_objects_by_name;
+    static OwnPtr<NameTable> s_names;
 
     String m_name;
     u8 m_width;
     u8 m_height;
+    Terraria::Tile::Block::Id m_block_id;
+    size_t m_first_tile;
     Optional<int> m_style_offset_x;
     Optional<int> m_style_offset_y;
     bool m_individual_styling{};
-    Vector<Terraria::Tile> m_tiles;
-};
\ No newline at end of file
+};
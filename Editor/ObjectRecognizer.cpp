@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/ObjectRecognizer.h>
+
+// Every tile of an object is 16 pixels, with a 2 pixel gap after it
+static constexpr int frame_stride = 18;
+
+ObjectRecognizer::ObjectRecognizer(const ChunkedTileMap& tiles)
+        : m_tiles(tiles)
+{
+}
+
+Optional<RecognizedObject> ObjectRecognizer::object_at(int x, int y)
+{
+    if (!m_tiles.contains(x, y))
+        return {};
+
+    auto chunk_index = m_tiles.chunk_index_for_position(x, y);
+    auto it = m_recognized_chunks.find(chunk_index);
+    if (it == m_recognized_chunks.end())
+    {
+        HashMap<u16, RecognizedObject> recognized;
+        m_tiles.for_each_tile_in_chunk(chunk_index, [&](auto tile_x, auto tile_y, auto& tile)
+        {
+            auto object = recognize(tile_x, tile_y, tile);
+            if (object.has_value())
+            {
+                auto local_index = (tile_x % ChunkedTileMap::chunk_size) +
+                                   (ChunkedTileMap::chunk_size * (tile_y % ChunkedTileMap::chunk_size));
+                recognized.set(local_index, *object);
+            }
+        });
+
+        m_recognized_chunks.set(chunk_index, move(recognized));
+        it = m_recognized_chunks.find(chunk_index);
+    }
+
+    auto local_index = (x % ChunkedTileMap::chunk_size) +
+                       (ChunkedTileMap::chunk_size * (y % ChunkedTileMap::chunk_size));
+    return it->value.get(local_index);
+}
+
+void ObjectRecognizer::invalidate_chunk(size_t chunk_index)
+{
+    m_recognized_chunks.remove(chunk_index);
+}
+
+Optional<RecognizedObject> ObjectRecognizer::recognize(int x, int y, const Terraria::Tile& tile)
+{
+    if (!tile.block().has_value())
+        return {};
+
+    auto& block = *tile.block();
+    int frame_x = block.frame_x().has_value() ? *block.frame_x() : 0;
+    int frame_y = block.frame_y().has_value() ? *block.frame_y() : 0;
+
+    // Splits a frame into which style it is, and where in the object it is
+    auto split_frame = [](int frame, const Optional<int>& style_offset, int size, int& style, int& position)
+    {
+        auto frame_in_style = frame;
+        style = 0;
+        if (style_offset.has_value() && *style_offset > 0)
+        {
+            style = frame / *style_offset;
+            frame_in_style = frame % *style_offset;
+        }
+
+        if (frame_in_style % frame_stride != 0)
+            return false;
+
+        position = frame_in_style / frame_stride;
+        return position < size;
+    };
+
+    for (auto object_index : Object::objects_for_block(block.id()))
+    {
+        auto& object = Object::all_objects()[object_index];
+
+        int style_x;
+        int style_y;
+        int position_x;
+        int position_y;
+        if (!split_frame(frame_x, object.style_offset_x(), object.width(), style_x, position_x) ||
+            !split_frame(frame_y, object.style_offset_y(), object.height(), style_y, position_y))
+        {
+            continue;
+        }
+
+        // Objects that aren't individually styled only have one style, which is whichever way they're laid out.
+        // Anything styled in both directions is individually styled, so both of those are kept.
+        if (!object.is_individually_styled())
+        {
+            if (object.style_offset_x().has_value())
+                style_y = style_x;
+            else
+                style_x = style_y;
+        }
+
+        return RecognizedObject{&object, x - position_x, y - position_y, style_x, style_y};
+    }
+
+    return {};
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/HashMap.h>
+#include <AK/Optional.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/Object.h>
+
+// A placed object, found from one of its tiles
+struct RecognizedObject
+{
+    const Object* object;
+    int origin_x;
+    int origin_y;
+    int style_x;
+    int style_y;
+};
+
+// Works out which Object every tile of the map belongs to, from its block and frame. This is done for a whole chunk
+// the first time something in it is asked about, and remembered until the chunk changes.
+class ObjectRecognizer
+{
+public:
+    explicit ObjectRecognizer(const ChunkedTileMap&);
+
+    // The tile map must not be written to while this is running
+    Optional<RecognizedObject> object_at(int x, int y);
+
+    void invalidate_chunk(size_t chunk_index);
+
+    // Which object the tile at this position is part of, if any. This only looks at the tile itself.
+    static Optional<RecognizedObject> recognize(int x, int y, const Terraria::Tile&);
+
+private:
+    const ChunkedTileMap& m_tiles;
+
+    // Keyed by chunk, then by the tile's position within the chunk. Tiles that aren't part of any object are left out.
+    HashMap<size_t, HashMap<u16, RecognizedObject>> m_recognized_chunks;
+};
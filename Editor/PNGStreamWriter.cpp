@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/PNGStreamWriter.h>
+
+// Compressed image data gets split up into IDAT chunks of (at most) this size
+static constexpr size_t idat_chunk_size = 64 * KiB;
+
+static void write_be_u32(u8* destination, u32 value)
+{
+    destination[0] = value >> 24;
+    destination[1] = value >> 16;
+    destination[2] = value >> 8;
+    destination[3] = value;
+}
+
+OwnPtr<PNGStreamWriter> PNGStreamWriter::create(const String& path, u32 width, u32 height)
+{
+    auto file_or_error = Core::File::open(path, Core::OpenMode::WriteOnly);
+    if (file_or_error.is_error())
+    {
+        warnln("Failed to open {} for writing: {}", path, file_or_error.error());
+        return {};
+    }
+
+    auto writer = adopt_own(*new PNGStreamWriter(file_or_error.release_value(), width, height));
+    if (deflateInit(&writer->m_deflate_stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+        warnln("Failed to start compressing {}", path);
+        return {};
+    }
+    writer->m_deflate_stream_initialized = true;
+
+    static constexpr u8 signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if (!writer->m_file->write(signature, sizeof(signature)))
+    {
+        warnln("Failed to write to {}", path);
+        return {};
+    }
+
+    u8 header[13];
+    write_be_u32(header, width);
+    write_be_u32(header + 4, height);
+    header[8] = 8; // Bit depth
+    header[9] = 6; // Color type, RGBA
+    header[10] = 0; // Compression method, deflate
+    header[11] = 0; // Filter method, the only one
+    header[12] = 0; // No interlacing
+    if (!writer->write_chunk("IHDR", header, sizeof(header)))
+    {
+        warnln("Failed to write to {}", path);
+        return {};
+    }
+
+    return writer;
+}
+
+PNGStreamWriter::PNGStreamWriter(NonnullRefPtr<Core::File> file, u32 width, u32 height)
+        : m_file(move(file)),
+          m_width(width),
+          m_height(height)
+{
+    m_compressed.resize(idat_chunk_size);
+}
+
+PNGStreamWriter::~PNGStreamWriter()
+{
+    if (m_deflate_stream_initialized)
+        deflateEnd(&m_deflate_stream);
+}
+
+bool PNGStreamWriter::write_rows(const u8* rows, u32 row_count)
+{
+    VERIFY(m_rows_written + row_count <= m_height);
+
+    // Every row starts with the filter it uses. We don't bother filtering, deflate does well enough on tiles anyway.
+    static constexpr u8 no_filter = 0;
+    auto row_size = static_cast<size_t>(m_width) * 4;
+    for (u32 row = 0; row < row_count; row++)
+    {
+        if (!deflate_and_write(&no_filter, 1, Z_NO_FLUSH) ||
+            !deflate_and_write(rows + (row * row_size), row_size, Z_NO_FLUSH))
+        {
+            return false;
+        }
+    }
+
+    m_rows_written += row_count;
+    return true;
+}
+
+bool PNGStreamWriter::finish()
+{
+    VERIFY(m_rows_written == m_height);
+
+    if (!deflate_and_write(nullptr, 0, Z_FINISH))
+        return false;
+
+    return write_chunk("IEND", nullptr, 0);
+}
+
+bool PNGStreamWriter::deflate_and_write(const u8* data, size_t size, int flush)
+{
+    m_deflate_stream.next_in = const_cast<u8*>(data);
+    m_deflate_stream.avail_in = size;
+
+    for (;;)
+    {
+        m_deflate_stream.next_out = m_compressed.data();
+        m_deflate_stream.avail_out = m_compressed.size();
+
+        auto result = deflate(&m_deflate_stream, flush);
+        if (result == Z_STREAM_ERROR)
+            return false;
+
+        auto compressed_size = m_compressed.size() - m_deflate_stream.avail_out;
+        if (compressed_size > 0 && !write_chunk("IDAT", m_compressed.data(), compressed_size))
+            return false;
+
+        // When finishing, keep going until zlib says it's done. Otherwise, until it has eaten all of our input.
+        if (flush == Z_FINISH ? result == Z_STREAM_END : m_deflate_stream.avail_out != 0)
+            return true;
+    }
+}
+
+bool PNGStreamWriter::write_chunk(const char* type, const u8* data, u32 size)
+{
+    u8 length[4];
+    write_be_u32(length, size);
+
+    auto crc = crc32(0, reinterpret_cast<const u8*>(type), 4);
+    if (size > 0)
+        crc = crc32(crc, data, size);
+
+    u8 crc_bytes[4];
+    write_be_u32(crc_bytes, crc);
+
+    return m_file->write(length, 4) && m_file->write(reinterpret_cast<const u8*>(type), 4) &&
+           (size == 0 || m_file->write(data, size)) && m_file->write(crc_bytes, 4);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/OwnPtr.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <LibCore/File.h>
+#include <zlib.h>
+
+// Writes an RGBA PNG a few rows at a time, so the whole image never has to be in memory at once (which it couldn't
+// be for a big world). Gfx::PNGWriter wants a whole Bitmap, which is why this exists.
+class PNGStreamWriter
+{
+public:
+    // Returns null (after complaining about why) if the file couldn't be created
+    static OwnPtr<PNGStreamWriter> create(const String& path, u32 width, u32 height);
+
+    ~PNGStreamWriter();
+
+    // Each row is width * 4 bytes of RGBA
+    bool write_rows(const u8* rows, u32 row_count);
+
+    // Call this once every row has been written, otherwise the PNG is left unfinished
+    bool finish();
+
+private:
+    PNGStreamWriter(NonnullRefPtr<Core::File>, u32 width, u32 height);
+
+    bool write_chunk(const char* type, const u8* data, u32 size);
+
+    bool deflate_and_write(const u8* data, size_t size, int flush);
+
+    NonnullRefPtr<Core::File> m_file;
+    u32 m_width;
+    u32 m_height;
+    u32 m_rows_written{};
+
+    z_stream m_deflate_stream{};
+    bool m_deflate_stream_initialized{};
+    Vector<u8> m_compressed;
+};
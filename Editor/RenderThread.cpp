@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/RenderThread.h>
+#include <GL/glew.h>
+#include <imgui/backends/imgui_impl_opengl3.h>
+
+RenderThread::Frame::~Frame()
+{
+    for (auto* draw_list : draw_lists)
+        IM_DELETE(draw_list);
+}
+
+RenderThread::RenderThread(SDL_Window* window, SDL_GLContext context, const char* glsl_version, bool vsync,
+                           bool finish_frames)
+        : m_window(window),
+          m_context(context),
+          m_vsync(vsync),
+          m_finish_frames(finish_frames),
+          m_building_frame(make<Frame>()),
+          m_thread([this] { run(); })
+{
+    // This makes the font texture too. Waiting for it means the UI thread sees everything the backend put in the IO
+    // before it starts its first frame.
+    run_and_wait([&]
+    {
+        ImGui_ImplOpenGL3_Init(glsl_version);
+        ImGui_ImplOpenGL3_NewFrame();
+    });
+}
+
+RenderThread::~RenderThread()
+{
+    {
+        std::unique_lock locker(m_mutex);
+        m_exit_requested = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+}
+
+void RenderThread::run_before_frame(Function<void()> job)
+{
+    m_building_frame->jobs.append(move(job));
+}
+
+void RenderThread::add_draw_callback(ImDrawList* draw_list, Function<void()> callback)
+{
+    auto boxed_callback = make<Function<void()>>(move(callback));
+    draw_list->AddCallback(run_draw_callback, boxed_callback.ptr());
+    m_building_frame->callbacks.append(move(boxed_callback));
+}
+
+void RenderThread::run_draw_callback(const ImDrawList*, const ImDrawCmd* command)
+{
+    (*static_cast<Function<void()>*>(command->UserCallbackData))();
+}
+
+void RenderThread::submit_frame(ImDrawData* draw_data)
+{
+    // ImGui reuses its draw lists for the next frame, so we need our own copies of them
+    auto frame = exchange(m_building_frame, make<Frame>());
+    frame->draw_lists.ensure_capacity(draw_data->CmdListsCount);
+    for (auto i = 0; i < draw_data->CmdListsCount; i++)
+        frame->draw_lists.unchecked_append(draw_data->CmdLists[i]->CloneOutput());
+
+    frame->draw_data = *draw_data;
+    frame->draw_data.CmdLists = frame->draw_lists.data();
+
+    {
+        std::unique_lock locker(m_mutex);
+        m_condition.wait(locker, [&] { return !m_pending_frame; });
+        m_pending_frame = move(frame);
+    }
+    m_condition.notify_all();
+}
+
+void RenderThread::run_and_wait(Function<void()> job)
+{
+    std::unique_lock locker(m_mutex);
+    m_immediate_jobs.append(move(job));
+    auto job_number = ++m_immediate_jobs_submitted;
+    m_condition.notify_all();
+    m_condition.wait(locker, [&] { return m_immediate_jobs_done >= job_number; });
+}
+
+void RenderThread::wait_until_idle()
+{
+    std::unique_lock locker(m_mutex);
+    m_condition.wait(locker, [&] { return !m_pending_frame && !m_is_rendering; });
+}
+
+void RenderThread::run()
+{
+    SDL_GL_MakeCurrent(m_window, m_context);
+    SDL_GL_SetSwapInterval(m_vsync ? 1 : 0);
+
+    for (;;)
+    {
+        OwnPtr<Frame> frame;
+        Vector<Function<void()>> immediate_jobs;
+        {
+            std::unique_lock locker(m_mutex);
+            m_condition.wait(locker, [&]
+            {
+                return m_exit_requested || m_pending_frame || !m_immediate_jobs.is_empty();
+            });
+
+            if (m_exit_requested)
+                break;
+
+            immediate_jobs = move(m_immediate_jobs);
+            frame = move(m_pending_frame);
+            m_is_rendering = !frame.is_null();
+        }
+
+        if (!immediate_jobs.is_empty())
+        {
+            for (auto& job : immediate_jobs)
+                job();
+
+            std::unique_lock locker(m_mutex);
+            m_immediate_jobs_done += immediate_jobs.size();
+        }
+
+        // Taking the frame frees up the slot for the next one, so the UI thread can already be building it
+        m_condition.notify_all();
+
+        if (frame)
+        {
+            render(*frame);
+
+            // Freed outside of the lock, as there could be a lot of draw lists
+            frame = nullptr;
+            {
+                std::unique_lock locker(m_mutex);
+                m_is_rendering = false;
+            }
+            m_condition.notify_all();
+        }
+    }
+
+    // The UI thread is waiting for us to exit, so it isn't building a frame
+    ImGui_ImplOpenGL3_Shutdown();
+    SDL_GL_MakeCurrent(m_window, nullptr);
+}
+
+void RenderThread::render(Frame& frame)
+{
+    for (auto& job : frame.jobs)
+        job();
+
+    auto& draw_data = frame.draw_data;
+    glViewport(0, 0, static_cast<int>(draw_data.DisplaySize.x * draw_data.FramebufferScale.x),
+               static_cast<int>(draw_data.DisplaySize.y * draw_data.FramebufferScale.y));
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    ImGui_ImplOpenGL3_RenderDrawData(&draw_data);
+    SDL_GL_SwapWindow(m_window);
+
+    // Otherwise a frame is only done as far as the CPU is concerned
+    if (m_finish_frames)
+        glFinish();
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <SDL2/SDL_video.h>
+#include <imgui/imgui.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Does every bit of GL work once the editor has started, on its own thread, with the GL context current there and
+// nowhere else. The UI thread builds a frame, hands a copy of its draw data over with submit_frame(), and goes on to
+// the next one while this one is drawn and presented (and waits on vsync). There's only ever one frame waiting, so
+// the UI thread is never more than a frame ahead.
+// GL work that belongs to a frame (like uploading tiles) is queued up with run_before_frame() while building it, and
+// custom drawing is added to a draw list with add_draw_callback(), so neither ever has to touch GL itself.
+// ImGui's OpenGL backend is set up, used and shut down here and nowhere else. Its state lives in the UI thread's ImGui
+// context, but it only ever reads it back through IO.BackendRendererUserData, which is set before the UI thread's
+// first frame and never changes after that. Frames only point at our own copies of the draw lists, so as long as the
+// UI thread never calls into the backend itself (or rebuilds the font atlas), we never share anything with it.
+class RenderThread
+{
+public:
+    // The context must not be current on the calling thread anymore. The ImGui context has to exist already, but its
+    // OpenGL backend is only set up once we've started.
+    RenderThread(SDL_Window*, SDL_GLContext, const char* glsl_version, bool vsync, bool finish_frames);
+
+    ~RenderThread();
+
+    // Only ever call these from the UI thread, while building a frame
+    void run_before_frame(Function<void()>);
+
+    void add_draw_callback(ImDrawList*, Function<void()>);
+
+    // Copies the draw data, so ImGui can go straight on to the next frame. Waits if the last frame we were given
+    // hasn't been picked up yet.
+    void submit_frame(ImDrawData*);
+
+    // For GL work the UI thread needs the result of right away, which happens on this thread as soon as it can
+    void run_and_wait(Function<void()>);
+
+    // Waits until every frame we were given has been presented
+    void wait_until_idle();
+
+private:
+    struct Frame
+    {
+        Frame() = default;
+
+        ~Frame();
+
+        ImDrawData draw_data;
+        Vector<ImDrawList*> draw_lists;
+        Vector<Function<void()>> jobs;
+        // Boxed, as the draw lists point to them
+        Vector<NonnullOwnPtr<Function<void()>>> callbacks;
+    };
+
+    static void run_draw_callback(const ImDrawList*, const ImDrawCmd*);
+
+    void run();
+
+    void render(Frame&);
+
+    SDL_Window* m_window;
+    SDL_GLContext m_context;
+    bool m_vsync;
+    bool m_finish_frames;
+
+    // What the UI thread is building, only ever touched from there
+    NonnullOwnPtr<Frame> m_building_frame;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    // Everything below is guarded by the mutex
+    OwnPtr<Frame> m_pending_frame;
+    bool m_is_rendering{};
+    Vector<Function<void()>> m_immediate_jobs;
+    size_t m_immediate_jobs_submitted{};
+    size_t m_immediate_jobs_done{};
+    bool m_exit_requested{};
+
+    std::thread m_thread;
+};
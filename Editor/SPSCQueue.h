@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/Optional.h>
+#include <AK/StdLibExtras.h>
+
+// A fixed size ring buffer that one thread pushes into and exactly one other thread pops from, without any locking.
+template<typename T, size_t Capacity>
+class SPSCQueue
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Only ever call this from the producing thread. Returns false if the queue is full.
+    bool try_enqueue(T&& value)
+    {
+        auto tail = m_tail.load(AK::MemoryOrder::memory_order_relaxed);
+        if (tail - m_head.load(AK::MemoryOrder::memory_order_acquire) == Capacity)
+            return false;
+
+        m_slots[tail & (Capacity - 1)] = move(value);
+        m_tail.store(tail + 1, AK::MemoryOrder::memory_order_release);
+        return true;
+    }
+
+    // Only ever call this from the consuming thread.
+    Optional<T> try_dequeue()
+    {
+        auto head = m_head.load(AK::MemoryOrder::memory_order_relaxed);
+        if (head == m_tail.load(AK::MemoryOrder::memory_order_acquire))
+            return {};
+
+        auto value = move(m_slots[head & (Capacity - 1)]);
+        m_head.store(head + 1, AK::MemoryOrder::memory_order_release);
+        return value;
+    }
+
+    bool is_empty() const
+    {
+        return m_head.load(AK::MemoryOrder::memory_order_acquire) == m_tail.load(AK::MemoryOrder::memory_order_acquire);
+    }
+
+private:
+    T m_slots[Capacity];
+
+    // The two ends are written by different threads, so keep them off each other's cache line
+    alignas(64) Atomic<size_t> m_head{0};
+    alignas(64) Atomic<size_t> m_tail{0};
+};
@@ -0,0 +1,748 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/NumericLimits.h>
+#include <Editor/ChestIndex.h>
+#include <Editor/NameTable.h>
+#include <Editor/Object.h>
+#include <Editor/ScriptEngine.h>
+#include <LibCore/File.h>
+#include <LibTerraria/Model.h>
+#include <lua.hpp>
+
+// Lua raises errors with longjmp, which skips the destructors of anything on the way. Everything that can raise one
+// (like checking arguments) is done while only plain ints and pointers are alive, and the rest is in its own scope.
+
+static const char* s_wire_colors[] = {"red", "blue", "green", "yellow", nullptr};
+
+// A block is either its id or its name, and nil is air (which we return as -1)
+static int check_block(lua_State* lua, int arg)
+{
+    if (lua_isnoneornil(lua, arg))
+        return -1;
+
+    if (lua_type(lua, arg) == LUA_TSTRING)
+    {
+        int id = -1;
+        {
+            auto found = NameTable::tiles().find(lua_tostring(lua, arg));
+            if (found.has_value())
+                id = *found;
+        }
+
+        if (id < 0)
+            luaL_error(lua, "unknown block %s", lua_tostring(lua, arg));
+        return id;
+    }
+
+    auto id = luaL_checkinteger(lua, arg);
+    luaL_argcheck(lua, id >= 0 && id < Terraria::s_total_tiles, arg, "not a block");
+    return static_cast<int>(id);
+}
+
+// Same goes for items, with nil meaning no item
+static int check_item(lua_State* lua, int arg)
+{
+    if (lua_isnoneornil(lua, arg))
+        return -1;
+
+    if (lua_type(lua, arg) == LUA_TSTRING)
+    {
+        int id = -1;
+        {
+            auto found = NameTable::items().find(lua_tostring(lua, arg));
+            if (found.has_value())
+                id = *found;
+        }
+
+        if (id < 0)
+            luaL_error(lua, "unknown item %s", lua_tostring(lua, arg));
+        return id;
+    }
+
+    auto id = luaL_checkinteger(lua, arg);
+    luaL_argcheck(lua, id > 0 && id < Terraria::s_total_items, arg, "not an item");
+    return static_cast<int>(id);
+}
+
+static bool is_block(const Terraria::Tile& tile, int block)
+{
+    if (block < 0)
+        return !tile.block().has_value();
+
+    return tile.block().has_value() && static_cast<int>(tile.block()->id()) == block;
+}
+
+static void set_block(Terraria::Tile& tile, int block)
+{
+    if (block < 0)
+        tile.block() = {};
+    else
+        tile.block() = Terraria::Tile::Block(static_cast<Terraria::Tile::Block::Id>(block));
+}
+
+ScriptEngine::ScriptEngine(Terraria::World& world, ChunkedTileMap& tiles)
+        : m_world(world),
+          m_tiles(tiles)
+{
+}
+
+bool ScriptEngine::run_file(const String& path)
+{
+    auto file_or_error = Core::File::open(path, Core::OpenMode::ReadOnly);
+    if (file_or_error.is_error())
+    {
+        auto error = String::formatted("Failed to open {}: {}", path, file_or_error.error());
+        warnln("{}", error);
+        m_output.append(error);
+        m_output.append('\n');
+        return false;
+    }
+
+    auto source = file_or_error.value()->read_all();
+    // Lua names chunks from files with an @ in front, which makes its errors say file:line
+    return run(StringView(source.data(), source.size()), String::formatted("@{}", path));
+}
+
+bool ScriptEngine::run(const StringView& source, const String& name)
+{
+    auto* lua = luaL_newstate();
+    luaL_openlibs(lua);
+    register_api(lua);
+
+    auto ok = luaL_loadbuffer(lua, source.characters_without_null_termination(), source.length(),
+                              name.characters()) == LUA_OK && lua_pcall(lua, 0, 0, 0) == LUA_OK;
+    if (!ok)
+    {
+        auto* error = lua_tostring(lua, -1);
+        warnln("{}", error);
+        m_output.append(error);
+        m_output.append('\n');
+    }
+
+    lua_close(lua);
+    return ok;
+}
+
+void ScriptEngine::for_each_changed_rect(Function<void(const DirtyRegion::Rect&)> callback) const
+{
+    m_changed_region.for_each_rect(move(callback));
+}
+
+void ScriptEngine::frame_changes()
+{
+    m_changed_region.for_each_rect([&](auto& rect)
+    {
+        m_tiles.frame_region(rect.x, rect.y, rect.end_x, rect.end_y);
+    });
+    m_changed_region.clear();
+}
+
+ScriptEngine& ScriptEngine::engine(lua_State* lua)
+{
+    return *static_cast<ScriptEngine*>(lua_touserdata(lua, lua_upvalueindex(1)));
+}
+
+void ScriptEngine::register_api(lua_State* lua)
+{
+    static const luaL_Reg functions[] = {
+            {"block", lua_block},
+            {"set_block", lua_set_block},
+            {"wire", lua_wire},
+            {"set_wire", lua_set_wire},
+            {"actuator", lua_actuator},
+            {"set_actuator", lua_set_actuator},
+            {"fill", lua_fill},
+            {"replace", lua_replace},
+            {"copy", lua_copy},
+            {"count", lua_count},
+            {"each_tile", lua_each_tile},
+            {"place_object", lua_place_object},
+            {"chests", lua_chests},
+            {"chest", lua_chest},
+            {"set_chest_name", lua_set_chest_name},
+            {"set_chest_item", lua_set_chest_item},
+            {"signs", lua_signs},
+            {"set_sign", lua_set_sign},
+            {nullptr, nullptr},
+    };
+
+    lua_newtable(lua);
+    lua_pushlightuserdata(lua, this);
+    luaL_setfuncs(lua, functions, 1);
+    lua_pushinteger(lua, m_tiles.width());
+    lua_setfield(lua, -2, "width");
+    lua_pushinteger(lua, m_tiles.height());
+    lua_setfield(lua, -2, "height");
+    lua_setglobal(lua, "world");
+
+    // Printing goes to the output too, so the editor can show it
+    lua_pushlightuserdata(lua, this);
+    lua_pushcclosure(lua, lua_print, 1);
+    lua_setglobal(lua, "print");
+}
+
+void ScriptEngine::changed(int x, int y, int end_x, int end_y)
+{
+    m_changed_region.add(max(x, 0), max(y, 0), min<int>(end_x, m_tiles.width()), min<int>(end_y, m_tiles.height()));
+}
+
+bool ScriptEngine::check_region(lua_State* lua, int first_arg, int& x, int& y, int& end_x, int& end_y)
+{
+    auto region_x = luaL_checkinteger(lua, first_arg);
+    auto region_y = luaL_checkinteger(lua, first_arg + 1);
+    auto width = luaL_checkinteger(lua, first_arg + 2);
+    auto height = luaL_checkinteger(lua, first_arg + 3);
+
+    x = static_cast<int>(clamp<lua_Integer>(region_x, 0, m_tiles.width()));
+    y = static_cast<int>(clamp<lua_Integer>(region_y, 0, m_tiles.height()));
+    end_x = static_cast<int>(clamp<lua_Integer>(region_x + width, 0, m_tiles.width()));
+    end_y = static_cast<int>(clamp<lua_Integer>(region_y + height, 0, m_tiles.height()));
+    return x < end_x && y < end_y;
+}
+
+Terraria::Chest* ScriptEngine::chest_at(int x, int y)
+{
+    for (auto& kv : m_world.chests())
+    {
+        auto position = kv.value.position();
+        if (position.x() == x && position.y() == y)
+            return &kv.value;
+    }
+
+    return nullptr;
+}
+
+Terraria::Sign* ScriptEngine::sign_at(int x, int y)
+{
+    for (auto& kv : m_world.signs())
+    {
+        auto position = kv.value.position();
+        if (position.x() == x && position.y() == y)
+            return &kv.value;
+    }
+
+    return nullptr;
+}
+
+size_t ScriptEngine::fill(int x, int y, int end_x, int end_y, int block)
+{
+    size_t changed_tiles = 0;
+    for (auto tile_y = y; tile_y < end_y; tile_y++)
+    {
+        for (auto tile_x = x; tile_x < end_x; tile_x++)
+        {
+            auto& tile = m_tiles.at(tile_x, tile_y);
+            if (is_block(tile, block))
+                continue;
+
+            set_block(tile, block);
+            changed_tiles++;
+        }
+    }
+
+    if (changed_tiles != 0)
+        changed(x - 1, y - 1, end_x + 1, end_y + 1);
+
+    return changed_tiles;
+}
+
+size_t ScriptEngine::replace(int x, int y, int end_x, int end_y, int from_block, int to_block)
+{
+    if (from_block == to_block)
+        return 0;
+
+    size_t changed_tiles = 0;
+    for (auto tile_y = y; tile_y < end_y; tile_y++)
+    {
+        for (auto tile_x = x; tile_x < end_x; tile_x++)
+        {
+            // Most of a region usually isn't what we're replacing, so don't decompress anything just to look at it
+            if (!is_block(m_tiles.tile_at(tile_x, tile_y), from_block))
+                continue;
+
+            set_block(m_tiles.at(tile_x, tile_y), to_block);
+            changed_tiles++;
+        }
+    }
+
+    if (changed_tiles != 0)
+        changed(x - 1, y - 1, end_x + 1, end_y + 1);
+
+    return changed_tiles;
+}
+
+void ScriptEngine::copy(int x, int y, int end_x, int end_y, int to_x, int to_y)
+{
+    // Read everything first, so copying onto an overlapping region doesn't read what it has just written
+    Vector<u64> keys;
+    keys.ensure_capacity((end_x - x) * (end_y - y));
+    for (auto tile_y = y; tile_y < end_y; tile_y++)
+    {
+        for (auto tile_x = x; tile_x < end_x; tile_x++)
+            keys.append(ChunkedTileMap::key_for_tile(m_tiles.tile_at(tile_x, tile_y)));
+    }
+
+    size_t i = 0;
+    for (auto tile_y = y; tile_y < end_y; tile_y++)
+    {
+        for (auto tile_x = x; tile_x < end_x; tile_x++, i++)
+        {
+            auto destination_x = to_x + (tile_x - x);
+            auto destination_y = to_y + (tile_y - y);
+            if (m_tiles.contains(destination_x, destination_y))
+                m_tiles.at(destination_x, destination_y) = ChunkedTileMap::tile_for_key(keys[i]);
+        }
+    }
+
+    changed(to_x - 1, to_y - 1, to_x + (end_x - x) + 1, to_y + (end_y - y) + 1);
+}
+
+size_t ScriptEngine::count(int x, int y, int end_x, int end_y, int block) const
+{
+    constexpr auto chunk_size = ChunkedTileMap::chunk_size;
+
+    // A chunk at a time, which never decompresses anything
+    size_t matching_tiles = 0;
+    for (auto chunk_y = y / chunk_size; chunk_y <= (end_y - 1) / chunk_size; chunk_y++)
+    {
+        for (auto chunk_x = x / chunk_size; chunk_x <= (end_x - 1) / chunk_size; chunk_x++)
+        {
+            m_tiles.for_each_tile_in_chunk(chunk_x + (m_tiles.chunks_x() * chunk_y), [&](auto tile_x, auto tile_y,
+                                                                                        auto& tile)
+            {
+                if (tile_x >= x && tile_y >= y && tile_x < end_x && tile_y < end_y && is_block(tile, block))
+                    matching_tiles++;
+            });
+        }
+    }
+
+    return matching_tiles;
+}
+
+int ScriptEngine::lua_print(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto start = engine.m_output.length();
+    auto argument_count = lua_gettop(lua);
+    for (auto i = 1; i <= argument_count; i++)
+    {
+        if (i > 1)
+            engine.m_output.append('\t');
+        engine.m_output.append(luaL_tolstring(lua, i, nullptr));
+        lua_pop(lua, 1);
+    }
+    engine.m_output.append('\n');
+
+    out("{}", engine.m_output.string_view().substring_view(start));
+    return 0;
+}
+
+// world.block(x, y) returns the block's id and frames, or nothing if there isn't one
+int ScriptEngine::lua_block(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+
+    auto tile = engine.m_tiles.tile_at(x, y);
+    if (!tile.block().has_value())
+        return 0;
+
+    lua_pushinteger(lua, static_cast<lua_Integer>(tile.block()->id()));
+    lua_pushinteger(lua, tile.block()->frame_x().value_or(0));
+    lua_pushinteger(lua, tile.block()->frame_y().value_or(0));
+    return 3;
+}
+
+// world.set_block(x, y, block), where the block is an id or a name, and nil is air
+int ScriptEngine::lua_set_block(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+    auto block = check_block(lua, 3);
+    luaL_argcheck(lua, engine.m_tiles.contains(x, y), 1, "outside of the world");
+
+    set_block(engine.m_tiles.at(x, y), block);
+    engine.changed(x - 1, y - 1, x + 2, y + 2);
+    return 0;
+}
+
+// world.wire(x, y, color), where the color is "red", "blue", "green" or "yellow"
+int ScriptEngine::lua_wire(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+    auto color = luaL_checkoption(lua, 3, nullptr, s_wire_colors);
+
+    bool has_wire = false;
+    {
+        auto tile = engine.m_tiles.tile_at(x, y);
+        switch (color)
+        {
+            case 0:
+                has_wire = tile.has_red_wire();
+                break;
+            case 1:
+                has_wire = tile.has_blue_wire();
+                break;
+            case 2:
+                has_wire = tile.has_green_wire();
+                break;
+            case 3:
+                has_wire = tile.has_yellow_wire();
+                break;
+        }
+    }
+
+    lua_pushboolean(lua, has_wire);
+    return 1;
+}
+
+// world.set_wire(x, y, color, has_wire)
+int ScriptEngine::lua_set_wire(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+    auto color = luaL_checkoption(lua, 3, nullptr, s_wire_colors);
+    auto has_wire = lua_toboolean(lua, 4) != 0;
+    luaL_argcheck(lua, engine.m_tiles.contains(x, y), 1, "outside of the world");
+
+    auto& tile = engine.m_tiles.at(x, y);
+    switch (color)
+    {
+        case 0:
+            tile.set_red_wire(has_wire);
+            break;
+        case 1:
+            tile.set_blue_wire(has_wire);
+            break;
+        case 2:
+            tile.set_green_wire(has_wire);
+            break;
+        case 3:
+            tile.set_yellow_wire(has_wire);
+            break;
+    }
+
+    // Wires are framed by the wires around them
+    engine.changed(x - 1, y - 1, x + 2, y + 2);
+    return 0;
+}
+
+// world.actuator(x, y) returns whether the tile has an actuator, and whether it's actuated
+int ScriptEngine::lua_actuator(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+
+    bool has_actuator;
+    bool is_actuated;
+    {
+        auto tile = engine.m_tiles.tile_at(x, y);
+        has_actuator = tile.has_actuator();
+        is_actuated = tile.is_actuated();
+    }
+
+    lua_pushboolean(lua, has_actuator);
+    lua_pushboolean(lua, is_actuated);
+    return 2;
+}
+
+// world.set_actuator(x, y, has_actuator)
+int ScriptEngine::lua_set_actuator(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+    auto has_actuator = lua_toboolean(lua, 3) != 0;
+    luaL_argcheck(lua, engine.m_tiles.contains(x, y), 1, "outside of the world");
+
+    engine.m_tiles.at(x, y).set_has_actuator(has_actuator);
+    engine.changed(x, y, x + 1, y + 1);
+    return 0;
+}
+
+// world.fill(x, y, width, height, block) returns how many tiles changed
+int ScriptEngine::lua_fill(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto block = check_block(lua, 5);
+    int x, y, end_x, end_y;
+    if (!engine.check_region(lua, 1, x, y, end_x, end_y))
+    {
+        lua_pushinteger(lua, 0);
+        return 1;
+    }
+
+    lua_pushinteger(lua, static_cast<lua_Integer>(engine.fill(x, y, end_x, end_y, block)));
+    return 1;
+}
+
+// world.replace(x, y, width, height, from_block, to_block) returns how many tiles changed
+int ScriptEngine::lua_replace(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto from_block = check_block(lua, 5);
+    auto to_block = check_block(lua, 6);
+    int x, y, end_x, end_y;
+    if (!engine.check_region(lua, 1, x, y, end_x, end_y))
+    {
+        lua_pushinteger(lua, 0);
+        return 1;
+    }
+
+    lua_pushinteger(lua, static_cast<lua_Integer>(engine.replace(x, y, end_x, end_y, from_block, to_block)));
+    return 1;
+}
+
+// world.copy(x, y, width, height, to_x, to_y) copies whole tiles (blocks, frames, wires and all)
+int ScriptEngine::lua_copy(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto to_x = luaL_checkinteger(lua, 5);
+    auto to_y = luaL_checkinteger(lua, 6);
+    auto region_x = luaL_checkinteger(lua, 1);
+    auto region_y = luaL_checkinteger(lua, 2);
+    int x, y, end_x, end_y;
+    if (!engine.check_region(lua, 1, x, y, end_x, end_y))
+        return 0;
+
+    // If the source went off the edge, so does the destination
+    engine.copy(x, y, end_x, end_y, static_cast<int>(to_x + (x - region_x)), static_cast<int>(to_y + (y - region_y)));
+    return 0;
+}
+
+// world.count(x, y, width, height, block) returns how many tiles in the region are that block
+int ScriptEngine::lua_count(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto block = check_block(lua, 5);
+    int x, y, end_x, end_y;
+    if (!engine.check_region(lua, 1, x, y, end_x, end_y))
+    {
+        lua_pushinteger(lua, 0);
+        return 1;
+    }
+
+    lua_pushinteger(lua, static_cast<lua_Integer>(engine.count(x, y, end_x, end_y, block)));
+    return 1;
+}
+
+// world.each_tile(x, y, width, height, function(x, y, block) ... end) calls the function for every tile in the
+// region, row by row, with the block's id (or nil for air). Returning false from it stops early.
+int ScriptEngine::lua_each_tile(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    luaL_checktype(lua, 5, LUA_TFUNCTION);
+    int x, y, end_x, end_y;
+    if (!engine.check_region(lua, 1, x, y, end_x, end_y))
+        return 0;
+
+    for (auto tile_y = y; tile_y < end_y; tile_y++)
+    {
+        for (auto tile_x = x; tile_x < end_x; tile_x++)
+        {
+            lua_pushvalue(lua, 5);
+            lua_pushinteger(lua, tile_x);
+            lua_pushinteger(lua, tile_y);
+            {
+                auto tile = engine.m_tiles.tile_at(tile_x, tile_y);
+                if (tile.block().has_value())
+                    lua_pushinteger(lua, static_cast<lua_Integer>(tile.block()->id()));
+                else
+                    lua_pushnil(lua);
+            }
+
+            lua_call(lua, 3, 1);
+            auto stop = lua_isboolean(lua, -1) && !lua_toboolean(lua, -1);
+            lua_pop(lua, 1);
+            if (stop)
+                return 0;
+        }
+    }
+
+    return 0;
+}
+
+// world.place_object(name, x, y, style_x, style_y) places an object from the catalog with its top left corner there
+int ScriptEngine::lua_place_object(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto* name = luaL_checkstring(lua, 1);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 2));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 3));
+    auto style_x = static_cast<int>(luaL_optinteger(lua, 4, 0));
+    auto style_y = static_cast<int>(luaL_optinteger(lua, 5, 0));
+
+    auto* object = Object::find_by_name(name);
+    if (!object)
+        return luaL_error(lua, "unknown object %s", name);
+
+    for (auto object_x = 0; object_x < object->width(); object_x++)
+    {
+        for (auto object_y = 0; object_y < object->height(); object_y++)
+        {
+            if (engine.m_tiles.contains(x + object_x, y + object_y))
+                engine.m_tiles.at(x + object_x, y + object_y) = object->tile_for_style(object_x, object_y, style_x,
+                                                                                     style_y);
+        }
+    }
+
+    engine.changed(x - 2, y - 2, x + object->width() + 2, y + object->height() + 2);
+    return 0;
+}
+
+// world.chests() returns a list of every chest, as {x, y, name}
+int ScriptEngine::lua_chests(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    lua_newtable(lua);
+    lua_Integer i = 1;
+    for (auto& kv : engine.m_world.chests())
+    {
+        auto position = kv.value.position();
+        lua_createtable(lua, 0, 3);
+        lua_pushinteger(lua, position.x());
+        lua_setfield(lua, -2, "x");
+        lua_pushinteger(lua, position.y());
+        lua_setfield(lua, -2, "y");
+        lua_pushstring(lua, kv.value.name().characters());
+        lua_setfield(lua, -2, "name");
+        lua_rawseti(lua, -2, i++);
+    }
+
+    return 1;
+}
+
+// world.chest(x, y) returns {name, items}, where items are {id, stack, prefix} by slot (from 0, like the game), or
+// nothing if there's no chest there
+int ScriptEngine::lua_chest(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+
+    auto* chest = engine.chest_at(x, y);
+    if (!chest)
+        return 0;
+
+    lua_createtable(lua, 0, 2);
+    lua_pushstring(lua, chest->name().characters());
+    lua_setfield(lua, -2, "name");
+
+    lua_newtable(lua);
+    auto slots = ChestIndex::slot_count(*chest);
+    for (auto slot = 0; slot < slots; slot++)
+    {
+        auto item = chest->contents().get(slot);
+        if (!item.has_value())
+            continue;
+
+        lua_createtable(lua, 0, 3);
+        lua_pushinteger(lua, static_cast<lua_Integer>(item->id()));
+        lua_setfield(lua, -2, "id");
+        lua_pushinteger(lua, item->stack());
+        lua_setfield(lua, -2, "stack");
+        lua_pushinteger(lua, static_cast<lua_Integer>(item->prefix()));
+        lua_setfield(lua, -2, "prefix");
+        lua_rawseti(lua, -2, slot);
+    }
+    lua_setfield(lua, -2, "items");
+
+    return 1;
+}
+
+// world.set_chest_name(x, y, name)
+int ScriptEngine::lua_set_chest_name(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+    auto* name = luaL_checkstring(lua, 3);
+
+    auto* chest = engine.chest_at(x, y);
+    if (!chest)
+        return luaL_error(lua, "there's no chest at %d, %d", x, y);
+
+    chest->set_name(name);
+    return 0;
+}
+
+// world.set_chest_item(x, y, slot, item, stack, prefix), where the item is an id or a name, and nil empties the slot
+int ScriptEngine::lua_set_chest_item(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+    auto slot = luaL_checkinteger(lua, 3);
+    auto item_id = check_item(lua, 4);
+    auto stack = luaL_optinteger(lua, 5, 1);
+    auto prefix = luaL_optinteger(lua, 6, 0);
+
+    auto* chest = engine.chest_at(x, y);
+    if (!chest)
+        return luaL_error(lua, "there's no chest at %d, %d", x, y);
+    luaL_argcheck(lua, slot >= 0 && slot < ChestIndex::slot_count(*chest), 3, "not a chest slot");
+    // Stacks are stored in 16 bits, and the chest window looks the prefix up in a table of the ones that exist
+    luaL_argcheck(lua, stack > 0 && stack <= NumericLimits<i16>::max(), 5, "not a stack size");
+    luaL_argcheck(lua, prefix >= 0 && prefix < Terraria::s_total_prefixes, 6, "not a prefix");
+
+    if (item_id < 0)
+    {
+        chest->contents().remove(slot);
+        return 0;
+    }
+
+    Terraria::Item item;
+    item.set_id(static_cast<Terraria::Item::Id>(item_id));
+    item.set_stack(static_cast<i16>(stack));
+    item.set_prefix(static_cast<Terraria::Item::Prefix>(prefix));
+    chest->contents().set(slot, item);
+    return 0;
+}
+
+// world.signs() returns a list of every sign, as {x, y, text}
+int ScriptEngine::lua_signs(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    lua_newtable(lua);
+    lua_Integer i = 1;
+    for (auto& kv : engine.m_world.signs())
+    {
+        auto position = kv.value.position();
+        lua_createtable(lua, 0, 3);
+        lua_pushinteger(lua, position.x());
+        lua_setfield(lua, -2, "x");
+        lua_pushinteger(lua, position.y());
+        lua_setfield(lua, -2, "y");
+        lua_pushstring(lua, kv.value.text().characters());
+        lua_setfield(lua, -2, "text");
+        lua_rawseti(lua, -2, i++);
+    }
+
+    return 1;
+}
+
+// world.set_sign(x, y, text)
+int ScriptEngine::lua_set_sign(lua_State* lua)
+{
+    auto& engine = ScriptEngine::engine(lua);
+    auto x = static_cast<int>(luaL_checkinteger(lua, 1));
+    auto y = static_cast<int>(luaL_checkinteger(lua, 2));
+    auto* text = luaL_checkstring(lua, 3);
+
+    auto* sign = engine.sign_at(x, y);
+    if (!sign)
+        return luaL_error(lua, "there's no sign at %d, %d", x, y);
+
+    sign->set_text(text);
+    return 0;
+}
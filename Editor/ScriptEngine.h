@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/String.h>
+#include <AK/StringBuilder.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/DirtyRegion.h>
+#include <LibTerraria/World.h>
+
+struct lua_State;
+
+// Runs Lua scripts against a world, through the `world` table (see the README for everything in it). Anything that
+// touches lots of tiles (fill, replace, copy, count) is done natively in one call, so a script only pays for the
+// interpreter once per call rather than once per tile.
+// Scripts write straight into the tile map, so in the editor they're run by the world thread. Nothing is framed while a
+// script runs, the regions it changed are framed afterwards with frame_changes() (or by the world thread).
+class ScriptEngine
+{
+public:
+    ScriptEngine(Terraria::World&, ChunkedTileMap&);
+
+    // Returns false if the script couldn't be loaded or raised an error, which ends up in the output
+    bool run_file(const String& path);
+
+    bool run(const StringView& source, const String& name);
+
+    // Everything printed by the scripts we've run, and any errors they raised
+    String output() const
+    { return m_output.to_string(); }
+
+    void for_each_changed_rect(Function<void(const DirtyRegion::Rect&)>) const;
+
+    // Frames everything the scripts changed, for when there's no world thread to do it
+    void frame_changes();
+
+private:
+    static ScriptEngine& engine(lua_State*);
+
+    void register_api(lua_State*);
+
+    void changed(int x, int y, int end_x, int end_y);
+
+    // Clamps a region given as x, y, width, height at the arguments starting here, to the world
+    bool check_region(lua_State*, int first_arg, int& x, int& y, int& end_x, int& end_y);
+
+    Terraria::Chest* chest_at(int x, int y);
+
+    Terraria::Sign* sign_at(int x, int y);
+
+    size_t fill(int x, int y, int end_x, int end_y, int block);
+
+    size_t replace(int x, int y, int end_x, int end_y, int from_block, int to_block);
+
+    void copy(int x, int y, int end_x, int end_y, int to_x, int to_y);
+
+    size_t count(int x, int y, int end_x, int end_y, int block) const;
+
+    static int lua_print(lua_State*);
+
+    static int lua_block(lua_State*);
+
+    static int lua_set_block(lua_State*);
+
+    static int lua_wire(lua_State*);
+
+    static int lua_set_wire(lua_State*);
+
+    static int lua_actuator(lua_State*);
+
+    static int lua_set_actuator(lua_State*);
+
+    static int lua_fill(lua_State*);
+
+    static int lua_replace(lua_State*);
+
+    static int lua_copy(lua_State*);
+
+    static int lua_count(lua_State*);
+
+    static int lua_each_tile(lua_State*);
+
+    static int lua_place_object(lua_State*);
+
+    static int lua_chests(lua_State*);
+
+    static int lua_chest(lua_State*);
+
+    static int lua_set_chest_name(lua_State*);
+
+    static int lua_set_chest_item(lua_State*);
+
+    static int lua_signs(lua_State*);
+
+    static int lua_set_sign(lua_State*);
+
+    Terraria::World& m_world;
+    ChunkedTileMap& m_tiles;
+    DirtyRegion m_changed_region;
+    StringBuilder m_output;
+};
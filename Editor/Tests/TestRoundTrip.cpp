@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/Format.h>
+#include <Editor/BinaryStream.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/FrameTable.h>
+#include <Editor/LiquidLayer.h>
+#include <Editor/WallLayer.h>
+#include <Editor/WorldDiff.h>
+#include <Editor/WorldGenerator.h>
+#include <Editor/WorldLoader.h>
+#include <LibCore/File.h>
+#include <LibTerraria/Model.h>
+#include <unistd.h>
+
+// Neither is a multiple of the chunk size, so the chunks along the right and bottom edges are smaller
+static constexpr u16 world_width = 700;
+static constexpr u16 world_height = 450;
+
+static int s_failures = 0;
+
+static void expect(bool condition, StringView what)
+{
+    if (condition)
+        return;
+
+    warnln("FAIL: {}", what);
+    s_failures++;
+}
+
+static NonnullOwnPtr<ChunkedTileMap> generate(u64 seed)
+{
+    WorldGenerator::Settings settings;
+    settings.width = world_width;
+    settings.height = world_height;
+    settings.seed = seed;
+    return WorldGenerator(move(settings)).generate();
+}
+
+// Reading a tile through at() makes its chunk resident, and has its hash worked out again from the tiles
+static void touch_every_chunk(ChunkedTileMap& tiles)
+{
+    for (size_t chunk_index = 0; chunk_index < tiles.chunk_count(); chunk_index++)
+    {
+        auto x = static_cast<int>(chunk_index % tiles.chunks_x()) * ChunkedTileMap::chunk_size;
+        auto y = static_cast<int>(chunk_index / tiles.chunks_x()) * ChunkedTileMap::chunk_size;
+        tiles.at(x, y);
+    }
+    tiles.update_chunk_hashes();
+}
+
+static void test_compression()
+{
+    auto tiles = generate(1);
+    auto fingerprint = tiles->fingerprint();
+
+    tiles->compress_all();
+    expect(tiles->fingerprint() == fingerprint, "compressing changed the fingerprint");
+
+    touch_every_chunk(*tiles);
+    expect(tiles->fingerprint() == fingerprint, "decompressed tiles aren't the ones that were compressed");
+
+    // Snapshots are how the world thread hands chunks to the UI
+    auto other_tiles = generate(2);
+    expect(other_tiles->fingerprint() != fingerprint, "two seeds made the same world");
+    for (size_t chunk_index = 0; chunk_index < tiles->chunk_count(); chunk_index++)
+        other_tiles->replace_chunk(chunk_index, tiles->snapshot_chunk(chunk_index));
+
+    touch_every_chunk(*other_tiles);
+    expect(other_tiles->fingerprint() == fingerprint, "snapshotted tiles aren't the ones that were snapshotted");
+
+    auto clone = tiles->clone();
+    touch_every_chunk(*clone);
+    expect(clone->fingerprint() == fingerprint, "cloned tiles aren't the ones that were cloned");
+}
+
+// The table has to come up with exactly what LibTerraria would, for every block next to every other block in the world
+static void test_frame_table()
+{
+    auto tiles = generate(1);
+    size_t disagreements = 0;
+    for (auto y = 1; y < world_height - 1; y++)
+    {
+        for (auto x = 1; x < world_width - 1; x++)
+        {
+            auto& tile = tiles->at(x, y);
+            if (!tile.block().has_value())
+                continue;
+
+            auto& top = tiles->at(x, y - 1);
+            auto& bottom = tiles->at(x, y + 1);
+            auto& left = tiles->at(x - 1, y);
+            auto& right = tiles->at(x + 1, y);
+            auto looked_up = FrameTable::block_frame(tile, top, bottom, left, right);
+            auto worked_out = Terraria::Tile::Block::frame_for_block(tile, top, bottom, left, right);
+            if (looked_up.has_value() != worked_out.has_value() ||
+                (looked_up.has_value() && (looked_up->x != worked_out->x || looked_up->y != worked_out->y)))
+            {
+                disagreements++;
+            }
+        }
+    }
+
+    if (disagreements > 0)
+        warnln("The frame table disagrees with LibTerraria about {} blocks", disagreements);
+    expect(disagreements == 0, "the frame table disagrees with LibTerraria");
+}
+
+static void paint_walls(WallLayer& walls, int start_x, int start_y, int end_x, int end_y)
+{
+    for (auto y = start_y; y < end_y; y++)
+    {
+        for (auto x = start_x; x < end_x; x++)
+            walls.set_wall(x, y, static_cast<u16>(1 + ((x / 7) % 4)));
+    }
+    walls.frame_region(start_x - 1, start_y - 1, end_x + 1, end_y + 1);
+}
+
+static void fill_liquid(LiquidLayer& liquids, int start_x, int start_y, int end_x, int end_y, u8 liquid)
+{
+    for (auto y = start_y; y < end_y; y++)
+    {
+        for (auto x = start_x; x < end_x; x++)
+            liquids.set_liquid(x, y, liquid);
+    }
+}
+
+static void test_patch()
+{
+    auto base_tiles = generate(1);
+    WallLayer base_walls(world_width, world_height);
+    LiquidLayer base_liquids(world_width, world_height);
+    paint_walls(base_walls, 20, 300, 200, 440);
+    fill_liquid(base_liquids, 400, 200, 500, 230, LiquidLayer::pack(LiquidLayer::Type::Water, LiquidLayer::max_amount));
+
+    // Some walls and liquid are changed, some are added, and some are taken away
+    auto other_tiles = generate(2);
+    WallLayer other_walls(world_width, world_height);
+    LiquidLayer other_liquids(world_width, world_height);
+    paint_walls(other_walls, 100, 100, 300, 350);
+    fill_liquid(other_liquids, 450, 210, 690, 260, LiquidLayer::pack(LiquidLayer::Type::Lava, 30));
+
+    auto diff_or_error = WorldDiff::compute(*base_tiles, base_walls, base_liquids, *other_tiles, other_walls,
+                                            other_liquids);
+    if (diff_or_error.is_error())
+    {
+        expect(false, diff_or_error.error());
+        return;
+    }
+
+    auto& diff = diff_or_error.value();
+    expect(!diff.tile_changes().is_empty(), "no tiles changed");
+    expect(!diff.wall_changes().is_empty(), "no walls changed");
+    expect(!diff.liquid_changes().is_empty(), "no liquid changed");
+
+    static constexpr auto patch_path = "TestRoundTrip.tdpatch";
+    expect(diff.save_patch(patch_path), "the patch couldn't be saved");
+    auto loaded_or_error = WorldDiff::load_patch(patch_path);
+    unlink(patch_path);
+    if (loaded_or_error.is_error())
+    {
+        expect(false, loaded_or_error.error());
+        return;
+    }
+
+    auto& loaded = loaded_or_error.value();
+    expect(loaded.width() == diff.width() && loaded.height() == diff.height(), "the patch is a different size");
+    expect(loaded.tile_changes().size() == diff.tile_changes().size(), "the patch lost tile changes");
+    expect(loaded.wall_changes().size() == diff.wall_changes().size(), "the patch lost wall changes");
+    expect(loaded.liquid_changes().size() == diff.liquid_changes().size(), "the patch lost liquid changes");
+
+    loaded.apply_to(*base_tiles, base_walls, base_liquids);
+    expect(base_tiles->fingerprint() == other_tiles->fingerprint(), "the patched tiles aren't the other world's");
+
+    auto walls_match = true;
+    auto liquids_match = true;
+    for (auto y = 0; y < world_height; y++)
+    {
+        for (auto x = 0; x < world_width; x++)
+        {
+            walls_match &= base_walls.wall_at(x, y) == other_walls.wall_at(x, y);
+            liquids_match &= base_liquids.liquid_at(x, y) == other_liquids.liquid_at(x, y);
+        }
+    }
+    expect(walls_match, "the patched walls aren't the other world's");
+    expect(liquids_match, "the patched liquid isn't the other world's");
+
+    auto again_or_error = WorldDiff::compute(*base_tiles, base_walls, base_liquids, *other_tiles, other_walls,
+                                             other_liquids);
+    expect(!again_or_error.is_error() && again_or_error.value().tile_changes().is_empty() &&
+           again_or_error.value().wall_changes().is_empty() && again_or_error.value().liquid_changes().is_empty(),
+           "there's still a difference after patching");
+}
+
+// A patch comes from who knows where, so one that would put something impossible in the world shouldn't load
+static void test_corrupt_patch()
+{
+    auto base_tiles = generate(1);
+    auto other_tiles = generate(1);
+    WallLayer walls(world_width, world_height);
+    LiquidLayer liquids(world_width, world_height);
+    other_tiles->at(10, 10).block() = Terraria::Tile::Block(
+            static_cast<Terraria::Tile::Block::Id>(Terraria::s_total_tiles + 5));
+    other_tiles->update_chunk_hashes();
+
+    auto diff_or_error = WorldDiff::compute(*base_tiles, walls, liquids, *other_tiles, walls, liquids);
+    if (diff_or_error.is_error())
+    {
+        expect(false, diff_or_error.error());
+        return;
+    }
+
+    static constexpr auto patch_path = "TestCorruptPatch.tdpatch";
+    expect(diff_or_error.value().save_patch(patch_path), "the patch couldn't be saved");
+    expect(WorldDiff::load_patch(patch_path).is_error(), "a patch with a block that doesn't exist loaded");
+
+    // Cut the patch off halfway through its body
+    auto file_or_error = Core::File::open(patch_path, Core::OpenMode::ReadOnly);
+    if (!file_or_error.is_error())
+    {
+        auto contents = file_or_error.value()->read_all();
+        auto truncated_or_error = Core::File::open(patch_path, Core::OpenMode::WriteOnly | Core::OpenMode::Truncate);
+        if (!truncated_or_error.is_error())
+            truncated_or_error.value()->write(contents.data(), static_cast<int>(contents.size() / 2));
+    }
+    expect(WorldDiff::load_patch(patch_path).is_error(), "a truncated patch loaded");
+
+    unlink(patch_path);
+}
+
+// The start of a 1.4 world's header, up to and including the section offsets
+static BinaryWriter world_header(const Vector<i32>& section_offsets)
+{
+    BinaryWriter writer;
+    writer.write<i32>(238);
+    for (auto c : StringView("relogic"))
+        writer.write<u8>(c);
+    writer.write<u8>(2);
+    writer.write<u32>(0);
+    writer.write<u64>(0);
+    writer.write<i16>(static_cast<i16>(section_offsets.size()));
+    for (auto offset : section_offsets)
+        writer.write<i32>(offset);
+    return writer;
+}
+
+static void expect_load_error(ReadonlyBytes bytes, StringView error, StringView what)
+{
+    auto world_or_error = WorldLoader::load_from_bytes(bytes);
+    expect(world_or_error.is_error() && world_or_error.error().contains(error), what);
+}
+
+// Only what's checked before and after LibTerraria gets to the file. Loading a world, saving it and loading it
+// again would need LibTerraria to be able to write worlds, which it can't.
+static void test_world_loader()
+{
+    expect_load_error({}, "empty", "an empty file was loaded");
+
+    auto truncated = world_header({100, 200});
+    expect_load_error(truncated.bytes().span().trim(9), "ends in the middle of its header",
+                      "a truncated header was loaded");
+
+    BinaryWriter bad_magic;
+    bad_magic.write<i32>(238);
+    for (auto c : StringView("relogix"))
+        bad_magic.write<u8>(c);
+    for (auto i = 0; i < 64; i++)
+        bad_magic.write<u8>(0);
+    expect_load_error(bad_magic.bytes(), "isn't a world", "a file with the wrong magic was loaded");
+
+    auto out_of_order = world_header({200, 100});
+    // No frame important tiles, then enough bytes for both offsets to be inside the file
+    out_of_order.write<i16>(0);
+    while (out_of_order.bytes().size() < 300)
+        out_of_order.write<u8>(0);
+    expect_load_error(out_of_order.bytes(), "impossible place", "sections out of order were loaded");
+
+    auto past_the_end = world_header({100, 1000});
+    past_the_end.write<i16>(0);
+    while (past_the_end.bytes().size() < 300)
+        past_the_end.write<u8>(0);
+    expect_load_error(past_the_end.bytes(), "impossible place", "a section past the end of the file was loaded");
+
+    expect(!WorldLoader::check_world(world_width, world_height, {{10, 10}}, {{20, 20}}).has_value(),
+           "a world with everything inside it was rejected");
+    expect(WorldLoader::check_world(world_width, world_height, {{world_width, 10}}, {}).has_value(),
+           "a chest outside the world was accepted");
+    expect(WorldLoader::check_world(world_width, world_height, {}, {{-1, 10}}).has_value(),
+           "a sign outside the world was accepted");
+    expect(WorldLoader::check_world(0, world_height, {}, {}).has_value(), "an empty world was accepted");
+}
+
+int main()
+{
+    test_compression();
+    test_frame_table();
+    test_patch();
+    test_corrupt_patch();
+    test_world_loader();
+
+    if (s_failures != 0)
+    {
+        warnln("{} checks failed", s_failures);
+        return 1;
+    }
+
+    outln("Everything round tripped");
+    return 0;
+}
@@ -0,0 +1,535 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/QuickSort.h>
+#include <Editor/FrameTable.h>
+#include <Editor/TileMapRenderer.h>
+#include <GL/glew.h>
+
+// The same versions main.cpp asks for
+#if defined(__APPLE__)
+static constexpr const char* glsl_version = "#version 150\n";
+#else
+static constexpr const char* glsl_version = "#version 130\n";
+#endif
+
+// Atlas pages are never bigger than this, even if the GPU could do bigger, so the last (mostly empty) page doesn't
+// waste too much
+static constexpr int max_atlas_page_size = 4096;
+
+// Everything needed to draw a tile, packed into the four 16 bit channels of a texel
+static constexpr u16 red_wire_flag = 1 << 0;
+static constexpr u16 blue_wire_flag = 1 << 1;
+static constexpr u16 green_wire_flag = 1 << 2;
+static constexpr u16 yellow_wire_flag = 1 << 3;
+static constexpr u16 actuator_flag = 1 << 4;
+static constexpr u16 actuated_flag = 1 << 5;
+
+// One triangle big enough to cover the whole screen, made up from nothing but the vertex id
+static constexpr const char* vertex_shader_source = R"(
+void main()
+{
+    vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    gl_Position = vec4((position * 2.0) - 1.0, 0.0, 1.0);
+}
+)";
+
+static constexpr const char* fragment_shader_source = R"(
+// x = block id + 1 (0 if there is none), y = frame x, z = frame y, w = flags
+uniform usampler2D u_tiles;
+// Row 0 is where each sheet is in the atlas (layer, x, y, whether it's in there at all), row 1 is its width and height
+uniform usampler2D u_sheets;
+uniform sampler2DArray u_atlas;
+
+uniform vec2 u_camera;
+uniform float u_zoom;
+uniform vec2 u_framebuffer_scale;
+uniform float u_framebuffer_height;
+uniform ivec2 u_world_size;
+uniform int u_first_extra_sheet;
+// Indexed by which neighbours have the same wire (1 = top, 2 = bottom, 4 = left, 8 = right)
+uniform ivec2 u_wire_frames[16];
+
+out vec4 out_color;
+
+uvec4 tile_at(ivec2 position)
+{
+    if (any(lessThan(position, ivec2(0))) || any(greaterThanEqual(position, u_world_size)))
+        return uvec4(0u);
+
+    ivec2 size = textureSize(u_tiles, 0);
+    return texelFetch(u_tiles, ivec2(position.x % size.x, position.y % size.y), 0);
+}
+
+uvec4 sheet_size(int sheet)
+{
+    return texelFetch(u_sheets, ivec2(sheet, 1), 0);
+}
+
+vec4 sheet_texel(int sheet, ivec2 position)
+{
+    uvec4 placement = texelFetch(u_sheets, ivec2(sheet, 0), 0);
+    uvec4 size = sheet_size(sheet);
+    if (placement.w == 0u || any(lessThan(position, ivec2(0))) || position.x >= int(size.x) ||
+        position.y >= int(size.y))
+    {
+        return vec4(0.0);
+    }
+
+    return texelFetch(u_atlas, ivec3(int(placement.y) + position.x, int(placement.z) + position.y, int(placement.x)),
+                      0);
+}
+
+vec4 over(vec4 below, vec4 above)
+{
+    float alpha = above.a + (below.a * (1.0 - above.a));
+    if (alpha == 0.0)
+        return vec4(0.0);
+
+    return vec4(((above.rgb * above.a) + (below.rgb * below.a * (1.0 - above.a))) / alpha, alpha);
+}
+
+void main()
+{
+    vec2 screen = vec2(gl_FragCoord.x, u_framebuffer_height - gl_FragCoord.y) / u_framebuffer_scale;
+    vec2 world = u_camera + (screen / u_zoom);
+    ivec2 tile_position = ivec2(floor(world));
+    vec2 within_tile = world - floor(world);
+    ivec2 pixel = ivec2(within_tile * 16.0);
+
+    uvec4 tile = tile_at(tile_position);
+    vec4 color = vec4(0.0);
+
+    if (tile.x != 0u)
+    {
+        vec4 block = sheet_texel(int(tile.x) - 1, ivec2(tile.yz) + pixel);
+        if ((tile.w & 32u) != 0u)
+            block.a *= 95.0 / 255.0;
+        color = over(color, block);
+    }
+
+    for (int wire = 0; wire < 4; wire++)
+    {
+        uint flag = 1u << uint(wire);
+        if ((tile.w & flag) == 0u)
+            continue;
+
+        int neighbours = ((tile_at(tile_position + ivec2(0, -1)).w & flag) != 0u ? 1 : 0) |
+                         ((tile_at(tile_position + ivec2(0, 1)).w & flag) != 0u ? 2 : 0) |
+                         ((tile_at(tile_position + ivec2(-1, 0)).w & flag) != 0u ? 4 : 0) |
+                         ((tile_at(tile_position + ivec2(1, 0)).w & flag) != 0u ? 8 : 0);
+        vec4 wire_color = sheet_texel(u_first_extra_sheet + wire, u_wire_frames[neighbours] + pixel);
+        wire_color.a *= 127.0 / 255.0;
+        color = over(color, wire_color);
+    }
+
+    // The actuator sheet is just the one sprite, so it's stretched over the whole tile
+    if ((tile.w & 16u) != 0u)
+    {
+        int actuator_sheet = u_first_extra_sheet + 4;
+        vec4 actuator = sheet_texel(actuator_sheet, ivec2(within_tile * vec2(sheet_size(actuator_sheet).xy)));
+        actuator.a *= 127.0 / 255.0;
+        color = over(color, actuator);
+    }
+
+    if (color.a == 0.0)
+        discard;
+
+    out_color = color;
+}
+)";
+
+TileMapRenderer::TileMapRenderer(size_t tile_sheet_count)
+        : m_tile_sheet_count(tile_sheet_count)
+{
+    m_sheets.resize(tile_sheet_count + static_cast<size_t>(ExtraSheet::Count));
+}
+
+TileMapRenderer::~TileMapRenderer()
+{
+    if (m_program)
+        glDeleteProgram(m_program);
+
+    if (m_vertex_array)
+        glDeleteVertexArrays(1, &m_vertex_array);
+
+    u32 textures[] = {m_atlas_texture, m_sheet_texture, m_tiles_texture};
+    for (auto texture : textures)
+    {
+        if (texture)
+            glDeleteTextures(1, &texture);
+    }
+}
+
+void TileMapRenderer::set_tile_sheet(u16 id, u32 gl_texture_id, int width, int height)
+{
+    VERIFY(id < m_tile_sheet_count);
+    m_sheets[id] = {gl_texture_id, width, height};
+}
+
+void TileMapRenderer::set_extra_sheet(ExtraSheet sheet, u32 gl_texture_id, int width, int height)
+{
+    m_sheets[m_tile_sheet_count + static_cast<size_t>(sheet)] = {gl_texture_id, width, height};
+}
+
+bool TileMapRenderer::initialize()
+{
+    VERIFY(!is_initialized());
+
+    if (!pack_sheets())
+        return false;
+
+    glGenVertexArrays(1, &m_vertex_array);
+    return compile_program();
+}
+
+bool TileMapRenderer::pack_sheets()
+{
+    int max_texture_size;
+    int max_layers;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    auto page_size = min(max_texture_size, max_atlas_page_size);
+
+    // Shelf packing, tallest sheets first: sheets go left to right along a shelf as tall as the first one on it,
+    // and a new shelf (or page) is started when one doesn't fit
+    Vector<size_t> order;
+    for (size_t i = 0; i < m_sheets.size(); i++)
+    {
+        auto& sheet = m_sheets[i];
+        if (!sheet.gl_texture_id)
+            continue;
+
+        if (sheet.width > page_size || sheet.height > page_size)
+        {
+            warnln("Texture sheet {} is {}x{}, which doesn't fit in the atlas, so it won't be drawn", i, sheet.width,
+                   sheet.height);
+            continue;
+        }
+
+        order.append(i);
+    }
+
+    quick_sort(order, [&](auto a, auto b)
+    {
+        return m_sheets[a].height > m_sheets[b].height;
+    });
+
+    int layer = 0;
+    int shelf_x = 0;
+    int shelf_y = 0;
+    int shelf_height = 0;
+    for (auto i : order)
+    {
+        auto& sheet = m_sheets[i];
+        if (shelf_x + sheet.width > page_size)
+        {
+            shelf_x = 0;
+            shelf_y += shelf_height;
+            shelf_height = 0;
+        }
+
+        if (shelf_y + sheet.height > page_size)
+        {
+            layer++;
+            shelf_x = 0;
+            shelf_y = 0;
+            shelf_height = 0;
+        }
+
+        sheet.layer = layer;
+        sheet.x = shelf_x;
+        sheet.y = shelf_y;
+        sheet.is_packed = true;
+        shelf_x += sheet.width;
+        shelf_height = max(shelf_height, sheet.height);
+    }
+
+    auto layer_count = layer + 1;
+    if (layer_count > max_layers)
+    {
+        warnln("The texture sheets need {} atlas pages, but the GPU only allows {}", layer_count, max_layers);
+        return false;
+    }
+
+    glGenTextures(1, &m_atlas_texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlas_texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, page_size, page_size, layer_count, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // The sheets are already on the GPU, so read them back from there rather than loading every PNG again
+    Vector<u8> pixels;
+    for (auto i : order)
+    {
+        auto& sheet = m_sheets[i];
+        pixels.resize(sheet.width * sheet.height * 4);
+        glBindTexture(GL_TEXTURE_2D, sheet.gl_texture_id);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, sheet.x, sheet.y, sheet.layer, sheet.width, sheet.height, 1, GL_RGBA,
+                        GL_UNSIGNED_BYTE, pixels.data());
+    }
+
+    Vector<u16> sheet_texels;
+    sheet_texels.resize(m_sheets.size() * 4 * 2);
+    for (size_t i = 0; i < m_sheets.size(); i++)
+    {
+        auto& sheet = m_sheets[i];
+        auto* placement = &sheet_texels[i * 4];
+        auto* size = &sheet_texels[(m_sheets.size() + i) * 4];
+        placement[0] = sheet.layer;
+        placement[1] = sheet.x;
+        placement[2] = sheet.y;
+        placement[3] = sheet.is_packed;
+        size[0] = sheet.width;
+        size[1] = sheet.height;
+    }
+
+    glGenTextures(1, &m_sheet_texture);
+    glBindTexture(GL_TEXTURE_2D, m_sheet_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16UI, m_sheets.size(), 2, 0, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT,
+                 sheet_texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    outln("Packed {} texture sheets into {} atlas pages of {}x{}", order.size(), layer_count, page_size, page_size);
+    return true;
+}
+
+static u32 compile_shader(GLenum type, const char* source)
+{
+    const char* sources[] = {glsl_version, source};
+    auto shader = glCreateShader(type);
+    glShaderSource(shader, 2, sources, nullptr);
+    glCompileShader(shader);
+
+    int status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status)
+    {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        warnln("Failed to compile the tile map shader: {}", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+bool TileMapRenderer::compile_program()
+{
+    auto vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_shader_source);
+    auto fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
+    if (!vertex_shader || !fragment_shader)
+    {
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+        return false;
+    }
+
+    auto program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glBindFragDataLocation(program, 0, "out_color");
+    glLinkProgram(program);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    int status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status)
+    {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        warnln("Failed to link the tile map shader: {}", log);
+        glDeleteProgram(program);
+        return false;
+    }
+
+    // These never change, so they can be set once and forgotten about
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "u_tiles"), 0);
+    glUniform1i(glGetUniformLocation(program, "u_sheets"), 1);
+    glUniform1i(glGetUniformLocation(program, "u_atlas"), 2);
+    glUniform1i(glGetUniformLocation(program, "u_first_extra_sheet"), static_cast<int>(m_tile_sheet_count));
+
+    int wire_frames[16 * 2];
+    for (auto neighbours = 0; neighbours < 16; neighbours++)
+    {
+        auto frame = FrameTable::wire_frame(neighbours);
+        wire_frames[neighbours * 2] = frame.x;
+        wire_frames[(neighbours * 2) + 1] = frame.y;
+    }
+    glUniform2iv(glGetUniformLocation(program, "u_wire_frames"), 16, wire_frames);
+    glUseProgram(0);
+
+    m_program = program;
+    return true;
+}
+
+void TileMapRenderer::invalidate_chunk(size_t chunk_index)
+{
+    if (!m_tiles || m_slot_chunks.is_empty())
+        return;
+
+    auto chunk_x = static_cast<int>(chunk_index % m_tiles->chunks_x());
+    auto chunk_y = static_cast<int>(chunk_index / m_tiles->chunks_x());
+    auto& slot = m_slot_chunks[(chunk_x % m_slots_x) + (m_slots_x * (chunk_y % m_slots_y))];
+    if (slot.has_value() && *slot == chunk_index)
+        slot = {};
+}
+
+void TileMapRenderer::forget_tiles()
+{
+    m_tiles = nullptr;
+    for (auto& slot : m_slot_chunks)
+        slot = {};
+}
+
+void TileMapRenderer::ensure_chunk_capacity(int chunks_x, int chunks_y, RenderThread& render_thread)
+{
+    if (chunks_x <= m_slots_x && chunks_y <= m_slots_y)
+        return;
+
+    // Grown a bit more than needed, so zooming out slowly doesn't make a new texture every frame
+    m_slots_x = max(m_slots_x, chunks_x + 2);
+    m_slots_y = max(m_slots_y, chunks_y + 2);
+    m_slot_chunks.clear();
+    m_slot_chunks.resize(m_slots_x * m_slots_y);
+
+    render_thread.run_before_frame([this, texture_width = m_slots_x * ChunkedTileMap::chunk_size,
+                                    texture_height = m_slots_y * ChunkedTileMap::chunk_size]
+    {
+        if (!m_tiles_texture)
+            glGenTextures(1, &m_tiles_texture);
+
+        glBindTexture(GL_TEXTURE_2D, m_tiles_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16UI, texture_width, texture_height, 0, GL_RGBA_INTEGER,
+                     GL_UNSIGNED_SHORT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    });
+}
+
+void TileMapRenderer::upload_chunk(const ChunkedTileMap& tiles, size_t chunk_index, RenderThread& render_thread)
+{
+    constexpr int chunk_size = ChunkedTileMap::chunk_size;
+    auto chunk_x = static_cast<int>(chunk_index % tiles.chunks_x());
+    auto chunk_y = static_cast<int>(chunk_index / tiles.chunks_x());
+    auto start_x = chunk_x * chunk_size;
+    auto start_y = chunk_y * chunk_size;
+
+    // Chunks on the right and bottom edges can be smaller, the rest of their slot is just left empty
+    Vector<u16> texels;
+    texels.resize(chunk_size * chunk_size * 4);
+    tiles.for_each_tile_in_chunk(chunk_index, [&](auto x, auto y, auto& tile)
+    {
+        auto* texel = &texels[((x - start_x) + (chunk_size * (y - start_y))) * 4];
+        if (tile.block().has_value())
+        {
+            auto& block = *tile.block();
+            texel[0] = static_cast<u16>(block.id()) + 1;
+            texel[1] = block.frame_x().has_value() ? static_cast<u16>(*block.frame_x()) : 0;
+            texel[2] = block.frame_y().has_value() ? static_cast<u16>(*block.frame_y()) : 0;
+        }
+
+        u16 flags = 0;
+        if (tile.has_red_wire())
+            flags |= red_wire_flag;
+        if (tile.has_blue_wire())
+            flags |= blue_wire_flag;
+        if (tile.has_green_wire())
+            flags |= green_wire_flag;
+        if (tile.has_yellow_wire())
+            flags |= yellow_wire_flag;
+        if (tile.has_actuator())
+            flags |= actuator_flag;
+        if (tile.is_actuated())
+            flags |= actuated_flag;
+        texel[3] = flags;
+    });
+
+    // The texels are worked out here, from the UI's own copy of the tiles, and the render thread only has to copy
+    // them over
+    render_thread.run_before_frame([this, slot_x = (chunk_x % m_slots_x) * chunk_size,
+                                    slot_y = (chunk_y % m_slots_y) * chunk_size, texels = move(texels)]
+    {
+        glBindTexture(GL_TEXTURE_2D, m_tiles_texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, slot_x, slot_y, chunk_size, chunk_size, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT,
+                        texels.data());
+    });
+    m_slot_chunks[(chunk_x % m_slots_x) + (m_slots_x * (chunk_y % m_slots_y))] = chunk_index;
+}
+
+void TileMapRenderer::draw(const ChunkedTileMap& tiles, const Camera& camera, ImDrawList* draw_list,
+                           RenderThread& render_thread)
+{
+    VERIFY(is_initialized());
+
+    if (m_tiles != &tiles)
+    {
+        forget_tiles();
+        m_tiles = &tiles;
+    }
+
+    // Wires look at their neighbours, so we need one more chunk all the way around what we can see
+    auto visible_chunks = camera.visible_chunks(ChunkedTileMap::chunk_size);
+    auto start_x = max(visible_chunks.start_x - 1, 0);
+    auto start_y = max(visible_chunks.start_y - 1, 0);
+    auto end_x = min(visible_chunks.end_x + 1, static_cast<int>(tiles.chunks_x()));
+    auto end_y = min(visible_chunks.end_y + 1, static_cast<int>(tiles.chunks_y()));
+    if (end_x <= start_x || end_y <= start_y)
+        return;
+
+    ensure_chunk_capacity(end_x - start_x, end_y - start_y, render_thread);
+
+    for (auto chunk_y = start_y; chunk_y < end_y; chunk_y++)
+    {
+        for (auto chunk_x = start_x; chunk_x < end_x; chunk_x++)
+        {
+            auto chunk_index = static_cast<size_t>(chunk_x + (tiles.chunks_x() * chunk_y));
+            auto& slot = m_slot_chunks[(chunk_x % m_slots_x) + (m_slots_x * (chunk_y % m_slots_y))];
+            if (!slot.has_value() || *slot != chunk_index)
+                upload_chunk(tiles, chunk_index, render_thread);
+        }
+    }
+
+    auto& io = ImGui::GetIO();
+    RenderState state{camera.x(), camera.y(), camera.zoom(), tiles.width(), tiles.height(), io.DisplayFramebufferScale,
+                      io.DisplaySize.y * io.DisplayFramebufferScale.y};
+
+    render_thread.add_draw_callback(draw_list, [this, state]
+    {
+        render(state);
+    });
+    draw_list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void TileMapRenderer::render(const RenderState& state)
+{
+    glUseProgram(m_program);
+    glUniform2f(glGetUniformLocation(m_program, "u_camera"), state.camera_x, state.camera_y);
+    glUniform1f(glGetUniformLocation(m_program, "u_zoom"), state.zoom);
+    glUniform2f(glGetUniformLocation(m_program, "u_framebuffer_scale"), state.framebuffer_scale.x,
+                state.framebuffer_scale.y);
+    glUniform1f(glGetUniformLocation(m_program, "u_framebuffer_height"), state.framebuffer_height);
+    glUniform2i(glGetUniformLocation(m_program, "u_world_size"), state.world_width, state.world_height);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_tiles_texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_sheet_texture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlas_texture);
+
+    glBindVertexArray(m_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // ImGui sets up the rest of its state again after this, but it expects to be on the first texture unit
+    glActiveTexture(GL_TEXTURE0);
+}
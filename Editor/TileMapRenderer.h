@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <Editor/Camera.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/RenderThread.h>
+#include <imgui/imgui.h>
+
+// Draws the tile map entirely on the GPU. The tiles around what we can see are uploaded into an integer texture
+// (block, frames and wires for every tile), every texture sheet is packed into one big texture array, and a fragment
+// shader works out what every pixel should be. The whole map is then a single triangle, however many tiles we can
+// see. Only needs OpenGL 3.0, so it works with Mesa's software renderer too.
+// The GL objects are only ever touched on the render thread. Everything that decides what to upload happens on the UI
+// thread, which hands the uploads (and the draw itself) over to the render thread as part of the frame.
+class TileMapRenderer
+{
+public:
+    // Sheets after the tile sheets, in this order
+    enum class ExtraSheet
+    {
+        RedWire,
+        BlueWire,
+        GreenWire,
+        YellowWire,
+        Actuator,
+        Count,
+    };
+
+    explicit TileMapRenderer(size_t tile_sheet_count);
+
+    ~TileMapRenderer();
+
+    // Give every sheet before calling initialize(), sheets without a texture just don't get drawn
+    void set_tile_sheet(u16 id, u32 gl_texture_id, int width, int height);
+
+    void set_extra_sheet(ExtraSheet, u32 gl_texture_id, int width, int height);
+
+    // Packs the sheets together and compiles the shaders, which needs a current GL context, so it has to be run on
+    // the render thread. Returns false (after complaining about why) if we can't draw like this.
+    bool initialize();
+
+    bool is_initialized() const
+    { return m_program != 0; }
+
+    void invalidate_chunk(size_t chunk_index);
+
+    // Forgets every chunk that was uploaded, for when the map it was drawing is switched away from or closed. A new
+    // map can be put where a closed one used to be, so the pointer alone can't tell that apart from the same map.
+    void forget_tiles();
+
+    // Queues up uploads of whatever chunks around the camera have changed, and adds the map to the draw list. The
+    // tile map must not be written to while this is running.
+    void draw(const ChunkedTileMap&, const Camera&, ImDrawList*, RenderThread&);
+
+private:
+    struct Sheet
+    {
+        u32 gl_texture_id{};
+        int width{};
+        int height{};
+
+        // Where it ended up in the atlas
+        int layer{};
+        int x{};
+        int y{};
+        bool is_packed{};
+    };
+
+    // What render() needs, as of the frame it's drawing. The UI thread is already on the next frame by then.
+    struct RenderState
+    {
+        float camera_x;
+        float camera_y;
+        float zoom;
+        int world_width;
+        int world_height;
+        ImVec2 framebuffer_scale;
+        float framebuffer_height;
+    };
+
+    void render(const RenderState&);
+
+    bool compile_program();
+
+    bool pack_sheets();
+
+    void ensure_chunk_capacity(int chunks_x, int chunks_y, RenderThread&);
+
+    void upload_chunk(const ChunkedTileMap&, size_t chunk_index, RenderThread&);
+
+    Vector<Sheet> m_sheets;
+    size_t m_tile_sheet_count;
+
+    u32 m_program{};
+    u32 m_vertex_array{};
+    u32 m_atlas_texture{};
+    u32 m_sheet_texture{};
+    u32 m_tiles_texture{};
+
+    // The tiles texture holds this many chunks across and down. A chunk always goes in the same slot (its position
+    // modulo these), so the shader can find a tile without knowing which chunks are where.
+    int m_slots_x{};
+    int m_slots_y{};
+    // Which chunk is in each slot, if any
+    Vector<Optional<size_t>> m_slot_chunks;
+    // The map the slots were filled from, if forget_tiles() hasn't been called since
+    const ChunkedTileMap* m_tiles{};
+};
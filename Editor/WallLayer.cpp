@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/WallLayer.h>
+
+static constexpr u16 chunk_size = ChunkedTileMap::chunk_size;
+
+// Walls are framed just like a block that only merges with itself, except a wall merges with any other wall. Indexed
+// by which neighbours have walls (1 = top, 2 = bottom, 4 = left, 8 = right), this is the first frame to use and how
+// far along the next of the three variants are, in 18 pixel block frames (wall frames are just twice as big).
+struct WallFrames
+{
+    u8 x;
+    u8 y;
+    u8 variant_x;
+    u8 variant_y;
+};
+
+static constexpr WallFrames s_wall_frames[16] = {
+        {9, 3, 1, 0},  // Nothing around it
+        {6, 3, 1, 0},  // Top
+        {6, 0, 1, 0},  // Bottom
+        {5, 0, 0, 1},  // Top and bottom
+        {12, 0, 0, 1}, // Left
+        {1, 4, 2, 0},  // Top and left
+        {1, 3, 2, 0},  // Bottom and left
+        {4, 0, 0, 1},  // Everything but the right
+        {9, 0, 0, 1},  // Right
+        {0, 4, 2, 0},  // Top and right
+        {0, 3, 2, 0},  // Bottom and right
+        {0, 0, 0, 1},  // Everything but the left
+        {6, 4, 1, 0},  // Left and right
+        {1, 2, 1, 0},  // Everything but the bottom
+        {1, 0, 1, 0},  // Everything but the top
+        {1, 1, 1, 0},  // Everything
+};
+
+WallLayer::WallLayer(u16 width, u16 height)
+        : m_width(width),
+          m_height(height),
+          m_chunks_x((width + chunk_size - 1) / chunk_size)
+{
+    m_chunks.resize(m_chunks_x * ((height + chunk_size - 1) / chunk_size));
+}
+
+NonnullOwnPtr<WallLayer> WallLayer::create_from_world(Terraria::World& world)
+{
+    auto walls = make<WallLayer>(world.m_max_tiles_x, world.m_max_tiles_y);
+
+    for (auto y = 0; y < walls->m_height; y++)
+    {
+        for (auto x = 0; x < walls->m_width; x++)
+        {
+            auto wall_id = world.tile_map()->at(x, y).wall_id();
+            if (wall_id.has_value() && static_cast<u16>(*wall_id) != 0)
+                walls->set_wall(x, y, static_cast<u16>(*wall_id));
+        }
+    }
+
+    walls->frame_region(0, 0, walls->m_width, walls->m_height);
+    return walls;
+}
+
+u16 WallLayer::chunk_width(size_t chunk_index) const
+{
+    auto start_x = (chunk_index % m_chunks_x) * chunk_size;
+    return static_cast<u16>(min<size_t>(chunk_size, m_width - start_x));
+}
+
+u16 WallLayer::chunk_height(size_t chunk_index) const
+{
+    auto start_y = (chunk_index / m_chunks_x) * chunk_size;
+    return static_cast<u16>(min<size_t>(chunk_size, m_height - start_y));
+}
+
+WallLayer::Wall* WallLayer::wall_pointer(int x, int y)
+{
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+        return nullptr;
+
+    auto chunk_index = (x / chunk_size) + (m_chunks_x * (y / chunk_size));
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.walls.is_empty())
+        return nullptr;
+
+    return &chunk.walls[(x % chunk_size) + (chunk_width(chunk_index) * (y % chunk_size))];
+}
+
+u16 WallLayer::wall_at(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+        return 0;
+
+    auto chunk_index = (x / chunk_size) + (m_chunks_x * (y / chunk_size));
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.walls.is_empty())
+        return 0;
+
+    return chunk.walls[(x % chunk_size) + (chunk_width(chunk_index) * (y % chunk_size))].id;
+}
+
+void WallLayer::set_wall(int x, int y, u16 id)
+{
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+        return;
+
+    auto chunk_index = (x / chunk_size) + (m_chunks_x * (y / chunk_size));
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.walls.is_empty())
+    {
+        // Taking a wall away from a chunk without any changes nothing
+        if (id == 0)
+            return;
+
+        chunk.walls.resize(chunk_width(chunk_index) * chunk_height(chunk_index));
+    }
+
+    wall_pointer(x, y)->id = id;
+}
+
+void WallLayer::frame_region(int start_x, int start_y, int end_x, int end_y)
+{
+    start_x = max(start_x, 0);
+    start_y = max(start_y, 0);
+    end_x = min<int>(end_x, m_width);
+    end_y = min<int>(end_y, m_height);
+
+    for (auto y = start_y; y < end_y; y++)
+    {
+        for (auto x = start_x; x < end_x; x++)
+        {
+            auto* wall = wall_pointer(x, y);
+            if (!wall || wall->id == 0)
+                continue;
+
+            auto neighbours = (wall_at(x, y - 1) != 0 ? 1 : 0) | (wall_at(x, y + 1) != 0 ? 2 : 0) |
+                              (wall_at(x - 1, y) != 0 ? 4 : 0) | (wall_at(x + 1, y) != 0 ? 8 : 0);
+            auto& frames = s_wall_frames[neighbours];
+
+            // The game picks a variant at random, we pick one from the position so it's the same every time
+            auto variant = static_cast<u8>(((x * 17) ^ (y * 31)) % 3);
+            wall->frame_x = frames.x + (frames.variant_x * variant);
+            wall->frame_y = frames.y + (frames.variant_y * variant);
+        }
+    }
+}
+
+void WallLayer::for_each_wall_in_chunk(size_t chunk_index, Function<void(int x, int y, const Wall&)> callback) const
+{
+    auto& chunk = m_chunks[chunk_index];
+    if (chunk.walls.is_empty())
+        return;
+
+    auto start_x = static_cast<int>(chunk_index % m_chunks_x) * chunk_size;
+    auto start_y = static_cast<int>(chunk_index / m_chunks_x) * chunk_size;
+    auto width = chunk_width(chunk_index);
+    for (size_t i = 0; i < chunk.walls.size(); i++)
+    {
+        auto& wall = chunk.walls[i];
+        if (wall.id != 0)
+            callback(start_x + static_cast<int>(i % width), start_y + static_cast<int>(i / width), wall);
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Vector.h>
+#include <Editor/ChunkedTileMap.h>
+#include <LibTerraria/World.h>
+
+// The walls of a world, kept apart from the tiles since nothing about a wall depends on the block in front of it
+// (or the other way around). Walls are split into the same chunks as the tile map, and a chunk without any walls
+// (like everything in the sky) takes up no memory at all.
+class WallLayer
+{
+public:
+    // How many walls there are, counting "no wall" as 0
+    static constexpr u16 wall_count = 316;
+
+    struct Wall
+    {
+        u16 id{};
+        // Which frame of the wall sheet to draw, in frames rather than pixels. A wall is 32x32 pixels drawn 8 pixels
+        // past every edge of its tile, and frames are 36 pixels apart.
+        u8 frame_x{};
+        u8 frame_y{};
+    };
+
+    WallLayer(u16 width, u16 height);
+
+    static NonnullOwnPtr<WallLayer> create_from_world(Terraria::World&);
+
+    u16 width() const
+    { return m_width; }
+
+    u16 height() const
+    { return m_height; }
+
+    // 0 if there's no wall, or the position is out of bounds
+    u16 wall_at(int x, int y) const;
+
+    // Doesn't frame anything, call frame_region() around it afterwards
+    void set_wall(int x, int y, u16 id);
+
+    // Works out the frames of every wall in the region, based on whether there are walls around them
+    void frame_region(int start_x, int start_y, int end_x, int end_y);
+
+    bool chunk_has_walls(size_t chunk_index) const
+    { return !m_chunks[chunk_index].walls.is_empty(); }
+
+    // A copy of the chunk's walls (empty if it has never had any), which replace_chunk() can put in another layer of
+    // the same size
+    Vector<Wall> copy_chunk(size_t chunk_index) const
+    { return m_chunks[chunk_index].walls; }
+
+    void replace_chunk(size_t chunk_index, Vector<Wall> walls)
+    { m_chunks[chunk_index].walls = move(walls); }
+
+    // Calls the callback with every wall in the chunk, skipping tiles without one
+    void for_each_wall_in_chunk(size_t chunk_index, Function<void(int x, int y, const Wall&)>) const;
+
+private:
+    struct Chunk
+    {
+        // Empty if the chunk has never had any walls
+        Vector<Wall> walls;
+    };
+
+    Wall* wall_pointer(int x, int y);
+
+    u16 chunk_width(size_t chunk_index) const;
+
+    u16 chunk_height(size_t chunk_index) const;
+
+    u16 m_width;
+    u16 m_height;
+    u16 m_chunks_x;
+    Vector<Chunk> m_chunks;
+};
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/Atomic.h>
+#include <Editor/WireNetworks.h>
+#include <LibTerraria/Model.h>
+#include <thread>
+
+static constexpr int chunk_size = ChunkedTileMap::chunk_size;
+
+// Splitting up a few chunks is quicker than starting threads for them
+static constexpr size_t min_chunks_for_threads = 64;
+
+static bool has_wire(const Terraria::Tile& tile, size_t color)
+{
+    switch (static_cast<WireColor>(color))
+    {
+        case WireColor::Red:
+            return tile.has_red_wire();
+        case WireColor::Blue:
+            return tile.has_blue_wire();
+        case WireColor::Green:
+            return tile.has_green_wire();
+        case WireColor::Yellow:
+            return tile.has_yellow_wire();
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+WireNetworks::WireNetworks(const ChunkedTileMap& tiles)
+        : m_tiles(tiles)
+{
+    m_chunks.resize(tiles.chunk_count());
+    update();
+}
+
+void WireNetworks::invalidate_chunk(size_t chunk_index)
+{
+    m_chunks[chunk_index].is_dirty = true;
+}
+
+bool WireNetworks::update()
+{
+    Vector<size_t> dirty_chunks;
+    for (size_t i = 0; i < m_chunks.size(); i++)
+    {
+        if (m_chunks[i].is_dirty)
+            dirty_chunks.append(i);
+    }
+
+    if (dirty_chunks.is_empty())
+        return false;
+
+    // Chunks are split up on their own, so they can all be done at once
+    Atomic<size_t> next_dirty_chunk{0};
+    auto split_chunks = [&]
+    {
+        for (;;)
+        {
+            auto i = next_dirty_chunk.fetch_add(1);
+            if (i >= dirty_chunks.size())
+                return;
+
+            split_chunk(dirty_chunks[i]);
+        }
+    };
+
+    Vector<std::thread> threads;
+    if (dirty_chunks.size() >= min_chunks_for_threads)
+    {
+        for (auto i = 1u; i < max(std::thread::hardware_concurrency(), 1u); i++)
+            threads.append(std::thread(split_chunks));
+    }
+
+    split_chunks();
+    for (auto& thread : threads)
+        thread.join();
+
+    join_chunks();
+    return true;
+}
+
+void WireNetworks::split_chunk(size_t chunk_index)
+{
+    auto& chunk = m_chunks[chunk_index];
+    auto start_x = static_cast<int>(chunk_index % m_tiles.chunks_x()) * chunk_size;
+    auto start_y = static_cast<int>(chunk_index / m_tiles.chunks_x()) * chunk_size;
+    auto width = min<int>(chunk_size, m_tiles.width() - start_x);
+    auto height = min<int>(chunk_size, m_tiles.height() - start_y);
+
+    // Which wires each tile has, one bit per color
+    u8 wires[chunk_size * chunk_size]{};
+    u8 colors_in_chunk = 0;
+    m_tiles.for_each_tile_in_chunk(chunk_index, [&](auto x, auto y, auto& tile)
+    {
+        u8 tile_wires = 0;
+        for (size_t color = 0; color < wire_color_count; color++)
+        {
+            if (has_wire(tile, color))
+                tile_wires |= 1 << color;
+        }
+
+        wires[(x - start_x) + (width * (y - start_y))] = tile_wires;
+        colors_in_chunk |= tile_wires;
+    });
+
+    Vector<u16> stack;
+    for (size_t color = 0; color < wire_color_count; color++)
+    {
+        auto& pieces = chunk.colors[color];
+        pieces.pieces.clear();
+        pieces.piece_count = 0;
+
+        u8 bit = 1 << color;
+        if ((colors_in_chunk & bit) == 0)
+            continue;
+
+        pieces.pieces.resize(width * height);
+        for (auto start = 0; start < width * height; start++)
+        {
+            if ((wires[start] & bit) == 0 || pieces.pieces[start] != 0)
+                continue;
+
+            // Flood fill from here, everything we can reach without leaving the chunk is one piece
+            auto piece = ++pieces.piece_count;
+            pieces.pieces[start] = piece;
+            stack.append(start);
+            while (!stack.is_empty())
+            {
+                auto index = stack.take_last();
+                auto x = index % width;
+                auto y = index / width;
+
+                auto visit = [&](int neighbour)
+                {
+                    if ((wires[neighbour] & bit) != 0 && pieces.pieces[neighbour] == 0)
+                    {
+                        pieces.pieces[neighbour] = piece;
+                        stack.append(neighbour);
+                    }
+                };
+
+                if (x > 0)
+                    visit(index - 1);
+                if (x < width - 1)
+                    visit(index + 1);
+                if (y > 0)
+                    visit(index - width);
+                if (y < height - 1)
+                    visit(index + width);
+            }
+        }
+    }
+
+    chunk.is_dirty = false;
+}
+
+void WireNetworks::join_chunks()
+{
+    auto chunk_width = [&](size_t chunk_index)
+    {
+        return min<int>(chunk_size, m_tiles.width() - static_cast<int>(chunk_index % m_tiles.chunks_x()) * chunk_size);
+    };
+
+    auto chunk_height = [&](size_t chunk_index)
+    {
+        return min<int>(chunk_size, m_tiles.height() - static_cast<int>(chunk_index / m_tiles.chunks_x()) * chunk_size);
+    };
+
+    for (size_t color = 0; color < wire_color_count; color++)
+    {
+        u32 piece_count = 0;
+        for (auto& chunk : m_chunks)
+        {
+            chunk.colors[color].first_piece = piece_count;
+            piece_count += chunk.colors[color].piece_count;
+        }
+
+        Vector<u32> parents;
+        parents.resize(piece_count);
+        for (u32 i = 0; i < piece_count; i++)
+            parents[i] = i;
+
+        auto find = [&](u32 piece)
+        {
+            // Path halving, which keeps the trees flat without needing to recurse
+            while (parents[piece] != piece)
+            {
+                parents[piece] = parents[parents[piece]];
+                piece = parents[piece];
+            }
+            return piece;
+        };
+
+        auto unite = [&](const ChunkPieces& a, u16 a_piece, const ChunkPieces& b, u16 b_piece)
+        {
+            if (a_piece == 0 || b_piece == 0)
+                return;
+
+            auto a_root = find(a.first_piece + a_piece - 1);
+            auto b_root = find(b.first_piece + b_piece - 1);
+            if (a_root != b_root)
+                parents[max(a_root, b_root)] = min(a_root, b_root);
+        };
+
+        // Only the right and bottom edges of every chunk have to be looked at, the left and top edges are the right
+        // and bottom edges of the chunks before them
+        for (size_t i = 0; i < m_chunks.size(); i++)
+        {
+            auto& pieces = m_chunks[i].colors[color];
+            if (pieces.pieces.is_empty())
+                continue;
+
+            auto width = chunk_width(i);
+            auto height = chunk_height(i);
+            auto chunk_x = static_cast<int>(i % m_tiles.chunks_x());
+            auto chunk_y = static_cast<int>(i / m_tiles.chunks_x());
+
+            if (chunk_x < m_tiles.chunks_x() - 1)
+            {
+                auto& right = m_chunks[i + 1].colors[color];
+                if (!right.pieces.is_empty())
+                {
+                    auto right_width = chunk_width(i + 1);
+                    for (auto y = 0; y < height; y++)
+                        unite(pieces, pieces.pieces[(width - 1) + (width * y)], right, right.pieces[right_width * y]);
+                }
+            }
+
+            if (chunk_y < m_tiles.chunks_y() - 1)
+            {
+                auto& bottom = m_chunks[i + m_tiles.chunks_x()].colors[color];
+                if (!bottom.pieces.is_empty())
+                {
+                    for (auto x = 0; x < width; x++)
+                        unite(pieces, pieces.pieces[x + (width * (height - 1))], bottom, bottom.pieces[x]);
+                }
+            }
+        }
+
+        // Number the networks from 0, in the order their first piece appears
+        auto& networks = m_networks[color];
+        networks.resize(piece_count);
+        Vector<u32> network_for_root;
+        network_for_root.resize(piece_count);
+        u32 network_count = 0;
+        for (u32 i = 0; i < piece_count; i++)
+        {
+            auto root = find(i);
+            if (root == i)
+                network_for_root[i] = network_count++;
+
+            networks[i] = network_for_root[root];
+        }
+
+        m_network_counts[color] = network_count;
+    }
+}
+
+Optional<WireNetworks::NetworkId> WireNetworks::network_at(int x, int y, WireColor color) const
+{
+    if (!m_tiles.contains(x, y))
+        return {};
+
+    auto chunk_index = m_tiles.chunk_index_for_position(x, y);
+    auto& pieces = m_chunks[chunk_index].colors[static_cast<size_t>(color)];
+    if (pieces.pieces.is_empty())
+        return {};
+
+    auto width = min<int>(chunk_size, m_tiles.width() - (x / chunk_size) * chunk_size);
+    auto piece = pieces.pieces[(x % chunk_size) + (width * (y % chunk_size))];
+    if (piece == 0)
+        return {};
+
+    return m_networks[static_cast<size_t>(color)][pieces.first_piece + piece - 1];
+}
+
+void WireNetworks::for_each_tile_in_network(size_t chunk_index, WireColor color, NetworkId network,
+                                            Function<void(int x, int y)> callback) const
+{
+    auto& pieces = m_chunks[chunk_index].colors[static_cast<size_t>(color)];
+    if (pieces.pieces.is_empty())
+        return;
+
+    // Most chunks a network doesn't go through, which we can tell from just its pieces
+    auto& networks = m_networks[static_cast<size_t>(color)];
+    auto has_network = false;
+    for (u32 piece = 0; piece < pieces.piece_count && !has_network; piece++)
+        has_network = networks[pieces.first_piece + piece] == network;
+
+    if (!has_network)
+        return;
+
+    auto start_x = static_cast<int>(chunk_index % m_tiles.chunks_x()) * chunk_size;
+    auto start_y = static_cast<int>(chunk_index / m_tiles.chunks_x()) * chunk_size;
+    auto width = min<int>(chunk_size, m_tiles.width() - start_x);
+    for (size_t i = 0; i < pieces.pieces.size(); i++)
+    {
+        auto piece = pieces.pieces[i];
+        if (piece != 0 && networks[pieces.first_piece + piece - 1] == network)
+            callback(start_x + static_cast<int>(i % width), start_y + static_cast<int>(i / width));
+    }
+}
+
+WireNetworks::Summary WireNetworks::summarize(WireColor color, NetworkId network) const
+{
+    Summary summary;
+    for (size_t chunk_index = 0; chunk_index < m_chunks.size(); chunk_index++)
+    {
+        for_each_tile_in_network(chunk_index, color, network, [&](auto x, auto y)
+        {
+            auto tile = m_tiles.tile_at(x, y);
+            summary.tile_count++;
+            if (tile.has_actuator())
+                summary.actuator_count++;
+
+            if (tile.block().has_value())
+            {
+                auto id = static_cast<u16>(tile.block()->id());
+                if (Terraria::s_tiles[id].frame_important)
+                    summary.device_tiles.ensure(id)++;
+            }
+        });
+    }
+
+    return summary;
+}
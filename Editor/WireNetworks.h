@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/HashMap.h>
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <Editor/ChunkedTileMap.h>
+
+enum class WireColor : u8
+{
+    Red,
+    Blue,
+    Green,
+    Yellow,
+};
+
+static constexpr size_t wire_color_count = 4;
+
+// Every connected network of wires in the map, separately for each color. Each chunk's wires are split into the
+// pieces that are connected within the chunk (in parallel, the first time), and then those pieces are joined up
+// across chunk edges with a union-find. When wires change, only the changed chunks are split up again, joining
+// everything back up only has to look at the edges of chunks with wires in them.
+class WireNetworks
+{
+public:
+    // Networks are only numbered until the next update(), to keep track of one across edits remember a tile in it
+    using NetworkId = u32;
+
+    struct Summary
+    {
+        size_t tile_count{};
+        size_t actuator_count{};
+        // How many tiles of each block the network runs through, for blocks that are objects (like levers or doors)
+        HashMap<u16, size_t> device_tiles;
+    };
+
+    // Splits every chunk up right away. The tile map must not be written to while this is running.
+    explicit WireNetworks(const ChunkedTileMap&);
+
+    void invalidate_chunk(size_t chunk_index);
+
+    // Splits up the chunks that changed and joins everything up again, if anything changed at all, returning whether
+    // it did. The tile map must not be written to while this is running.
+    bool update();
+
+    Optional<NetworkId> network_at(int x, int y, WireColor) const;
+
+    size_t network_count(WireColor color) const
+    { return m_network_counts[static_cast<size_t>(color)]; }
+
+    // Calls the callback with every tile of the network in this chunk
+    void for_each_tile_in_network(size_t chunk_index, WireColor, NetworkId, Function<void(int x, int y)>) const;
+
+    // Reads every tile of the network. The tile map must not be written to while this is running.
+    Summary summarize(WireColor, NetworkId) const;
+
+private:
+    struct ChunkPieces
+    {
+        // Which piece each tile of the chunk is part of, starting at 1, 0 if it doesn't have this wire. Empty if the
+        // chunk doesn't have this wire at all.
+        Vector<u16> pieces;
+        u16 piece_count{};
+        // Where this chunk's pieces start in m_networks
+        u32 first_piece{};
+    };
+
+    struct Chunk
+    {
+        ChunkPieces colors[wire_color_count];
+        bool is_dirty{true};
+    };
+
+    void split_chunk(size_t chunk_index);
+
+    void join_chunks();
+
+    const ChunkedTileMap& m_tiles;
+    Vector<Chunk> m_chunks;
+
+    // For every piece of every chunk (see ChunkPieces::first_piece), which network it's part of
+    Vector<NetworkId> m_networks[wire_color_count];
+    size_t m_network_counts[wire_color_count]{};
+};
@@ -0,0 +1,735 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/QuickSort.h>
+#include <Editor/BinaryStream.h>
+#include <Editor/ChestIndex.h>
+#include <Editor/DirtyRegion.h>
+#include <Editor/WorldDiff.h>
+#include <LibCore/File.h>
+#include <LibTerraria/Model.h>
+#include <type_traits>
+#include <zlib.h>
+
+// A patch is the magic, the version, the size of the uncompressed body, and then the body deflated.
+// The body is the world size, then every tile, chest and sign change, then (since version 2) every wall and liquid
+// change. Everything is little endian.
+static constexpr char patch_magic[8] = {'T', 'A', 'D', 'P', 'A', 'T', 'C', 'H'};
+static constexpr u32 patch_version = 2;
+// Deflate can't shrink anything to less than about 1/1032 of its size, so a body bigger than that is a lie. Nothing
+// bigger than this cap is believed either, which still fits every tile of a 16800x4800 world changing.
+static constexpr u64 max_deflate_ratio = 1032;
+static constexpr u32 max_body_size = 1024 * 1024 * 1024;
+
+static u32 key_for_position(int x, int y)
+{
+    return (static_cast<u32>(y) << 16) | static_cast<u16>(x);
+}
+
+WorldDiff::WorldDiff(u16 width, u16 height)
+        : m_width(width),
+          m_height(height)
+{
+}
+
+Result<WorldDiff, String> WorldDiff::compute(const ChunkedTileMap& base_tiles, const WallLayer& base_walls,
+                                             const LiquidLayer& base_liquids, const ChunkedTileMap& other_tiles,
+                                             const WallLayer& other_walls, const LiquidLayer& other_liquids)
+{
+    if (base_tiles.width() != other_tiles.width() || base_tiles.height() != other_tiles.height())
+    {
+        return String::formatted("The worlds aren't the same size ({}x{} and {}x{})", base_tiles.width(),
+                                 base_tiles.height(), other_tiles.width(), other_tiles.height());
+    }
+
+    WorldDiff diff(base_tiles.width(), base_tiles.height());
+
+    // Most chunks of two versions of a world are the same, which the hashes tell us without comparing any tiles.
+    // If the fingerprints match, none of them are different at all.
+    Vector<u64> base_keys;
+    Vector<u64> other_keys;
+    auto tiles_differ = base_tiles.fingerprint() != other_tiles.fingerprint();
+    for (size_t chunk_index = 0; tiles_differ && chunk_index < base_tiles.chunk_count(); chunk_index++)
+    {
+        if (base_tiles.chunk_hash(chunk_index) == other_tiles.chunk_hash(chunk_index))
+            continue;
+
+        auto start_x = static_cast<int>(chunk_index % base_tiles.chunks_x()) * ChunkedTileMap::chunk_size;
+        auto start_y = static_cast<int>(chunk_index / base_tiles.chunks_x()) * ChunkedTileMap::chunk_size;
+        auto width = min<int>(ChunkedTileMap::chunk_size, base_tiles.width() - start_x);
+        auto height = min<int>(ChunkedTileMap::chunk_size, base_tiles.height() - start_y);
+
+        auto collect_keys = [&](const ChunkedTileMap& tiles, Vector<u64>& keys)
+        {
+            keys.resize(width * height);
+            tiles.for_each_tile_in_chunk(chunk_index, [&](auto x, auto y, auto& tile)
+            {
+                keys[(x - start_x) + (width * (y - start_y))] = ChunkedTileMap::key_for_tile(tile);
+            });
+        };
+
+        collect_keys(base_tiles, base_keys);
+        collect_keys(other_tiles, other_keys);
+
+        for (auto i = 0; i < width * height; i++)
+        {
+            if (base_keys[i] != other_keys[i])
+            {
+                diff.m_tile_changes.append({static_cast<u16>(start_x + (i % width)),
+                                            static_cast<u16>(start_y + (i / width)), other_keys[i]});
+            }
+        }
+    }
+
+    diff.index_tile_changes();
+
+    // Walls and liquids don't have hashes, but the chunks neither world has any in (which is most of them) are skipped
+    Vector<u16> base_wall_ids;
+    Vector<u16> other_wall_ids;
+    Vector<u8> base_liquid_bytes;
+    Vector<u8> other_liquid_bytes;
+    for (size_t chunk_index = 0; chunk_index < base_tiles.chunk_count(); chunk_index++)
+    {
+        auto has_walls = base_walls.chunk_has_walls(chunk_index) || other_walls.chunk_has_walls(chunk_index);
+        auto has_liquid = base_liquids.chunk_has_liquid(chunk_index) || other_liquids.chunk_has_liquid(chunk_index);
+        if (!has_walls && !has_liquid)
+            continue;
+
+        auto start_x = static_cast<int>(chunk_index % base_tiles.chunks_x()) * ChunkedTileMap::chunk_size;
+        auto start_y = static_cast<int>(chunk_index / base_tiles.chunks_x()) * ChunkedTileMap::chunk_size;
+        auto width = min<int>(ChunkedTileMap::chunk_size, base_tiles.width() - start_x);
+        auto height = min<int>(ChunkedTileMap::chunk_size, base_tiles.height() - start_y);
+        auto index_of = [&](int x, int y)
+        {
+            return (x - start_x) + (width * (y - start_y));
+        };
+
+        if (has_walls)
+        {
+            auto collect_ids = [&](const WallLayer& walls, Vector<u16>& ids)
+            {
+                ids.clear();
+                ids.resize(width * height);
+                walls.for_each_wall_in_chunk(chunk_index, [&](auto x, auto y, auto& wall)
+                {
+                    ids[index_of(x, y)] = wall.id;
+                });
+            };
+
+            collect_ids(base_walls, base_wall_ids);
+            collect_ids(other_walls, other_wall_ids);
+
+            for (auto i = 0; i < width * height; i++)
+            {
+                if (base_wall_ids[i] != other_wall_ids[i])
+                {
+                    diff.m_wall_changes.append({static_cast<u16>(start_x + (i % width)),
+                                                static_cast<u16>(start_y + (i / width)), other_wall_ids[i]});
+                }
+            }
+        }
+
+        if (has_liquid)
+        {
+            auto collect_bytes = [&](const LiquidLayer& liquids, Vector<u8>& bytes)
+            {
+                bytes.clear();
+                bytes.resize(width * height);
+                liquids.for_each_liquid_in_chunk(chunk_index, [&](auto x, auto y, auto liquid)
+                {
+                    bytes[index_of(x, y)] = liquid;
+                });
+            };
+
+            collect_bytes(base_liquids, base_liquid_bytes);
+            collect_bytes(other_liquids, other_liquid_bytes);
+
+            for (auto i = 0; i < width * height; i++)
+            {
+                if (base_liquid_bytes[i] != other_liquid_bytes[i])
+                {
+                    diff.m_liquid_changes.append({static_cast<u16>(start_x + (i % width)),
+                                                  static_cast<u16>(start_y + (i / width)), other_liquid_bytes[i]});
+                }
+            }
+        }
+    }
+
+    return diff;
+}
+
+Result<WorldDiff, String> WorldDiff::compute(Terraria::World& base, const ChunkedTileMap& base_tiles,
+                                             const WallLayer& base_walls, const LiquidLayer& base_liquids,
+                                             Terraria::World& other, const ChunkedTileMap& other_tiles,
+                                             const WallLayer& other_walls, const LiquidLayer& other_liquids)
+{
+    auto diff_or_error = compute(base_tiles, base_walls, base_liquids, other_tiles, other_walls, other_liquids);
+    if (diff_or_error.is_error())
+        return diff_or_error.error();
+
+    auto diff = diff_or_error.release_value();
+
+    auto read_chest_items = [](Terraria::Chest& chest)
+    {
+        Vector<ChestItem> items;
+        auto slots = ChestIndex::slot_count(chest);
+        for (auto slot = 0; slot < slots; slot++)
+        {
+            auto item = chest.contents().get(slot);
+            if (item.has_value())
+            {
+                items.append({static_cast<u8>(slot), static_cast<u16>(item->id()), item->stack(),
+                              static_cast<u8>(item->prefix())});
+            }
+        }
+        return items;
+    };
+
+    auto is_same_items = [](const Vector<ChestItem>& a, const Vector<ChestItem>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            if (a[i].slot != b[i].slot || a[i].id != b[i].id || a[i].stack != b[i].stack ||
+                a[i].prefix != b[i].prefix)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    HashMap<u32, Terraria::Chest*> base_chests;
+    for (auto& kv : base.chests())
+        base_chests.set(key_for_position(kv.value.position().x(), kv.value.position().y()), &kv.value);
+
+    for (auto& kv : other.chests())
+    {
+        auto& chest = kv.value;
+        auto position_key = key_for_position(chest.position().x(), chest.position().y());
+        auto items = read_chest_items(chest);
+
+        auto base_chest = base_chests.get(position_key);
+        if (base_chest.has_value())
+        {
+            base_chests.remove(position_key);
+            if ((*base_chest)->name() == chest.name() && is_same_items(read_chest_items(**base_chest), items))
+                continue;
+        }
+
+        diff.m_chest_changes.append({static_cast<u16>(chest.position().x()), static_cast<u16>(chest.position().y()),
+                                     false, chest.name(), move(items)});
+    }
+
+    // Anything left over isn't in the other world
+    for (auto& kv : base_chests)
+    {
+        auto& chest = *kv.value;
+        diff.m_chest_changes.append({static_cast<u16>(chest.position().x()), static_cast<u16>(chest.position().y()),
+                                     true, {}, {}});
+    }
+
+    HashMap<u32, Terraria::Sign*> base_signs;
+    for (auto& kv : base.signs())
+        base_signs.set(key_for_position(kv.value.position().x(), kv.value.position().y()), &kv.value);
+
+    for (auto& kv : other.signs())
+    {
+        auto& sign = kv.value;
+        auto position_key = key_for_position(sign.position().x(), sign.position().y());
+
+        auto base_sign = base_signs.get(position_key);
+        if (base_sign.has_value())
+        {
+            base_signs.remove(position_key);
+            if ((*base_sign)->text() == sign.text())
+                continue;
+        }
+
+        diff.m_sign_changes.append({static_cast<u16>(sign.position().x()), static_cast<u16>(sign.position().y()),
+                                    false, sign.text()});
+    }
+
+    for (auto& kv : base_signs)
+    {
+        auto& sign = *kv.value;
+        diff.m_sign_changes.append({static_cast<u16>(sign.position().x()), static_cast<u16>(sign.position().y()),
+                                    true, {}});
+    }
+
+    // The chests and signs came out of hash maps, so put them in an order that doesn't depend on that
+    quick_sort(diff.m_chest_changes, [](auto& a, auto& b)
+    {
+        return key_for_position(a.x, a.y) < key_for_position(b.x, b.y);
+    });
+    quick_sort(diff.m_sign_changes, [](auto& a, auto& b)
+    {
+        return key_for_position(a.x, a.y) < key_for_position(b.x, b.y);
+    });
+
+    return diff;
+}
+
+void WorldDiff::index_tile_changes()
+{
+    m_tile_changes_by_chunk.clear();
+
+    auto chunks_x = (m_width + ChunkedTileMap::chunk_size - 1) / ChunkedTileMap::chunk_size;
+    for (size_t i = 0; i < m_tile_changes.size(); i++)
+    {
+        auto& change = m_tile_changes[i];
+        auto chunk_index = static_cast<size_t>((change.x / ChunkedTileMap::chunk_size) +
+                                               (chunks_x * (change.y / ChunkedTileMap::chunk_size)));
+        auto it = m_tile_changes_by_chunk.find(chunk_index);
+        if (it == m_tile_changes_by_chunk.end())
+            m_tile_changes_by_chunk.set(chunk_index, {i, 1});
+        else
+            it->value.change_count++;
+    }
+}
+
+Span<const WorldDiff::TileChange> WorldDiff::tile_changes_in_chunk(size_t chunk_index) const
+{
+    auto changes = m_tile_changes_by_chunk.get(chunk_index);
+    if (!changes.has_value())
+        return {};
+
+    return m_tile_changes.span().slice(changes->first_change, changes->change_count);
+}
+
+bool WorldDiff::save_patch(const String& path) const
+{
+    BinaryWriter body;
+    body.write<u16>(m_width);
+    body.write<u16>(m_height);
+
+    body.write<u32>(m_tile_changes.size());
+    for (auto& change : m_tile_changes)
+    {
+        body.write<u16>(change.x);
+        body.write<u16>(change.y);
+        body.write<u64>(change.tile_key);
+    }
+
+    body.write<u32>(m_chest_changes.size());
+    for (auto& change : m_chest_changes)
+    {
+        body.write<u16>(change.x);
+        body.write<u16>(change.y);
+        body.write<u8>(change.removed);
+        body.write_string(change.name);
+        body.write<u8>(change.items.size());
+        for (auto& item : change.items)
+        {
+            body.write<u8>(item.slot);
+            body.write<u16>(item.id);
+            body.write<i16>(item.stack);
+            body.write<u8>(item.prefix);
+        }
+    }
+
+    body.write<u32>(m_sign_changes.size());
+    for (auto& change : m_sign_changes)
+    {
+        body.write<u16>(change.x);
+        body.write<u16>(change.y);
+        body.write<u8>(change.removed);
+        body.write_string(change.text);
+    }
+
+    body.write<u32>(m_wall_changes.size());
+    for (auto& change : m_wall_changes)
+    {
+        body.write<u16>(change.x);
+        body.write<u16>(change.y);
+        body.write<u16>(change.wall_id);
+    }
+
+    body.write<u32>(m_liquid_changes.size());
+    for (auto& change : m_liquid_changes)
+    {
+        body.write<u16>(change.x);
+        body.write<u16>(change.y);
+        body.write<u8>(change.liquid);
+    }
+
+    if (body.bytes().size() > max_body_size)
+    {
+        warnln("The patch is too big to save, at {} bytes", body.bytes().size());
+        return false;
+    }
+
+    // Changed tiles tend to come in runs of the same few tiles, so this shrinks patches a lot
+    auto compressed_size = compressBound(body.bytes().size());
+    Vector<u8> compressed;
+    compressed.resize(compressed_size);
+    if (compress2(compressed.data(), &compressed_size, body.bytes().data(), body.bytes().size(),
+                  Z_BEST_COMPRESSION) != Z_OK)
+    {
+        warnln("Failed to compress patch");
+        return false;
+    }
+
+    BinaryWriter header;
+    for (auto c : patch_magic)
+        header.write<u8>(c);
+    header.write<u32>(patch_version);
+    header.write<u32>(body.bytes().size());
+
+    auto file_or_error = Core::File::open(path, Core::OpenMode::WriteOnly);
+    if (file_or_error.is_error())
+    {
+        warnln("Failed to open {} for writing: {}", path, file_or_error.error());
+        return false;
+    }
+
+    auto& file = file_or_error.value();
+    if (!file->write(header.bytes().data(), header.bytes().size()) || !file->write(compressed.data(), compressed_size))
+    {
+        warnln("Failed to write to {}", path);
+        return false;
+    }
+
+    return true;
+}
+
+Result<WorldDiff, String> WorldDiff::load_patch(const String& path)
+{
+    auto file_or_error = Core::File::open(path, Core::OpenMode::ReadOnly);
+    if (file_or_error.is_error())
+        return String::formatted("Failed to open {}: {}", path, file_or_error.error());
+
+    auto contents = file_or_error.value()->read_all();
+    BinaryReader header(contents.bytes());
+
+    for (auto c : patch_magic)
+    {
+        u8 byte;
+        if (!header.read(byte) || byte != static_cast<u8>(c))
+            return String::formatted("{} isn't a patch", path);
+    }
+
+    u32 version;
+    u32 body_size;
+    if (!header.read(version) || !header.read(body_size))
+        return String::formatted("{} is truncated", path);
+
+    // Version 1 patches are the same, just without any walls or liquids
+    if (version < 1 || version > patch_version)
+    {
+        return String::formatted("{} is a version {} patch, we only know up to version {}", path, version,
+                                 patch_version);
+    }
+
+    constexpr size_t header_size = sizeof(patch_magic) + 8;
+    auto compressed_size = contents.size() - header_size;
+    if (body_size > max_body_size || body_size > compressed_size * max_deflate_ratio)
+        return String::formatted("{} is corrupt", path);
+
+    Vector<u8> body;
+    body.resize(body_size);
+    uLongf uncompressed_size = body_size;
+    if (uncompress(body.data(), &uncompressed_size, contents.data() + header_size, compressed_size) != Z_OK ||
+        uncompressed_size != body_size)
+    {
+        return String::formatted("{} is corrupt", path);
+    }
+
+    BinaryReader reader(body.span());
+    auto truncated = [&]
+    {
+        return String::formatted("{} is truncated", path);
+    };
+
+    auto outside_of_world = [&](const char* what, u16 x, u16 y)
+    {
+        return String::formatted("{} changes {} outside of the world, at {}, {}", path, what, x, y);
+    };
+
+    u16 width;
+    u16 height;
+    if (!reader.read(width) || !reader.read(height))
+        return truncated();
+
+    WorldDiff diff(width, height);
+
+    u32 tile_change_count;
+    if (!reader.read(tile_change_count))
+        return truncated();
+
+    for (u32 i = 0; i < tile_change_count; i++)
+    {
+        TileChange change{};
+        if (!reader.read(change.x) || !reader.read(change.y) || !reader.read(change.tile_key))
+            return truncated();
+
+        if (change.x >= width || change.y >= height)
+            return outside_of_world("a tile", change.x, change.y);
+
+        // Block ids index LibTerraria's tables all over the place without being checked again
+        auto tile = ChunkedTileMap::tile_for_key(change.tile_key);
+        if (tile.block().has_value())
+        {
+            auto block_id = static_cast<u16>(tile.block()->id());
+            if (block_id >= Terraria::s_total_tiles)
+                return String::formatted("{} has a block that doesn't exist ({})", path, block_id);
+        }
+
+        diff.m_tile_changes.append(change);
+    }
+
+    u32 chest_change_count;
+    if (!reader.read(chest_change_count))
+        return truncated();
+
+    for (u32 i = 0; i < chest_change_count; i++)
+    {
+        ChestChange change{};
+        u8 removed;
+        u8 item_count;
+        if (!reader.read(change.x) || !reader.read(change.y) || !reader.read(removed) ||
+            !reader.read_string(change.name) || !reader.read(item_count))
+        {
+            return truncated();
+        }
+
+        change.removed = removed != 0;
+        for (u8 j = 0; j < item_count; j++)
+        {
+            ChestItem item{};
+            if (!reader.read(item.slot) || !reader.read(item.id) || !reader.read(item.stack) ||
+                !reader.read(item.prefix))
+            {
+                return truncated();
+            }
+
+            // Same for items and prefixes, which are looked up by name as soon as the chest is shown
+            if (item.id == 0 || item.id >= Terraria::s_total_items)
+                return String::formatted("{} has an item that doesn't exist ({})", path, item.id);
+
+            if (item.prefix >= Terraria::s_total_prefixes)
+                return String::formatted("{} has a prefix that doesn't exist ({})", path, item.prefix);
+
+            if (item.stack <= 0)
+                return String::formatted("{} has a stack of {} items", path, item.stack);
+
+            change.items.append(item);
+        }
+
+        diff.m_chest_changes.append(move(change));
+    }
+
+    u32 sign_change_count;
+    if (!reader.read(sign_change_count))
+        return truncated();
+
+    for (u32 i = 0; i < sign_change_count; i++)
+    {
+        SignChange change{};
+        u8 removed;
+        if (!reader.read(change.x) || !reader.read(change.y) || !reader.read(removed) ||
+            !reader.read_string(change.text))
+        {
+            return truncated();
+        }
+
+        change.removed = removed != 0;
+        diff.m_sign_changes.append(move(change));
+    }
+
+    if (version >= 2)
+    {
+        u32 wall_change_count;
+        if (!reader.read(wall_change_count))
+            return truncated();
+
+        for (u32 i = 0; i < wall_change_count; i++)
+        {
+            WallChange change{};
+            if (!reader.read(change.x) || !reader.read(change.y) || !reader.read(change.wall_id))
+                return truncated();
+
+            if (change.x >= width || change.y >= height)
+                return outside_of_world("a wall", change.x, change.y);
+
+            if (change.wall_id >= WallLayer::wall_count)
+                return String::formatted("{} has a wall that doesn't exist ({})", path, change.wall_id);
+
+            diff.m_wall_changes.append(change);
+        }
+
+        u32 liquid_change_count;
+        if (!reader.read(liquid_change_count))
+            return truncated();
+
+        for (u32 i = 0; i < liquid_change_count; i++)
+        {
+            LiquidChange change{};
+            if (!reader.read(change.x) || !reader.read(change.y) || !reader.read(change.liquid))
+                return truncated();
+
+            if (change.x >= width || change.y >= height)
+                return outside_of_world("liquid", change.x, change.y);
+
+            diff.m_liquid_changes.append(change);
+        }
+    }
+
+    if (!reader.is_at_end())
+        return String::formatted("{} has junk at the end", path);
+
+    // We never write them out of order, but we rely on this order, so don't trust whoever made the patch
+    auto chunks_x = (width + ChunkedTileMap::chunk_size - 1) / ChunkedTileMap::chunk_size;
+    auto sort_key = [&](const TileChange& change)
+    {
+        u64 chunk_index = (change.x / ChunkedTileMap::chunk_size) +
+                          (chunks_x * (change.y / ChunkedTileMap::chunk_size));
+        return (chunk_index << 32) | key_for_position(change.x, change.y);
+    };
+    quick_sort(diff.m_tile_changes, [&](auto& a, auto& b)
+    {
+        return sort_key(a) < sort_key(b);
+    });
+
+    diff.index_tile_changes();
+    return diff;
+}
+
+size_t WorldDiff::apply(Terraria::World& world, WorldThread& world_thread) const
+{
+    VERIFY(world.m_max_tiles_x == m_width && world.m_max_tiles_y == m_height);
+
+    // Tiles are set exactly how they were in the other world, frames and all, so there's nothing to frame here
+    for (auto& change : m_tile_changes)
+        world_thread.submit(EditCommand::set_tile(change.x, change.y, ChunkedTileMap::tile_for_key(change.tile_key),
+                                                  false));
+
+    // Walls and liquids are painted in one command per kind, rather than one per tile. Walls get framed again, since
+    // the patch doesn't have their frames.
+    HashMap<u16, Vector<Gfx::IntPoint>> walls_by_id;
+    for (auto& change : m_wall_changes)
+        walls_by_id.ensure(change.wall_id).append({change.x, change.y});
+    for (auto& kv : walls_by_id)
+        world_thread.submit(EditCommand::paint_walls(move(kv.value), kv.key));
+
+    HashMap<u8, Vector<Gfx::IntPoint>> liquids_by_byte;
+    for (auto& change : m_liquid_changes)
+        liquids_by_byte.ensure(change.liquid).append({change.x, change.y});
+    for (auto& kv : liquids_by_byte)
+        world_thread.submit(EditCommand::paint_liquid(move(kv.value), kv.key));
+
+    size_t unapplied_changes = 0;
+
+    // Chests and signs are found by where they are, so work that out once instead of searching for every change
+    using ChestKey = std::remove_cvref_t<decltype(world.chests().begin()->key)>;
+    HashMap<u32, ChestKey> chests_by_position;
+    for (auto& kv : world.chests())
+        chests_by_position.set(key_for_position(kv.value.position().x(), kv.value.position().y()), kv.key);
+
+    for (auto& change : m_chest_changes)
+    {
+        auto position_key = key_for_position(change.x, change.y);
+        auto chest_key = chests_by_position.get(position_key);
+        if (change.removed)
+        {
+            if (chest_key.has_value())
+            {
+                world.chests().remove(*chest_key);
+                chests_by_position.remove(position_key);
+            }
+            continue;
+        }
+
+        // FIXME: LibTerraria has no way for us to make new chests (or signs) yet
+        if (!chest_key.has_value())
+        {
+            warnln("Can't add the chest at {}, {}", change.x, change.y);
+            unapplied_changes++;
+            continue;
+        }
+
+        auto& chest = world.chests().find(*chest_key)->value;
+        chest.set_name(change.name);
+        auto slots = ChestIndex::slot_count(chest);
+        for (auto slot = 0; slot < slots; slot++)
+            chest.contents().remove(slot);
+
+        for (auto& item : change.items)
+        {
+            // The chest we're changing might not have as many slots as the one in the other world
+            if (item.slot >= slots)
+            {
+                warnln("Can't put an item in slot {} of the chest at {}, {}", item.slot, change.x, change.y);
+                unapplied_changes++;
+                continue;
+            }
+
+            Terraria::Item new_item;
+            new_item.set_id(static_cast<Terraria::Item::Id>(item.id));
+            new_item.set_stack(item.stack);
+            new_item.set_prefix(static_cast<Terraria::Item::Prefix>(item.prefix));
+            chest.contents().set(item.slot, new_item);
+        }
+    }
+
+    using SignKey = std::remove_cvref_t<decltype(world.signs().begin()->key)>;
+    HashMap<u32, SignKey> signs_by_position;
+    for (auto& kv : world.signs())
+        signs_by_position.set(key_for_position(kv.value.position().x(), kv.value.position().y()), kv.key);
+
+    for (auto& change : m_sign_changes)
+    {
+        auto position_key = key_for_position(change.x, change.y);
+        auto sign_key = signs_by_position.get(position_key);
+        if (change.removed)
+        {
+            if (sign_key.has_value())
+            {
+                world.signs().remove(*sign_key);
+                signs_by_position.remove(position_key);
+            }
+            continue;
+        }
+
+        if (!sign_key.has_value())
+        {
+            warnln("Can't add the sign at {}, {}", change.x, change.y);
+            unapplied_changes++;
+            continue;
+        }
+
+        world.signs().find(*sign_key)->value.set_text(change.text);
+    }
+
+    return unapplied_changes;
+}
+
+void WorldDiff::apply_to(ChunkedTileMap& tiles, WallLayer& walls, LiquidLayer& liquids) const
+{
+    VERIFY(tiles.width() == m_width && tiles.height() == m_height);
+
+    for (auto& change : m_tile_changes)
+        tiles.at(change.x, change.y) = ChunkedTileMap::tile_for_key(change.tile_key);
+
+    DirtyRegion wall_framing_region;
+    for (auto& change : m_wall_changes)
+    {
+        walls.set_wall(change.x, change.y, change.wall_id);
+        wall_framing_region.add(change.x - 1, change.y - 1, change.x + 2, change.y + 2);
+    }
+
+    wall_framing_region.for_each_rect([&](auto& rect)
+    {
+        walls.frame_region(rect.x, rect.y, rect.end_x, rect.end_y);
+    });
+
+    for (auto& change : m_liquid_changes)
+        liquids.set_liquid(change.x, change.y, change.liquid);
+
+    tiles.update_chunk_hashes();
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/HashMap.h>
+#include <AK/Result.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/LiquidLayer.h>
+#include <Editor/WallLayer.h>
+#include <Editor/WorldThread.h>
+#include <LibTerraria/World.h>
+
+// Everything that's different between two worlds of the same size: tiles, walls, liquids, chests and signs. A diff
+// only says what the other world has, so applying it to the base world turns that into the other world.
+class WorldDiff
+{
+public:
+    struct TileChange
+    {
+        u16 x;
+        u16 y;
+        // Packed with ChunkedTileMap::key_for_tile()
+        u64 tile_key;
+    };
+
+    // Only the wall itself, since its frame comes from the walls around it
+    struct WallChange
+    {
+        u16 x;
+        u16 y;
+        u16 wall_id;
+    };
+
+    struct LiquidChange
+    {
+        u16 x;
+        u16 y;
+        // Packed with LiquidLayer::pack()
+        u8 liquid;
+    };
+
+    struct ChestItem
+    {
+        u8 slot;
+        u16 id;
+        i16 stack;
+        u8 prefix;
+    };
+
+    struct ChestChange
+    {
+        u16 x;
+        u16 y;
+        // If it wasn't removed, this is everything about the chest in the other world
+        bool removed;
+        String name;
+        Vector<ChestItem> items;
+    };
+
+    struct SignChange
+    {
+        u16 x;
+        u16 y;
+        bool removed;
+        String text;
+    };
+
+    // Changes are always sorted the same way, so the same two worlds always give the same diff (and patch)
+    static Result<WorldDiff, String> compute(Terraria::World& base, const ChunkedTileMap& base_tiles,
+                                             const WallLayer& base_walls, const LiquidLayer& base_liquids,
+                                             Terraria::World& other, const ChunkedTileMap& other_tiles,
+                                             const WallLayer& other_walls, const LiquidLayer& other_liquids);
+
+    // Only the tiles, walls and liquids, for maps without a world around them (like generated ones)
+    static Result<WorldDiff, String> compute(const ChunkedTileMap& base_tiles, const WallLayer& base_walls,
+                                             const LiquidLayer& base_liquids, const ChunkedTileMap& other_tiles,
+                                             const WallLayer& other_walls, const LiquidLayer& other_liquids);
+
+    static Result<WorldDiff, String> load_patch(const String& path);
+
+    // Returns false (after complaining about why) if the patch couldn't be written
+    bool save_patch(const String& path) const;
+
+    // Tile, wall and liquid changes are submitted to the world thread, chests and signs are changed right away. The
+    // world must be the same size as the diff's. Returns how many changes couldn't be applied, which are complained about.
+    size_t apply(Terraria::World&, WorldThread&) const;
+
+    // Sets the tiles, walls and liquids right away, for when there's no world thread, and leaves chests and signs
+    // alone. The maps must be the same size as the diff's.
+    void apply_to(ChunkedTileMap&, WallLayer&, LiquidLayer&) const;
+
+    u16 width() const
+    { return m_width; }
+
+    u16 height() const
+    { return m_height; }
+
+    // Sorted by chunk, then top to bottom, left to right
+    const Vector<TileChange>& tile_changes() const
+    { return m_tile_changes; }
+
+    // Sorted by chunk, then top to bottom, left to right
+    const Vector<WallChange>& wall_changes() const
+    { return m_wall_changes; }
+
+    const Vector<LiquidChange>& liquid_changes() const
+    { return m_liquid_changes; }
+
+    // Sorted top to bottom, left to right
+    const Vector<ChestChange>& chest_changes() const
+    { return m_chest_changes; }
+
+    const Vector<SignChange>& sign_changes() const
+    { return m_sign_changes; }
+
+    // How many chunks have any tile changes in them
+    size_t changed_chunk_count() const
+    { return m_tile_changes_by_chunk.size(); }
+
+    // The tile changes in a chunk, empty if there are none
+    Span<const TileChange> tile_changes_in_chunk(size_t chunk_index) const;
+
+private:
+    WorldDiff(u16 width, u16 height);
+
+    void index_tile_changes();
+
+    u16 m_width;
+    u16 m_height;
+    Vector<TileChange> m_tile_changes;
+    Vector<WallChange> m_wall_changes;
+    Vector<LiquidChange> m_liquid_changes;
+    Vector<ChestChange> m_chest_changes;
+    Vector<SignChange> m_sign_changes;
+
+    struct ChunkChanges
+    {
+        size_t first_change;
+        size_t change_count;
+    };
+
+    // Where each chunk's changes are in m_tile_changes
+    HashMap<size_t, ChunkChanges> m_tile_changes_by_chunk;
+};
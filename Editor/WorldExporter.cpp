@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/FrameTable.h>
+#include <Editor/PNGStreamWriter.h>
+#include <Editor/WorldExporter.h>
+#include <LibGfx/PNGLoader.h>
+#include <string.h>
+
+static constexpr int sheet_tile_size = 16;
+// Walls are drawn half a tile past every edge of their own, and their frames are a bit further apart than that
+static constexpr int wall_size = 32;
+static constexpr int wall_frame_spacing = 36;
+
+static void blend(u8* pixel, Gfx::Color color, u8 alpha)
+{
+    u32 source_alpha = (color.alpha() * alpha) / 255;
+    if (source_alpha == 0)
+        return;
+
+    u32 destination_alpha = (pixel[3] * (255 - source_alpha)) / 255;
+    u32 out_alpha = source_alpha + destination_alpha;
+
+    pixel[0] = ((color.red() * source_alpha) + (pixel[0] * destination_alpha)) / out_alpha;
+    pixel[1] = ((color.green() * source_alpha) + (pixel[1] * destination_alpha)) / out_alpha;
+    pixel[2] = ((color.blue() * source_alpha) + (pixel[2] * destination_alpha)) / out_alpha;
+    pixel[3] = out_alpha;
+}
+
+WorldExporter::WorldExporter(const ChunkedTileMap& tiles, const WallLayer* walls, const LiquidLayer* liquids,
+                             Region region, int tile_size, bool draw_wires)
+        : m_tiles(tiles),
+          m_walls(walls),
+          m_liquids(liquids),
+          m_tile_size(clamp(tile_size, 1, sheet_tile_size)),
+          m_draw_wires(draw_wires)
+{
+    m_region.x = clamp(region.x, 0, tiles.width() - 1);
+    m_region.y = clamp(region.y, 0, tiles.height() - 1);
+    m_region.width = clamp(region.width, 1, tiles.width() - m_region.x);
+    m_region.height = clamp(region.height, 1, tiles.height() - m_region.y);
+}
+
+WorldExporter::~WorldExporter()
+{
+    m_cancel_requested.store(true);
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void WorldExporter::start_export_png(String path, WorldThread& world_thread)
+{
+    VERIFY(!m_thread.joinable());
+    m_thread = std::thread([this, path = move(path), &world_thread]
+    {
+        m_succeeded = export_png(path, &world_thread);
+        m_finished.store(true, AK::MemoryOrder::memory_order_release);
+    });
+}
+
+bool WorldExporter::export_png(const String& path, WorldThread* world_thread)
+{
+    auto width = static_cast<u32>(m_region.width * m_tile_size);
+    auto height = static_cast<u32>(m_region.height * m_tile_size);
+    auto writer = PNGStreamWriter::create(path, width, height);
+    if (!writer)
+        return false;
+
+    m_wire_sheets[0] = Gfx::load_png("Content/images/Wires.png");
+    m_wire_sheets[1] = Gfx::load_png("Content/images/Wires2.png");
+    m_wire_sheets[2] = Gfx::load_png("Content/images/Wires3.png");
+    m_wire_sheets[3] = Gfx::load_png("Content/images/Wires4.png");
+    m_actuator_sheet = Gfx::load_png("Content/images/Actuator.png");
+
+    // Tiles are read a band (one chunk tall) at a time, with an extra tile around the edges so wires can see
+    // their neighbours. Reading whole chunks is a lot cheaper than asking for every tile on its own.
+    auto band_width = m_region.width + 2;
+    Vector<Terraria::Tile> band;
+    Vector<WallLayer::Wall> wall_band;
+    Vector<u8> liquid_band;
+    Vector<u8> strip;
+    strip.resize(static_cast<size_t>(width) * m_tile_size * 4);
+
+    auto region_end_y = m_region.y + m_region.height;
+    for (auto band_start_y = m_region.y; band_start_y < region_end_y;)
+    {
+        auto band_end_y = min(((band_start_y / ChunkedTileMap::chunk_size) + 1) * ChunkedTileMap::chunk_size,
+                              region_end_y);
+        auto band_height = (band_end_y - band_start_y) + 2;
+
+        band.clear();
+        band.resize(band_width * band_height);
+        wall_band.clear();
+        wall_band.resize(band_width * band_height);
+        liquid_band.clear();
+        liquid_band.resize(band_width * band_height);
+
+        {
+            std::shared_lock<std::shared_mutex> locker;
+            if (world_thread)
+                locker = world_thread->lock_tiles();
+
+            auto start_x = m_region.x - 1;
+            auto band_index = [&](int x, int y) -> Optional<size_t>
+            {
+                auto band_x = x - start_x;
+                auto band_y = y - (band_start_y - 1);
+                if (band_x < 0 || band_x >= band_width || band_y < 0 || band_y >= band_height)
+                    return {};
+
+                return static_cast<size_t>(band_x + (band_width * band_y));
+            };
+
+            auto set_band_tile = [&](int x, int y, const Terraria::Tile& tile)
+            {
+                auto index = band_index(x, y);
+                if (index.has_value())
+                    band[*index] = tile;
+            };
+
+            auto first_chunk_x = max(start_x, 0) / ChunkedTileMap::chunk_size;
+            auto last_chunk_x = min(m_region.x + m_region.width, m_tiles.width() - 1) / ChunkedTileMap::chunk_size;
+            auto chunk_y = band_start_y / ChunkedTileMap::chunk_size;
+            for (auto chunk_x = first_chunk_x; chunk_x <= last_chunk_x; chunk_x++)
+            {
+                auto chunk_index = chunk_x + (m_tiles.chunks_x() * chunk_y);
+                m_tiles.for_each_tile_in_chunk(chunk_index, set_band_tile);
+
+                // Liquid only ever covers its own tile, so the rows around the band don't matter
+                if (m_liquids && m_liquids->chunk_has_liquid(chunk_index))
+                {
+                    m_liquids->for_each_liquid_in_chunk(chunk_index, [&](auto x, auto y, auto liquid)
+                    {
+                        auto index = band_index(x, y);
+                        if (index.has_value())
+                            liquid_band[*index] = liquid;
+                    });
+                }
+            }
+
+            // The rows just above and below belong to other chunks, so just read those one at a time
+            for (auto x = start_x; x < start_x + band_width; x++)
+            {
+                set_band_tile(x, band_start_y - 1, m_tiles.tile_at(x, band_start_y - 1));
+                set_band_tile(x, band_end_y, m_tiles.tile_at(x, band_end_y));
+            }
+
+            // Walls reach into the rows above and below them too, so read all the chunks those are in
+            if (m_walls)
+            {
+                auto first_wall_chunk_y = max(band_start_y - 1, 0) / ChunkedTileMap::chunk_size;
+                auto last_wall_chunk_y = min(band_end_y, m_tiles.height() - 1) / ChunkedTileMap::chunk_size;
+                for (auto wall_chunk_y = first_wall_chunk_y; wall_chunk_y <= last_wall_chunk_y; wall_chunk_y++)
+                {
+                    for (auto chunk_x = first_chunk_x; chunk_x <= last_chunk_x; chunk_x++)
+                    {
+                        auto chunk_index = chunk_x + (m_tiles.chunks_x() * wall_chunk_y);
+                        if (!m_walls->chunk_has_walls(chunk_index))
+                            continue;
+
+                        m_walls->for_each_wall_in_chunk(chunk_index, [&](auto x, auto y, auto& wall)
+                        {
+                            auto index = band_index(x, y);
+                            if (index.has_value())
+                                wall_band[*index] = wall;
+                        });
+                    }
+                }
+            }
+        }
+
+        for (auto y = band_start_y; y < band_end_y; y++)
+        {
+            if (m_cancel_requested.load())
+                return false;
+
+            render_strip(band, wall_band, liquid_band, band_width, (y - band_start_y) + 1, strip);
+            if (!writer->write_rows(strip.data(), m_tile_size))
+            {
+                warnln("Failed to write to {}", path);
+                return false;
+            }
+
+            m_strips_written.store((y - m_region.y) + 1, AK::MemoryOrder::memory_order_relaxed);
+        }
+
+        band_start_y = band_end_y;
+    }
+
+    if (!writer->finish())
+    {
+        warnln("Failed to write to {}", path);
+        return false;
+    }
+
+    outln("Exported {}x{} image to {}", width, height, path);
+    return true;
+}
+
+void WorldExporter::render_strip(const Vector<Terraria::Tile>& band, const Vector<WallLayer::Wall>& wall_band,
+                                 const Vector<u8>& liquid_band, int band_width, int band_y, Vector<u8>& strip)
+{
+    // Anything nothing is drawn over stays transparent
+    memset(strip.data(), 0, strip.size());
+
+    // Walls go behind everything else, like in the editor. Every wall in the rows around this one (and a column past
+    // either edge) reaches into it.
+    if (m_walls)
+    {
+        for (auto wall_y = band_y - 1; wall_y <= band_y + 1; wall_y++)
+        {
+            for (auto x = -1; x <= m_region.width; x++)
+            {
+                auto& wall = wall_band[(x + 1) + (band_width * wall_y)];
+                if (wall.id == 0)
+                    continue;
+
+                auto* sheet = wall_sheet(wall.id);
+                if (sheet)
+                    draw_wall(strip, x, wall_y - band_y, *sheet, wall);
+            }
+        }
+    }
+
+    for (auto x = 0; x < m_region.width; x++)
+    {
+        auto band_index = (x + 1) + (band_width * band_y);
+        auto& tile = band[band_index];
+        if (tile.block().has_value())
+        {
+            auto* sheet = tile_sheet(static_cast<u16>(tile.block()->id()));
+            if (sheet)
+            {
+                auto frame_x = tile.block()->frame_x().has_value() ? *tile.block()->frame_x() : 0;
+                auto frame_y = tile.block()->frame_y().has_value() ? *tile.block()->frame_y() : 0;
+                draw_sprite(strip, x, *sheet, frame_x, frame_y, tile.is_actuated() ? 0x5f : 0xff);
+            }
+        }
+
+        if (!m_draw_wires)
+            continue;
+
+        auto& top = band[band_index - band_width];
+        auto& bottom = band[band_index + band_width];
+        auto& left = band[band_index - 1];
+        auto& right = band[band_index + 1];
+
+        // Same order as the editor draws them in, so they overlap the same way
+        auto draw_wire = [&](size_t color, auto has_wire)
+        {
+            if (!has_wire(tile) || !m_wire_sheets[color])
+                return;
+
+            auto frame = FrameTable::wire_frame(FrameTable::wire_neighbours(has_wire(top), has_wire(bottom),
+                                                                            has_wire(left), has_wire(right)));
+            draw_sprite(strip, x, *m_wire_sheets[color], frame.x, frame.y, 0x7f);
+        };
+
+        draw_wire(0, [](auto& wire_tile) { return wire_tile.has_red_wire(); });
+        draw_wire(1, [](auto& wire_tile) { return wire_tile.has_blue_wire(); });
+        draw_wire(2, [](auto& wire_tile) { return wire_tile.has_green_wire(); });
+        draw_wire(3, [](auto& wire_tile) { return wire_tile.has_yellow_wire(); });
+
+        if (tile.has_actuator() && m_actuator_sheet)
+            draw_sprite(strip, x, *m_actuator_sheet, 0, 0, 0x7f);
+    }
+
+    // Liquids go over everything else, settled at the bottom of their tile, like in the editor
+    if (!m_liquids)
+        return;
+
+    auto strip_width = m_region.width * m_tile_size;
+    for (auto x = 0; x < m_region.width; x++)
+    {
+        auto liquid = liquid_band[(x + 1) + (band_width * band_y)];
+        if (liquid == 0)
+            continue;
+
+        auto abgr = LiquidLayer::colors[static_cast<u8>(LiquidLayer::type_of(liquid))];
+        Gfx::Color color(abgr & 0xff, (abgr >> 8) & 0xff, (abgr >> 16) & 0xff, abgr >> 24);
+        auto filled_rows = ((LiquidLayer::amount_of(liquid) * m_tile_size) + (LiquidLayer::max_amount / 2)) /
+                           LiquidLayer::max_amount;
+        for (auto y = m_tile_size - filled_rows; y < m_tile_size; y++)
+        {
+            for (auto pixel_x = 0; pixel_x < m_tile_size; pixel_x++)
+                blend(&strip[((y * strip_width) + (x * m_tile_size) + pixel_x) * 4], color, 0xff);
+        }
+    }
+}
+
+void WorldExporter::draw_sprite(Vector<u8>& strip, int tile_x, const Gfx::Bitmap& sheet, int frame_x, int frame_y,
+                                u8 alpha) const
+{
+    auto strip_width = m_region.width * m_tile_size;
+    for (auto y = 0; y < m_tile_size; y++)
+    {
+        auto sheet_y = frame_y + ((y * sheet_tile_size) / m_tile_size);
+        if (sheet_y >= sheet.height())
+            break;
+
+        for (auto x = 0; x < m_tile_size; x++)
+        {
+            auto sheet_x = frame_x + ((x * sheet_tile_size) / m_tile_size);
+            if (sheet_x >= sheet.width())
+                break;
+
+            blend(&strip[(((y * strip_width) + (tile_x * m_tile_size) + x) * 4)], sheet.get_pixel(sheet_x, sheet_y),
+                  alpha);
+        }
+    }
+}
+
+void WorldExporter::draw_wall(Vector<u8>& strip, int tile_x, int row_offset, const Gfx::Bitmap& sheet,
+                              const WallLayer::Wall& wall) const
+{
+    // Where the wall starts, in sheet pixels from the top left of the strip
+    auto wall_left = (tile_x * sheet_tile_size) - (sheet_tile_size / 2);
+    auto wall_top = (row_offset * sheet_tile_size) - (sheet_tile_size / 2);
+
+    auto strip_width = m_region.width * m_tile_size;
+    auto start_x = max((tile_x - 1) * m_tile_size, 0);
+    auto end_x = min((tile_x + 2) * m_tile_size, strip_width);
+    for (auto y = 0; y < m_tile_size; y++)
+    {
+        auto wall_y = ((y * sheet_tile_size) / m_tile_size) - wall_top;
+        auto sheet_y = (wall.frame_y * wall_frame_spacing) + wall_y;
+        if (wall_y < 0 || wall_y >= wall_size || sheet_y >= sheet.height())
+            continue;
+
+        for (auto x = start_x; x < end_x; x++)
+        {
+            auto wall_x = ((x * sheet_tile_size) / m_tile_size) - wall_left;
+            auto sheet_x = (wall.frame_x * wall_frame_spacing) + wall_x;
+            if (wall_x < 0 || wall_x >= wall_size || sheet_x >= sheet.width())
+                continue;
+
+            blend(&strip[((y * strip_width) + x) * 4], sheet.get_pixel(sheet_x, sheet_y), 0xff);
+        }
+    }
+}
+
+const Gfx::Bitmap* WorldExporter::tile_sheet(u16 id)
+{
+    auto it = m_tile_sheets.find(id);
+    if (it == m_tile_sheets.end())
+    {
+        m_tile_sheets.set(id, Gfx::load_png(String::formatted("Content/images/Tiles_{}.png", id)));
+        it = m_tile_sheets.find(id);
+    }
+
+    return it->value.ptr();
+}
+
+const Gfx::Bitmap* WorldExporter::wall_sheet(u16 id)
+{
+    auto it = m_wall_sheets.find(id);
+    if (it == m_wall_sheets.end())
+    {
+        m_wall_sheets.set(id, Gfx::load_png(String::formatted("Content/images/Wall_{}.png", id)));
+        it = m_wall_sheets.find(id);
+    }
+
+    return it->value.ptr();
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/HashMap.h>
+#include <AK/String.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/LiquidLayer.h>
+#include <Editor/WallLayer.h>
+#include <Editor/WorldThread.h>
+#include <LibGfx/Bitmap.h>
+#include <thread>
+
+// Renders (part of) a world to a PNG, using the same texture sheets the editor draws with. This is all done on the
+// CPU one strip of tiles at a time, so it works without a window (or even a GPU), and the image is never entirely in
+// memory.
+class WorldExporter
+{
+public:
+    struct Region
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    // Tiles are 16 pixels in the texture sheets, a smaller tile_size scales them down. Walls and liquids are only drawn
+    // if they're given, and must be from the same world thread as the tiles if there is one.
+    WorldExporter(const ChunkedTileMap&, const WallLayer*, const LiquidLayer*, Region, int tile_size, bool draw_wires);
+
+    // Waits for a background export to stop (early, if it hasn't finished yet)
+    ~WorldExporter();
+
+    // Exports right here, on this thread. If a world thread is given, the tiles have to be its own (see
+    // WorldThread::tiles()), and are locked while reading each strip.
+    bool export_png(const String& path, WorldThread* = nullptr);
+
+    // Exports on a background thread, keep an eye on is_finished() to know when it's done
+    void start_export_png(String path, WorldThread&);
+
+    bool is_finished() const
+    { return m_finished.load(AK::MemoryOrder::memory_order_acquire); }
+
+    // Only meaningful once is_finished() is true
+    bool succeeded() const
+    { return m_succeeded; }
+
+    size_t strips_written() const
+    { return m_strips_written.load(AK::MemoryOrder::memory_order_relaxed); }
+
+    size_t strip_count() const
+    { return m_region.height; }
+
+private:
+    // Draws one row of the band's tiles into the strip, which is tile_size rows of pixels tall
+    void render_strip(const Vector<Terraria::Tile>& band, const Vector<WallLayer::Wall>& wall_band,
+                      const Vector<u8>& liquid_band, int band_width, int band_y, Vector<u8>& strip);
+
+    void draw_sprite(Vector<u8>& strip, int tile_x, const Gfx::Bitmap&, int frame_x, int frame_y, u8 alpha) const;
+
+    // Draws whatever part of the wall reaches into the strip, from a tile row_offset rows away from it
+    void draw_wall(Vector<u8>& strip, int tile_x, int row_offset, const Gfx::Bitmap&, const WallLayer::Wall&) const;
+
+    const Gfx::Bitmap* tile_sheet(u16 id);
+
+    const Gfx::Bitmap* wall_sheet(u16 id);
+
+    const ChunkedTileMap& m_tiles;
+    const WallLayer* m_walls;
+    const LiquidLayer* m_liquids;
+    Region m_region;
+    int m_tile_size;
+    bool m_draw_wires;
+
+    // Loaded the first time a block uses them, most worlds don't use most of the sheets
+    HashMap<u16, RefPtr<Gfx::Bitmap>> m_tile_sheets;
+    HashMap<u16, RefPtr<Gfx::Bitmap>> m_wall_sheets;
+    RefPtr<Gfx::Bitmap> m_wire_sheets[4];
+    RefPtr<Gfx::Bitmap> m_actuator_sheet;
+
+    Atomic<size_t> m_strips_written{0};
+    Atomic<bool> m_cancel_requested{false};
+    Atomic<bool> m_finished{false};
+    bool m_succeeded{};
+    std::thread m_thread;
+};
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/NameTable.h>
+#include <Editor/WorldGenerator.h>
+
+// Generating touches chunks all over the place, so every so often we compress everything again, otherwise a big
+// world would end up entirely decompressed in memory
+static constexpr size_t max_resident_chunks = 512;
+
+static void keep_memory_bounded(ChunkedTileMap& tiles)
+{
+    if (tiles.resident_chunk_count() > max_resident_chunks)
+        tiles.compress_all();
+}
+
+Vector<WorldGenerator::BlockWeight> WorldGenerator::default_blocks()
+{
+    auto blocks = parse_blocks("Stone:70,Dirt:12,ClayBlock:4,Sand:3,Mud:3,Copper:3,Iron:2,Silver:2,Gold:1");
+    VERIFY(!blocks.is_error());
+    return blocks.release_value();
+}
+
+Result<Vector<WorldGenerator::BlockWeight>, String> WorldGenerator::parse_blocks(const StringView& text)
+{
+    Vector<BlockWeight> blocks;
+    for (auto& part : text.split_view(','))
+    {
+        auto name_and_weight = part.split_view(':');
+        if (name_and_weight.size() != 2)
+            return String::formatted("Expected block:weight, not {}", part);
+
+        auto id = NameTable::tiles().find(name_and_weight[0]);
+        if (!id.has_value())
+            return String::formatted("Unknown block {}", name_and_weight[0]);
+
+        auto weight = name_and_weight[1].to_uint();
+        if (!weight.has_value() || *weight == 0)
+            return String::formatted("Bad weight {} for {}", name_and_weight[1], name_and_weight[0]);
+
+        blocks.append({static_cast<Terraria::Tile::Block::Id>(*id), *weight});
+    }
+
+    if (blocks.is_empty())
+        return String("No blocks given");
+
+    return blocks;
+}
+
+WorldGenerator::WorldGenerator(Settings settings)
+        : m_settings(move(settings)),
+          m_random_state(m_settings.seed)
+{
+    if (m_settings.blocks.is_empty())
+        m_settings.blocks = default_blocks();
+}
+
+u64 WorldGenerator::next_random()
+{
+    // splitmix64, which is tiny and gives the same numbers everywhere (unlike <random>'s distributions)
+    auto value = (m_random_state += 0x9e3779b97f4a7c15);
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+    return value ^ (value >> 31);
+}
+
+u32 WorldGenerator::random_below(u32 bound)
+{
+    if (bound == 0)
+        return 0;
+
+    return static_cast<u32>(next_random() % bound);
+}
+
+NonnullOwnPtr<ChunkedTileMap> WorldGenerator::generate()
+{
+    auto tiles = make<ChunkedTileMap>(m_settings.width, m_settings.height);
+    m_placed_object_count = 0;
+
+    generate_ground(*tiles);
+    generate_veins(*tiles);
+    generate_caves(*tiles);
+    frame_everything(*tiles);
+    // Objects and wires don't need framing by their neighbours, and framing the objects would break them
+    place_objects(*tiles);
+    generate_wires(*tiles);
+
+    tiles->compress_all();
+    tiles->update_chunk_hashes();
+    return tiles;
+}
+
+void WorldGenerator::generate_ground(ChunkedTileMap& tiles)
+{
+    auto width = m_settings.width;
+    auto height = m_settings.height;
+
+    // The surface wanders up and down around a quarter of the way down, smoothed so it makes hills instead of spikes
+    m_surface.resize(width);
+    auto surface = static_cast<float>(height) / 4.0f;
+    auto slope = 0.0f;
+    for (auto x = 0; x < width; x++)
+    {
+        slope = (slope * 0.95f) + ((static_cast<float>(random_below(2001)) - 1000.0f) / 1000.0f * 0.1f);
+        surface = clamp(surface + slope, static_cast<float>(height) / 8.0f, static_cast<float>(height) / 2.0f);
+        m_surface[x] = static_cast<u16>(surface);
+    }
+
+    // Filled a band of chunks at a time, so only one band is ever decompressed
+    Terraria::Tile ground(Terraria::Tile::Block(m_settings.blocks[0].id));
+    for (auto band_y = 0; band_y < height; band_y += ChunkedTileMap::chunk_size)
+    {
+        auto end_y = min<int>(band_y + ChunkedTileMap::chunk_size, height);
+        for (auto y = band_y; y < end_y; y++)
+        {
+            for (auto x = 0; x < width; x++)
+            {
+                if (y >= m_surface[x])
+                    tiles.at(x, y) = ground;
+            }
+        }
+
+        tiles.compress_all();
+    }
+}
+
+void WorldGenerator::generate_veins(ChunkedTileMap& tiles)
+{
+    size_t ground_tiles = 0;
+    for (auto surface : m_surface)
+        ground_tiles += m_settings.height - surface;
+
+    u64 total_weight = 0;
+    for (auto& block : m_settings.blocks)
+        total_weight += block.weight;
+
+    for (size_t i = 1; i < m_settings.blocks.size(); i++)
+    {
+        auto& block = m_settings.blocks[i];
+        auto wanted_tiles = ground_tiles * block.weight / total_weight;
+
+        // Veins overlap each other a bit, so this is only roughly their share
+        size_t filled_tiles = 0;
+        while (filled_tiles < wanted_tiles)
+        {
+            auto radius = 2 + static_cast<int>(random_below(6));
+            auto x = static_cast<int>(random_below(m_settings.width));
+            auto y = m_surface[x] + static_cast<int>(random_below(m_settings.height - m_surface[x]));
+            fill_circle(tiles, x, y, radius, block.id);
+            filled_tiles += 3 * radius * radius;
+            keep_memory_bounded(tiles);
+        }
+    }
+}
+
+void WorldGenerator::generate_caves(ChunkedTileMap& tiles)
+{
+    // Caves are worms that wander through the ground, leaving a tunnel behind them
+    auto cave_count = (static_cast<size_t>(m_settings.width) * m_settings.height) / 40000;
+    for (size_t cave = 0; cave < cave_count; cave++)
+    {
+        auto x = static_cast<float>(random_below(m_settings.width));
+        auto y = static_cast<float>(m_surface[static_cast<int>(x)] + 20 +
+                                    random_below(max(m_settings.height - m_surface[static_cast<int>(x)] - 20, 1)));
+        auto direction_x = 0.0f;
+        auto direction_y = 0.0f;
+        auto length = 50 + random_below(300);
+        for (u32 step = 0; step < length; step++)
+        {
+            direction_x = clamp(direction_x + ((static_cast<float>(random_below(201)) - 100.0f) / 200.0f), -1.0f, 1.0f);
+            direction_y = clamp(direction_y + ((static_cast<float>(random_below(201)) - 100.0f) / 400.0f), -0.5f,
+                                0.5f);
+            x += direction_x * 2.0f;
+            y += direction_y * 2.0f;
+            fill_circle(tiles, static_cast<int>(x), static_cast<int>(y), 1 + static_cast<int>(random_below(3)), {});
+        }
+
+        keep_memory_bounded(tiles);
+    }
+}
+
+void WorldGenerator::generate_wires(ChunkedTileMap& tiles)
+{
+    // Wires are laid in straight lines that turn every now and then, like people actually lay them
+    constexpr u32 average_wire_length = 64;
+    auto wire_count = (static_cast<size_t>(m_settings.width) * m_settings.height * m_settings.wired_tiles_per_thousand)
+                      / 1000 / average_wire_length;
+
+    for (size_t wire = 0; wire < wire_count; wire++)
+    {
+        auto x = static_cast<int>(random_below(m_settings.width));
+        auto y = static_cast<int>(random_below(m_settings.height));
+        auto color = random_below(4);
+        auto direction = random_below(4);
+        auto length = average_wire_length / 2 + random_below(average_wire_length);
+
+        for (u32 step = 0; step < length && tiles.contains(x, y); step++)
+        {
+            auto& tile = tiles.at(x, y);
+            switch (color)
+            {
+                case 0:
+                    tile.set_red_wire(true);
+                    break;
+                case 1:
+                    tile.set_blue_wire(true);
+                    break;
+                case 2:
+                    tile.set_green_wire(true);
+                    break;
+                default:
+                    tile.set_yellow_wire(true);
+                    break;
+            }
+
+            if (random_below(16) == 0)
+                direction = random_below(4);
+
+            x += direction == 0 ? 1 : direction == 1 ? -1 : 0;
+            y += direction == 2 ? 1 : direction == 3 ? -1 : 0;
+        }
+
+        // Whatever the wire ends at is probably something that gets actuated
+        auto& end = tiles.at(x, y);
+        if (end.block().has_value() && random_below(4) == 0)
+            end.set_has_actuator(true);
+
+        keep_memory_bounded(tiles);
+    }
+}
+
+void WorldGenerator::place_objects(ChunkedTileMap& tiles)
+{
+    auto& objects = Object::all_objects();
+    if (objects.is_empty())
+        return;
+
+    auto fits = [&](const Object& object, int x, int y)
+    {
+        for (auto object_x = 0; object_x < object.width(); object_x++)
+        {
+            if (!tiles.contains(x + object_x, y + object.height()) ||
+                !tiles.tile_at(x + object_x, y + object.height()).block().has_value())
+            {
+                return false;
+            }
+
+            for (auto object_y = 0; object_y < object.height(); object_y++)
+            {
+                if (!tiles.contains(x + object_x, y + object_y) ||
+                    tiles.tile_at(x + object_x, y + object_y).block().has_value())
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    };
+
+    // Most tries will hit solid ground, so give up on each object after a while
+    constexpr size_t tries_per_object = 16;
+    constexpr int max_fall = 64;
+    for (size_t i = 0; i < m_settings.object_count * tries_per_object; i++)
+    {
+        if (m_placed_object_count == m_settings.object_count)
+            break;
+
+        auto& object = objects[random_below(objects.size())];
+        auto x = static_cast<int>(random_below(m_settings.width));
+        auto y = static_cast<int>(random_below(m_settings.height));
+
+        // Fall from there until we land on something
+        for (auto fall = 0; fall < max_fall && y + object.height() < m_settings.height; fall++, y++)
+        {
+            if (!fits(object, x, y))
+                continue;
+
+            for (auto object_x = 0; object_x < object.width(); object_x++)
+            {
+                for (auto object_y = 0; object_y < object.height(); object_y++)
+                    tiles.at(x + object_x, y + object_y) = object.tile_for_style(object_x, object_y, 0, 0);
+            }
+
+            m_placed_object_count++;
+            break;
+        }
+
+        keep_memory_bounded(tiles);
+    }
+}
+
+void WorldGenerator::frame_everything(ChunkedTileMap& tiles)
+{
+    for (auto band_y = 0; band_y < m_settings.height; band_y += ChunkedTileMap::chunk_size)
+    {
+        tiles.frame_region(0, band_y, m_settings.width, min<int>(band_y + ChunkedTileMap::chunk_size,
+                                                                  m_settings.height));
+        tiles.compress_all();
+    }
+}
+
+void WorldGenerator::fill_circle(ChunkedTileMap& tiles, int center_x, int center_y, int radius,
+                                 Optional<Terraria::Tile::Block::Id> id)
+{
+    for (auto y = center_y - radius; y <= center_y + radius; y++)
+    {
+        for (auto x = center_x - radius; x <= center_x + radius; x++)
+        {
+            auto distance_x = x - center_x;
+            auto distance_y = y - center_y;
+            if ((distance_x * distance_x) + (distance_y * distance_y) > radius * radius || !tiles.contains(x, y))
+                continue;
+
+            // Don't decompress chunks for tiles we wouldn't change anyway
+            if (!tiles.tile_at(x, y).block().has_value())
+                continue;
+
+            auto& tile = tiles.at(x, y);
+            if (id.has_value())
+                tile.block() = Terraria::Tile::Block(*id);
+            else
+                tile.block() = {};
+        }
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Result.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/Object.h>
+
+// Makes up worlds of any size, for seeing how the editor copes with worlds a lot bigger than any we have. They're
+// nothing like real worlds, but they have the things that matter for that: long runs of ground with veins of other
+// blocks, caves, wires and objects. The same settings always give exactly the same world.
+class WorldGenerator
+{
+public:
+    struct BlockWeight
+    {
+        Terraria::Tile::Block::Id id;
+        u32 weight;
+    };
+
+    struct Settings
+    {
+        u16 width{8400};
+        u16 height{2400};
+        u64 seed{};
+        // What the ground is made of. The first block fills the ground, the rest are veins in it, each taking up
+        // about its share of the ground.
+        Vector<BlockWeight> blocks;
+        // Roughly how many tiles in a thousand have a wire on them
+        u32 wired_tiles_per_thousand{5};
+        // How many objects from the catalog to try and place, on the surface and in caves
+        size_t object_count{};
+    };
+
+    // Stone, with dirt, clay, sand, mud and some ores in it
+    static Vector<BlockWeight> default_blocks();
+
+    // Parses something like "Stone:80,Dirt:15,Iron:5", using the blocks' internal names
+    static Result<Vector<BlockWeight>, String> parse_blocks(const StringView&);
+
+    explicit WorldGenerator(Settings);
+
+    NonnullOwnPtr<ChunkedTileMap> generate();
+
+    size_t placed_object_count() const
+    { return m_placed_object_count; }
+
+private:
+    u64 next_random();
+
+    // A random number in [0, bound)
+    u32 random_below(u32 bound);
+
+    void generate_ground(ChunkedTileMap&);
+
+    void generate_veins(ChunkedTileMap&);
+
+    void generate_caves(ChunkedTileMap&);
+
+    void generate_wires(ChunkedTileMap&);
+
+    void place_objects(ChunkedTileMap&);
+
+    void frame_everything(ChunkedTileMap&);
+
+    // Fills in a circle, but only where there's already a block, so veins never stick out of the ground
+    void fill_circle(ChunkedTileMap&, int center_x, int center_y, int radius, Optional<Terraria::Tile::Block::Id>);
+
+    Settings m_settings;
+    u64 m_random_state;
+    // The y of the topmost block in each column
+    Vector<u16> m_surface;
+    size_t m_placed_object_count{};
+};
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/MemoryStream.h>
+#include <AK/NumericLimits.h>
+#include <AK/Optional.h>
+#include <Editor/BinaryStream.h>
+#include <Editor/WorldLoader.h>
+#include <LibCore/File.h>
+
+// Worlds since 1.3.0.1 say what they are after the version
+static constexpr i32 first_version_with_magic = 135;
+static constexpr char world_magic[7] = {'r', 'e', 'l', 'o', 'g', 'i', 'c'};
+static constexpr u8 world_file_type = 2;
+// A world has had 11 sections for a long time, this leaves room for a good few more
+static constexpr i16 max_section_count = 64;
+
+// LibTerraria seeks straight to the sections it finds in here, so make sure they're all actually in the file
+static Optional<String> check_file_header(ReadonlyBytes bytes)
+{
+    BinaryReader reader(bytes);
+    auto truncated = String("The file ends in the middle of its header");
+
+    i32 version;
+    if (!reader.read(version))
+        return truncated;
+
+    if (version < 0)
+        return String::formatted("The file has an impossible version ({})", version);
+
+    if (version >= first_version_with_magic)
+    {
+        for (auto c : world_magic)
+        {
+            u8 byte;
+            if (!reader.read(byte))
+                return truncated;
+            if (byte != static_cast<u8>(c))
+                return String("The file isn't a world");
+        }
+
+        u8 file_type;
+        u32 revision;
+        u64 favorite;
+        if (!reader.read(file_type) || !reader.read(revision) || !reader.read(favorite))
+            return truncated;
+
+        if (file_type != world_file_type)
+            return String("The file isn't a world (it's some other kind of Terraria file)");
+    }
+
+    i16 section_count;
+    if (!reader.read(section_count))
+        return truncated;
+
+    if (section_count <= 0 || section_count > max_section_count)
+        return String::formatted("The file has an impossible number of sections ({})", section_count);
+
+    Vector<i32> section_offsets;
+    for (auto i = 0; i < section_count; i++)
+    {
+        i32 offset;
+        if (!reader.read(offset))
+            return truncated;
+        section_offsets.append(offset);
+    }
+
+    i16 frame_important_count;
+    if (!reader.read(frame_important_count))
+        return truncated;
+
+    if (frame_important_count < 0)
+        return String::formatted("The file has an impossible number of tiles ({})", frame_important_count);
+
+    for (auto i = 0; i < (frame_important_count + 7) / 8; i++)
+    {
+        u8 bits;
+        if (!reader.read(bits))
+            return truncated;
+    }
+
+    // Sections come one after the other, starting right after this header
+    auto previous_offset = static_cast<i64>(reader.offset()) - 1;
+    for (auto offset : section_offsets)
+    {
+        if (offset <= previous_offset || static_cast<size_t>(offset) >= bytes.size())
+            return String::formatted("The file has a section in an impossible place ({})", offset);
+        previous_offset = offset;
+    }
+
+    return {};
+}
+
+Result<NonnullRefPtr<Terraria::World>, String> WorldLoader::load(const String& path)
+{
+    auto file_or_error = Core::File::open(path, Core::OpenMode::ReadOnly);
+    if (file_or_error.is_error())
+        return String::formatted("Failed to open {}: {}", path, file_or_error.error());
+
+    auto file_bytes = file_or_error.value()->read_all();
+    auto world_or_error = load_from_bytes(file_bytes);
+    if (world_or_error.is_error())
+        return String::formatted("Failed to load {}: {}", path, world_or_error.error());
+
+    return world_or_error.release_value();
+}
+
+Result<NonnullRefPtr<Terraria::World>, String> WorldLoader::load_from_bytes(ReadonlyBytes bytes)
+{
+    if (bytes.is_empty())
+        return String("The file is empty");
+
+    auto header_error = check_file_header(bytes);
+    if (header_error.has_value())
+        return header_error.release_value();
+
+    InputMemoryStream bytes_stream(bytes);
+    auto world_or_error = Terraria::World::try_load_world(bytes_stream);
+    if (world_or_error.is_error())
+        return String::formatted("{}", world_or_error.error());
+
+    // Reading past the end doesn't fail on its own, it just leaves an error on the stream
+    if (bytes_stream.has_any_error())
+    {
+        bytes_stream.handle_any_error();
+        return String("The file ends in the middle of the world");
+    }
+
+    auto world = world_or_error.release_value();
+
+    Vector<Gfx::IntPoint> chest_positions;
+    for (auto& kv : world->chests())
+        chest_positions.append({kv.value.position().x(), kv.value.position().y()});
+
+    Vector<Gfx::IntPoint> sign_positions;
+    for (auto& kv : world->signs())
+        sign_positions.append({kv.value.position().x(), kv.value.position().y()});
+
+    auto world_error = check_world(world->m_max_tiles_x, world->m_max_tiles_y, chest_positions, sign_positions);
+    if (world_error.has_value())
+        return world_error.release_value();
+
+    return world;
+}
+
+Optional<String> WorldLoader::check_world(i32 width, i32 height, const Vector<Gfx::IntPoint>& chest_positions,
+                                          const Vector<Gfx::IntPoint>& sign_positions)
+{
+    // The tile map (and everything built on it) uses 16 bit positions
+    if (width <= 0 || height <= 0 || width > NumericLimits<u16>::max() || height > NumericLimits<u16>::max())
+        return String::formatted("The world has an impossible size ({}x{})", width, height);
+
+    // Chests and signs are looked up by their position, so one off the edge of the world would be read out of bounds
+    auto outside_of_world = [&](auto& position) {
+        return position.x() < 0 || position.y() < 0 || position.x() >= width || position.y() >= height;
+    };
+
+    for (auto& position : chest_positions)
+    {
+        if (outside_of_world(position))
+            return String::formatted("There's a chest outside of the world, at {},{}", position.x(), position.y());
+    }
+
+    for (auto& position : sign_positions)
+    {
+        if (outside_of_world(position))
+            return String::formatted("There's a sign outside of the world, at {},{}", position.x(), position.y());
+    }
+
+    return {};
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/NonnullRefPtr.h>
+#include <AK/Result.h>
+#include <AK/Span.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <LibGfx/Point.h>
+#include <LibTerraria/World.h>
+
+// Where every world the editor opens comes through. World files come from players and could be anything, so the
+// file's header is checked before LibTerraria reads any of it, and the world is checked again after: you either get
+// a world the rest of the editor can safely work with, or a message saying what's wrong with it. What LibTerraria
+// does with a bad file past its header is up to it, which is what the fuzzer (TADAPT_BUILD_FUZZER) is for.
+class WorldLoader
+{
+public:
+    static Result<NonnullRefPtr<Terraria::World>, String> load(const String& path);
+
+    static Result<NonnullRefPtr<Terraria::World>, String> load_from_bytes(ReadonlyBytes);
+
+    // What's checked once LibTerraria has read the world. Split out so the tests can get at it without having to write
+    // a whole world file.
+    static Optional<String> check_world(i32 width, i32 height, const Vector<Gfx::IntPoint>& chest_positions,
+                                        const Vector<Gfx::IntPoint>& sign_positions);
+};
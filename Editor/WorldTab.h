@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/String.h>
+#include <Editor/Camera.h>
+#include <Editor/ChestIndex.h>
+#include <Editor/ChunkRenderCache.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/LiquidLayer.h>
+#include <Editor/ObjectRecognizer.h>
+#include <Editor/WallLayer.h>
+#include <Editor/WireNetworks.h>
+#include <Editor/WorldDiff.h>
+#include <Editor/WorldExporter.h>
+#include <Editor/WorldThread.h>
+#include <Editor/WorldValidator.h>
+#include <LibTerraria/World.h>
+
+// Everything that belongs to one open world: the world itself, and where we are looking at it and what we have
+// selected in it. Anything shared between worlds (like the texture sheets) stays on the Application.
+struct WorldTab
+{
+    WorldTab(NonnullRefPtr<Terraria::World> world, String name, u32 id)
+            : world(move(world)),
+              chests(*this->world),
+              tiles(ChunkedTileMap::create_from_world(*this->world)),
+              walls(WallLayer::create_from_world(*this->world)),
+              liquids(LiquidLayer::create_from_world(*this->world)),
+              thread(make<WorldThread>(*this->world, *tiles, *walls, *liquids)),
+              objects(*tiles),
+              name(move(name)),
+              label(String::formatted("{}###World{}", this->name, id)),
+              render_cache(*tiles)
+    {
+        camera.set_world_size(tiles->width(), tiles->height());
+    }
+
+    // FIXME: LibTerraria has no way to let go of a world's tile map, so the fully decoded tiles stay around for as
+    //        long as the tab does, even though we only ever read them once to build the layers below.
+    NonnullRefPtr<Terraria::World> world;
+    // Has to be told whenever a chest changes, which is only ever done from the main thread
+    ChestIndex chests;
+    // This is what we view, instead of the world's own tile map. It's only ever touched on the UI thread, edits are
+    // made to the world thread's copy and come back here through WorldThread::update_view().
+    NonnullOwnPtr<ChunkedTileMap> tiles;
+    // Same goes for the walls and liquids
+    NonnullOwnPtr<WallLayer> walls;
+    NonnullOwnPtr<LiquidLayer> liquids;
+    // Every edit goes through here
+    NonnullOwnPtr<WorldThread> thread;
+    ObjectRecognizer objects;
+    String name;
+    // The last validation we started, if any. Declared after the thread, since it reads the thread's tiles.
+    OwnPtr<WorldValidator> validator;
+    // Same goes for the last export
+    OwnPtr<WorldExporter> exporter;
+    // What's different in the world we last compared this one with, if we're showing that
+    OwnPtr<WorldDiff> diff;
+    String diff_name;
+    // Tabs are identified by the part after ###, so opening the same world twice doesn't confuse ImGui
+    String label;
+
+    Camera camera;
+    ChunkRenderCache render_cache;
+
+    int selected_tile_x{};
+    int selected_tile_y{};
+    // The object the selected tile is part of, if it's part of one
+    Optional<RecognizedObject> selected_object;
+
+    // Only worked out once someone asks to see them
+    OwnPtr<WireNetworks> wires;
+
+    struct SelectedWireNetwork
+    {
+        WireColor color;
+        // Network ids change whenever the wires do, so we remember a tile that's in it too
+        int x;
+        int y;
+        WireNetworks::NetworkId network;
+        WireNetworks::Summary summary;
+    };
+
+    Optional<SelectedWireNetwork> selected_wire_network;
+
+    Terraria::Chest* selected_chest{};
+    char selected_chest_name[20]{};
+
+    Terraria::Sign* selected_sign{};
+    char selected_sign_text[512]{};
+
+    // The world thread has the world's chests and signs to itself while this is set, so we can't look at them
+    bool is_running_script{};
+};
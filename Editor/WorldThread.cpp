@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Editor/ScriptEngine.h>
+#include <Editor/WorldThread.h>
+#include <chrono>
+
+// How many commands can be applied before letting go of the lock, so readers never wait on a huge backlog
+static constexpr size_t max_commands_per_batch = 256;
+// How long we wait before trying to publish again, when the UI hasn't taken what we published last
+static constexpr auto publish_retry_interval = std::chrono::milliseconds(5);
+// How long nobody has to ask us for anything before we compress every chunk we decompressed to edit
+static constexpr auto idle_time_before_compressing = std::chrono::seconds(10);
+
+WorldThread::WorldThread(Terraria::World& world, const ChunkedTileMap& tiles, const WallLayer& walls,
+                         const LiquidLayer& liquids)
+        : m_world(world),
+          m_tiles(tiles.clone()),
+          m_walls(make<WallLayer>(walls)),
+          m_liquids(make<LiquidLayer>(liquids))
+{
+    m_unpublished_layers.resize(m_tiles->chunk_count());
+    m_thread = std::thread([this] { run(); });
+}
+
+WorldThread::~WorldThread()
+{
+    m_exit_requested.store(true);
+    m_wake_up.release();
+    m_thread.join();
+}
+
+void WorldThread::submit(EditCommand command)
+{
+    // The queue is big enough that this should never really happen, but if the world thread is that far behind
+    // there is nothing better for us to do than to wait for it.
+    while (!m_commands.try_enqueue(move(command)))
+        std::this_thread::yield();
+
+    m_wake_up.release();
+}
+
+void WorldThread::compress_soon()
+{
+    m_compress_requested.store(true);
+    m_wake_up.release();
+}
+
+std::shared_lock<std::shared_mutex> WorldThread::lock_tiles()
+{
+    // If the world thread is waiting for the lock, get in line behind it, otherwise a steady stream of readers (like
+    // the validator's workers) could keep it out forever
+    {
+        std::lock_guard turnstile(m_turnstile);
+    }
+
+    return std::shared_lock(m_tiles_mutex);
+}
+
+std::unique_lock<std::shared_mutex> WorldThread::lock_tiles_for_writing()
+{
+    std::lock_guard turnstile(m_turnstile);
+    return std::unique_lock(m_tiles_mutex);
+}
+
+void WorldThread::update_view(ChunkedTileMap& tiles, WallLayer& walls, LiquidLayer& liquids,
+                              Function<void(size_t)> callback)
+{
+    for (;;)
+    {
+        auto published_chunks = m_published_chunks.try_dequeue();
+        if (!published_chunks.has_value())
+            break;
+
+        for (auto& chunk : *published_chunks)
+        {
+            if (chunk.tiles.has_value())
+                tiles.replace_chunk(chunk.index, *chunk.tiles);
+
+            if (chunk.walls.has_value())
+                walls.replace_chunk(chunk.index, chunk.walls.release_value());
+
+            if (chunk.liquids.has_value())
+                liquids.replace_chunk(chunk.index, chunk.liquids.release_value());
+
+            callback(chunk.index);
+        }
+    }
+}
+
+void WorldThread::run()
+{
+    for (;;)
+    {
+        if (!m_unpublished_chunks.is_empty())
+        {
+            // The UI hasn't caught up with us yet, so try again in a bit, even if nothing else happens by then
+            m_wake_up.try_acquire_for(publish_retry_interval);
+        }
+        else if (m_tiles->resident_chunk_count() > 0)
+        {
+            if (!m_wake_up.try_acquire_for(idle_time_before_compressing))
+            {
+                compress_all();
+                continue;
+            }
+        }
+        else
+        {
+            m_wake_up.acquire();
+        }
+
+        if (m_exit_requested.load())
+            return;
+
+        // Every command releases the semaphore once, but a batch can take many of them, so this might be nothing
+        if (!m_commands.is_empty())
+            apply_batch();
+
+        if (!m_unpublished_chunks.is_empty())
+            publish();
+
+        // Snapshots are taken from compressed chunks just as well, so this doesn't have to wait for the UI
+        if (m_compress_requested.exchange(false))
+            compress_all();
+    }
+}
+
+void WorldThread::compress_all()
+{
+    auto locker = lock_tiles_for_writing();
+    m_tiles->compress_all();
+    m_resident_chunk_count.store(0, AK::MemoryOrder::memory_order_relaxed);
+}
+
+void WorldThread::apply_batch()
+{
+    auto locker = lock_tiles_for_writing();
+    for (size_t applied = 0; applied < max_commands_per_batch; applied++)
+    {
+        auto command = m_commands.try_dequeue();
+        if (!command.has_value())
+            break;
+
+        apply(*command);
+    }
+
+    flush_framing();
+    m_tiles->update_chunk_hashes();
+    m_resident_chunk_count.store(m_tiles->resident_chunk_count(), AK::MemoryOrder::memory_order_relaxed);
+
+    m_changed_tiles.for_each_rect([&](auto& rect) { mark_chunks_changed(rect, tiles_changed); });
+    m_changed_tiles.clear();
+    m_changed_walls.for_each_rect([&](auto& rect) { mark_chunks_changed(rect, walls_changed); });
+    m_changed_walls.clear();
+    m_changed_liquids.for_each_rect([&](auto& rect) { mark_chunks_changed(rect, liquids_changed); });
+    m_changed_liquids.clear();
+}
+
+void WorldThread::publish()
+{
+    // Nobody else writes to our copy, so we don't need the lock to read it
+    Vector<PublishedChunk> published_chunks;
+    published_chunks.ensure_capacity(m_unpublished_chunks.size());
+    for (auto chunk_index : m_unpublished_chunks)
+    {
+        auto layers = m_unpublished_layers[chunk_index];
+        PublishedChunk chunk{chunk_index, {}, {}, {}};
+        if ((layers & tiles_changed) != 0)
+            chunk.tiles = m_tiles->snapshot_chunk(chunk_index);
+
+        if ((layers & walls_changed) != 0)
+            chunk.walls = m_walls->copy_chunk(chunk_index);
+
+        if ((layers & liquids_changed) != 0)
+            chunk.liquids = m_liquids->copy_chunk(chunk_index);
+
+        published_chunks.unchecked_append(move(chunk));
+    }
+
+    // If the UI is this far behind, everything we couldn't publish is snapshotted again next time, by which point it
+    // might have changed some more anyway
+    if (!m_published_chunks.try_enqueue(move(published_chunks)))
+        return;
+
+    for (auto chunk_index : m_unpublished_chunks)
+        m_unpublished_layers[chunk_index] = 0;
+    m_unpublished_chunks.clear();
+}
+
+void WorldThread::apply(EditCommand& command)
+{
+    // Anything framed later in the batch would overwrite frames we're told to set exactly, so those have to wait
+    // until everything before them has been framed
+    auto flush_framing_if_needed = [&](int x, int y, int end_x, int end_y)
+    {
+        if (m_framing_region.intersects(x, y, end_x, end_y))
+            flush_framing();
+    };
+
+    auto changed_and_needs_framing = [&](int x, int y, int end_x, int end_y)
+    {
+        m_changed_tiles.add(x, y, end_x, end_y);
+        m_framing_region.add(x, y, end_x, end_y);
+    };
+
+    switch (command.type)
+    {
+        case EditCommand::Type::SetTile:
+        {
+            if (!command.frame)
+                flush_framing_if_needed(command.x, command.y, command.x + 1, command.y + 1);
+
+            m_tiles->at(command.x, command.y) = move(command.tile);
+            if (command.frame)
+                changed_and_needs_framing(command.x - 2, command.y - 2, command.x + 2, command.y + 2);
+            else
+                m_changed_tiles.add(command.x, command.y, command.x + 1, command.y + 1);
+            break;
+        }
+        case EditCommand::Type::PlaceObject:
+        {
+            auto& object = *command.object;
+            for (auto x = 0; x < object.width(); x++)
+            {
+                for (auto y = 0; y < object.height(); y++)
+                    m_tiles->at(command.x + x, command.y + y) = object.tile_for_style(x, y, command.style_x,
+                                                                                     command.style_y);
+            }
+
+            changed_and_needs_framing(command.x - 2, command.y - 2, command.x + object.width() + 2,
+                                      command.y + object.height() + 2);
+            break;
+        }
+        case EditCommand::Type::RestyleObject:
+        {
+            // Only the frames change, so the blocks around it don't need to be framed again
+            auto& object = *command.object;
+            flush_framing_if_needed(command.x, command.y, command.x + object.width(), command.y + object.height());
+            for (auto x = 0; x < object.width(); x++)
+            {
+                for (auto y = 0; y < object.height(); y++)
+                {
+                    auto& tile = m_tiles->at(command.x + x, command.y + y);
+                    if (!tile.block().has_value() || tile.block()->id() != object.block_id())
+                        continue;
+
+                    auto styled_tile = object.tile_for_style(x, y, command.style_x, command.style_y);
+                    tile.block()->frame_x() = styled_tile.block()->frame_x();
+                    tile.block()->frame_y() = styled_tile.block()->frame_y();
+                }
+            }
+
+            m_changed_tiles.add(command.x, command.y, command.x + object.width(), command.y + object.height());
+            break;
+        }
+        case EditCommand::Type::RemoveObject:
+        {
+            auto& object = *command.object;
+            for (auto x = 0; x < object.width(); x++)
+            {
+                for (auto y = 0; y < object.height(); y++)
+                {
+                    // Leave anything that isn't actually part of the object (like something placed over it) alone
+                    auto& tile = m_tiles->at(command.x + x, command.y + y);
+                    if (tile.block().has_value() && tile.block()->id() == object.block_id())
+                        tile.block() = {};
+                }
+            }
+
+            changed_and_needs_framing(command.x - 2, command.y - 2, command.x + object.width() + 2,
+                                      command.y + object.height() + 2);
+            break;
+        }
+        case EditCommand::Type::FrameRegion:
+            changed_and_needs_framing(command.x, command.y, command.end_x, command.end_y);
+            break;
+        case EditCommand::Type::SetWall:
+            m_walls->set_wall(command.x, command.y, command.wall_id);
+            m_changed_walls.add(command.x - 1, command.y - 1, command.x + 2, command.y + 2);
+            m_wall_framing_region.add(command.x - 1, command.y - 1, command.x + 2, command.y + 2);
+            break;
+        case EditCommand::Type::PaintTiles:
+            for (auto& position : command.positions)
+            {
+                m_tiles->at(position.x(), position.y()) = command.tile;
+                changed_and_needs_framing(position.x() - 2, position.y() - 2, position.x() + 2, position.y() + 2);
+            }
+            break;
+        case EditCommand::Type::PaintWalls:
+            for (auto& position : command.positions)
+            {
+                m_walls->set_wall(position.x(), position.y(), command.wall_id);
+                m_changed_walls.add(position.x() - 1, position.y() - 1, position.x() + 2, position.y() + 2);
+                m_wall_framing_region.add(position.x() - 1, position.y() - 1, position.x() + 2, position.y() + 2);
+            }
+            break;
+        case EditCommand::Type::PaintLiquid:
+            for (auto& position : command.positions)
+            {
+                m_liquids->set_liquid(position.x(), position.y(), command.liquid);
+                m_changed_liquids.add(position.x(), position.y(), position.x() + 1, position.y() + 1);
+            }
+            break;
+        case EditCommand::Type::FillLiquid:
+        case EditCommand::Type::FillLiquidBasin:
+        {
+            auto changed = command.type == EditCommand::Type::FillLiquid
+                           ? m_liquids->fill_region(m_tiles, command.x, command.y, command.end_x, command.end_y,
+                                                   command.liquid)
+                           : m_liquids->fill_basin(m_tiles, command.x, command.y, command.liquid);
+            if (changed.has_value())
+                m_changed_liquids.add(changed->x, changed->y, changed->end_x, changed->end_y);
+            break;
+        }
+        case EditCommand::Type::RunScript:
+        {
+            // The script should see everything before it framed, like it would if it were run on its own
+            flush_framing();
+
+            ScriptEngine engine(m_world, *m_tiles);
+            engine.run_file(command.script_path);
+
+            // Even a script that failed halfway through has changed everything up until then
+            engine.for_each_changed_rect([&](auto& rect)
+            {
+                changed_and_needs_framing(rect.x, rect.y, rect.end_x, rect.end_y);
+            });
+
+            // The UI only runs one script at a time per world, so there's always room for this
+            while (!m_script_outputs.try_enqueue(engine.output()))
+                std::this_thread::yield();
+            break;
+        }
+    }
+}
+
+void WorldThread::flush_framing()
+{
+    m_framing_region.for_each_rect([&](auto& rect)
+    {
+        m_tiles->frame_region(rect.x, rect.y, rect.end_x, rect.end_y);
+    });
+    m_framing_region.clear();
+
+    m_wall_framing_region.for_each_rect([&](auto& rect)
+    {
+        m_walls->frame_region(rect.x, rect.y, rect.end_x, rect.end_y);
+    });
+    m_wall_framing_region.clear();
+}
+
+void WorldThread::mark_chunks_changed(const DirtyRegion::Rect& rect, u8 layers)
+{
+    auto x = clamp(rect.x, 0, m_tiles->width() - 1);
+    auto y = clamp(rect.y, 0, m_tiles->height() - 1);
+    auto end_x = clamp(rect.end_x, 1, static_cast<int>(m_tiles->width()));
+    auto end_y = clamp(rect.end_y, 1, static_cast<int>(m_tiles->height()));
+
+    constexpr auto chunk_size = ChunkedTileMap::chunk_size;
+    for (auto chunk_y = y / chunk_size; chunk_y <= (end_y - 1) / chunk_size; chunk_y++)
+    {
+        for (auto chunk_x = x / chunk_size; chunk_x <= (end_x - 1) / chunk_size; chunk_x++)
+        {
+            auto chunk_index = chunk_x + (m_tiles->chunks_x() * chunk_y);
+            if (m_unpublished_layers[chunk_index] == 0)
+                m_unpublished_chunks.append(chunk_index);
+
+            m_unpublished_layers[chunk_index] |= layers;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/Function.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/DirtyRegion.h>
+#include <Editor/EditCommand.h>
+#include <Editor/LiquidLayer.h>
+#include <Editor/SPSCQueue.h>
+#include <Editor/WallLayer.h>
+#include <LibTerraria/World.h>
+#include <mutex>
+#include <semaphore>
+#include <shared_mutex>
+#include <thread>
+
+// Applies EditCommands on its own thread, to its own copy of the tiles, walls and liquids, so that the UI thread only
+// ever has to queue them up and never waits on them, however long they take.
+// Commands are applied in batches of however many are waiting. Framing is put off until the end of a batch, so
+// tiles touched by many edits in the same place (like a brush stroke) are only framed once. After every batch, a
+// snapshot of each chunk it changed is published, which the UI copies into the tile map and layers it actually looks
+// at with update_view(). That way the UI always sees the world in between two batches, without ever taking a lock.
+// Anything else that reads our copy (like a validation or an export) has to hold lock_tiles() while doing so.
+// Scripts are run here too, and can change the world's chests and signs as well, so the UI mustn't touch those until
+// take_script_output() has handed back what the script printed.
+class WorldThread
+{
+public:
+    // We start out with a copy of the tiles, walls and liquids. From then on, the ones we were given are the UI's view
+    // of the world, and only change through update_view().
+    WorldThread(Terraria::World&, const ChunkedTileMap&, const WallLayer&, const LiquidLayer&);
+
+    ~WorldThread();
+
+    // Only ever call this from the UI thread.
+    void submit(EditCommand);
+
+    // Compress every chunk once whatever was submitted before has been applied, for when the UI stops looking at this
+    // world (like when switching to another tab) and there's no point waiting for it to go idle first.
+    void compress_soon();
+
+    // Any number of readers can hold this at once, and they only ever wait on the batch being applied
+    [[nodiscard]] std::shared_lock<std::shared_mutex> lock_tiles();
+
+    // Our own copy of the world, which is usually a batch or so ahead of the UI's. Only read it with lock_tiles() held.
+    const ChunkedTileMap& tiles() const
+    { return *m_tiles; }
+
+    const WallLayer& walls() const
+    { return *m_walls; }
+
+    const LiquidLayer& liquids() const
+    { return *m_liquids; }
+
+    // How many of our chunks were decompressed after the last batch
+    size_t resident_chunk_count() const
+    { return m_resident_chunk_count.load(AK::MemoryOrder::memory_order_relaxed); }
+
+    // Copies every chunk published since the last time this was called into the view, then calls the callback with
+    // its index. Only ever call this from the UI thread.
+    void update_view(ChunkedTileMap&, WallLayer&, LiquidLayer&, Function<void(size_t)>);
+
+    // What the last script printed (and any error it raised), once it has finished running.
+    // Only ever call this from the UI thread.
+    Optional<String> take_script_output()
+    { return m_script_outputs.try_dequeue(); }
+
+private:
+    // Which of a chunk's layers have changed since it was last published
+    static constexpr u8 tiles_changed = 1 << 0;
+    static constexpr u8 walls_changed = 1 << 1;
+    static constexpr u8 liquids_changed = 1 << 2;
+
+    struct PublishedChunk
+    {
+        size_t index;
+        Optional<ChunkedTileMap::ChunkSnapshot> tiles;
+        Optional<Vector<WallLayer::Wall>> walls;
+        Optional<Vector<u8>> liquids;
+    };
+
+    void run();
+
+    std::unique_lock<std::shared_mutex> lock_tiles_for_writing();
+
+    void apply_batch();
+
+    void compress_all();
+
+    void apply(EditCommand&);
+
+    // Frames everything that needs it, so far
+    void flush_framing();
+
+    void mark_chunks_changed(const DirtyRegion::Rect&, u8 layers);
+
+    // Hands a snapshot of every chunk that has changed to the UI, unless it's too far behind to take them right now
+    void publish();
+
+    Terraria::World& m_world;
+    NonnullOwnPtr<ChunkedTileMap> m_tiles;
+    NonnullOwnPtr<WallLayer> m_walls;
+    NonnullOwnPtr<LiquidLayer> m_liquids;
+    std::shared_mutex m_tiles_mutex;
+    // Held by whoever is next in line for the lock, see lock_tiles()
+    std::mutex m_turnstile;
+
+    // What the current batch has changed, and which parts of that have to be framed again
+    DirtyRegion m_changed_tiles;
+    DirtyRegion m_changed_walls;
+    DirtyRegion m_changed_liquids;
+    DirtyRegion m_framing_region;
+    DirtyRegion m_wall_framing_region;
+
+    // Every chunk that has changed since we last published, and which layers of it did
+    Vector<size_t> m_unpublished_chunks;
+    Vector<u8> m_unpublished_layers;
+
+    SPSCQueue<EditCommand, 4096> m_commands;
+    SPSCQueue<Vector<PublishedChunk>, 4096> m_published_chunks;
+    SPSCQueue<String, 16> m_script_outputs;
+    Atomic<size_t> m_resident_chunk_count{0};
+
+    // Released once for every command submitted, and once more when we're asked to compress or exit
+    std::counting_semaphore<> m_wake_up{0};
+    Atomic<bool> m_compress_requested{false};
+    Atomic<bool> m_exit_requested{false};
+    std::thread m_thread;
+};
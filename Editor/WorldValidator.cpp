@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/QuickSort.h>
+#include <Editor/ObjectRecognizer.h>
+#include <Editor/WorldValidator.h>
+#include <LibTerraria/Model.h>
+
+WorldValidator::WorldValidator(Terraria::World& world, const ChunkedTileMap& tiles, WorldThread& world_thread)
+        : m_tiles(tiles),
+          m_world_thread(world_thread)
+{
+    for (auto& kv : world.chests())
+        m_chest_positions.append({kv.value.position().x(), kv.value.position().y()});
+
+    for (auto& kv : world.signs())
+        m_sign_positions.append({kv.value.position().x(), kv.value.position().y()});
+
+    m_thread = std::thread([this] { run(); });
+}
+
+WorldValidator::~WorldValidator()
+{
+    m_cancel_requested.store(true);
+    m_thread.join();
+}
+
+void WorldValidator::run()
+{
+    // The workers are started once, and each grabs the next chunk nobody has taken yet until there are none left.
+    // The tiles are only locked for one chunk at a time, so edits never wait on more than that.
+    auto worker_count = max(std::thread::hardware_concurrency(), 1u);
+    Vector<Vector<Issue>> worker_issues;
+    Vector<size_t> worker_unchecked_tile_counts;
+    worker_issues.resize(worker_count);
+    worker_unchecked_tile_counts.resize(worker_count);
+
+    Atomic<size_t> next_chunk{0};
+    auto work = [&](size_t worker)
+    {
+        while (!m_cancel_requested.load(AK::MemoryOrder::memory_order_relaxed))
+        {
+            auto chunk_index = next_chunk.fetch_add(1);
+            if (chunk_index >= m_tiles.chunk_count())
+                break;
+
+            {
+                auto locker = m_world_thread.lock_tiles();
+                validate_chunk(chunk_index, worker_issues[worker], worker_unchecked_tile_counts[worker]);
+            }
+
+            m_chunks_validated.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+        }
+    };
+
+    Vector<std::thread> workers;
+    for (size_t worker = 1; worker < worker_count; worker++)
+        workers.append(std::thread(work, worker));
+
+    work(0);
+
+    for (auto& worker : workers)
+        worker.join();
+
+    if (m_cancel_requested.load())
+        return;
+
+    Vector<Issue> issues;
+    {
+        auto locker = m_world_thread.lock_tiles();
+        for (auto& position : m_chest_positions)
+            validate_position(position, "Chest", issues);
+
+        for (auto& position : m_sign_positions)
+            validate_position(position, "Sign", issues);
+    }
+
+    for (size_t worker = 0; worker < worker_count; worker++)
+    {
+        issues.extend(move(worker_issues[worker]));
+        m_unchecked_tile_count += worker_unchecked_tile_counts[worker];
+    }
+
+    quick_sort(issues, [](auto& a, auto& b)
+    {
+        if (a.y != b.y)
+            return a.y < b.y;
+        if (a.x != b.x)
+            return a.x < b.x;
+        return a.description < b.description;
+    });
+
+    // Every tile of a broken object reports the same thing at the object's top left, so only keep one of those.
+    // Anything else reported at the same position (like a chest on that object) is kept.
+    for (auto& issue : issues)
+    {
+        if (!m_issues.is_empty() && m_issues.last().x == issue.x && m_issues.last().y == issue.y &&
+            m_issues.last().description == issue.description)
+        {
+            continue;
+        }
+
+        m_issues.append(move(issue));
+    }
+
+    m_finished.store(true, AK::MemoryOrder::memory_order_release);
+}
+
+static bool is_same_frame(const Optional<i16>& a, const Optional<i16>& b)
+{
+    if (!a.has_value() || !b.has_value())
+        return a.has_value() == b.has_value();
+
+    return *a == *b;
+}
+
+void WorldValidator::validate_chunk(size_t chunk_index, Vector<Issue>& issues, size_t& unchecked_tile_count) const
+{
+    m_tiles.for_each_tile_in_chunk(chunk_index, [&](auto x, auto y, auto& tile)
+    {
+        if (!tile.block().has_value())
+            return;
+
+        auto id = tile.block()->id();
+        auto& tile_model = Terraria::s_tiles[static_cast<int>(id)];
+        if (!tile_model.frame_important)
+            return;
+
+        if (Object::objects_for_block(id).is_empty())
+        {
+            unchecked_tile_count++;
+            return;
+        }
+
+        // Objects.txt doesn't know every frame the game uses, so a frame it has never heard of isn't necessarily wrong
+        auto recognized_object = ObjectRecognizer::recognize(x, y, tile);
+        if (!recognized_object.has_value())
+        {
+            unchecked_tile_count++;
+            return;
+        }
+
+        // Now make sure the rest of the object is there too, which may well be in another chunk
+        auto& object = *recognized_object->object;
+        for (auto object_x = 0; object_x < object.width(); object_x++)
+        {
+            for (auto object_y = 0; object_y < object.height(); object_y++)
+            {
+                auto tile_x = recognized_object->origin_x + object_x;
+                auto tile_y = recognized_object->origin_y + object_y;
+                auto expected_tile = object.tile_for_style(object_x, object_y, recognized_object->style_x,
+                                                           recognized_object->style_y);
+
+                auto broken = !m_tiles.contains(tile_x, tile_y);
+                if (!broken)
+                {
+                    auto actual_tile = m_tiles.tile_at(tile_x, tile_y);
+                    broken = !actual_tile.block().has_value() || actual_tile.block()->id() != id;
+
+                    // Same goes for the other parts, a part is only misframed if it looks like some other object
+                    // (or some other part of this one)
+                    if (!broken &&
+                        (!is_same_frame(actual_tile.block()->frame_x(), expected_tile.block()->frame_x()) ||
+                         !is_same_frame(actual_tile.block()->frame_y(), expected_tile.block()->frame_y())))
+                    {
+                        if (!ObjectRecognizer::recognize(tile_x, tile_y, actual_tile).has_value())
+                        {
+                            unchecked_tile_count++;
+                            return;
+                        }
+                        broken = true;
+                    }
+                }
+
+                if (broken)
+                {
+                    issues.append({recognized_object->origin_x, recognized_object->origin_y,
+                                   String::formatted("{} is missing or has a misframed part at {}, {}",
+                                                     object.name(), tile_x, tile_y)});
+                    return;
+                }
+            }
+        }
+    });
+}
+
+void WorldValidator::validate_position(const Position& position, const char* what, Vector<Issue>& issues) const
+{
+    if (!m_tiles.contains(position.x, position.y))
+    {
+        issues.append({position.x, position.y, String::formatted("{} is outside of the world", what)});
+        return;
+    }
+
+    auto tile = m_tiles.tile_at(position.x, position.y);
+    if (!tile.block().has_value() || !Terraria::s_tiles[static_cast<int>(tile.block()->id())].frame_important)
+    {
+        issues.append({position.x, position.y, String::formatted("{} isn't on an object", what)});
+        return;
+    }
+
+    // The game keeps chests and signs at the top left of their object
+    auto recognized_object = ObjectRecognizer::recognize(position.x, position.y, tile);
+    if (recognized_object.has_value() &&
+        (recognized_object->origin_x != position.x || recognized_object->origin_y != position.y))
+    {
+        issues.append({position.x, position.y, String::formatted("{} isn't at the top left of its {}", what,
+                                                                 recognized_object->object->name())});
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <Editor/ChunkedTileMap.h>
+#include <Editor/WorldThread.h>
+#include <LibTerraria/World.h>
+#include <thread>
+
+// Looks for things the game would reject (or "fix" on load) in the background: frame important blocks that aren't
+// framed like any object we know of, objects with missing or misframed parts, and chests and signs that aren't
+// sitting on an object.
+class WorldValidator
+{
+public:
+    struct Issue
+    {
+        int x;
+        int y;
+        String description;
+    };
+
+    // Chest and sign positions are copied out of the world here, so the world itself is never touched again. The tiles
+    // have to be the world thread's own (see WorldThread::tiles()), which we only read with them locked.
+    WorldValidator(Terraria::World&, const ChunkedTileMap&, WorldThread&);
+
+    // Stops validating early if we haven't finished yet
+    ~WorldValidator();
+
+    bool is_finished() const
+    { return m_finished.load(AK::MemoryOrder::memory_order_acquire); }
+
+    size_t chunks_validated() const
+    { return m_chunks_validated.load(AK::MemoryOrder::memory_order_relaxed); }
+
+    size_t chunk_count() const
+    { return m_tiles.chunk_count(); }
+
+    // Only call these once is_finished() is true. Issues are sorted top to bottom, left to right.
+    const Vector<Issue>& issues() const
+    { return m_issues; }
+
+    // Frame important tiles of blocks (or in frames) that Objects.txt doesn't have anything for, which we can't say
+    // anything about
+    size_t unchecked_tile_count() const
+    { return m_unchecked_tile_count; }
+
+private:
+    struct Position
+    {
+        int x;
+        int y;
+    };
+
+    void run();
+
+    void validate_chunk(size_t chunk_index, Vector<Issue>&, size_t& unchecked_tile_count) const;
+
+    void validate_position(const Position&, const char* what, Vector<Issue>&) const;
+
+    const ChunkedTileMap& m_tiles;
+    WorldThread& m_world_thread;
+
+    Vector<Position> m_chest_positions;
+    Vector<Position> m_sign_positions;
+
+    Vector<Issue> m_issues;
+    size_t m_unchecked_tile_count{};
+
+    Atomic<size_t> m_chunks_validated{0};
+    Atomic<bool> m_cancel_requested{false};
+    Atomic<bool> m_finished{false};
+    std::thread m_thread;
+};
@@ -5,32 +5,386 @@
  */
 
 #include <AK/Format.h>
+#include <AK/LexicalPath.h>
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include <imgui/imgui.h>
 #include <imgui/backends/imgui_impl_sdl.h>
-#include <imgui/backends/imgui_impl_opengl3.h>
 #include <Editor/Application.h>
+#include <Editor/Benchmark.h>
+#include <Editor/InputRecording.h>
+#include <Editor/RenderThread.h>
+#include <Editor/ScriptEngine.h>
+#include <Editor/WorldDiff.h>
+#include <Editor/WorldExporter.h>
+#include <Editor/WorldGenerator.h>
+#include <Editor/WorldLoader.h>
 #include <LibTerraria/World.h>
 #include <AK/MemoryStream.h>
 #include <LibCore/File.h>
 #include <LibCore/ArgsParser.h>
 #include <nfd.h>
+#include <chrono>
+#include <zlib.h>
 
 constexpr bool show_metrics_window = false;
 Application* s_application;
 
+// Recordings only play back the same way on the world they were recorded on, this is how we tell
+static Optional<u32> checksum_file(const String& path)
+{
+    auto file_or_error = Core::File::open(path, Core::OpenMode::ReadOnly);
+    if (file_or_error.is_error())
+        return {};
+
+    auto contents = file_or_error.value()->read_all();
+    return static_cast<u32>(crc32(crc32(0, nullptr, 0), contents.data(), contents.size()));
+}
+
 int main(int argc, char** argv)
 {
     Core::ArgsParser args_parser;
 
     String world_path;
+    String export_path;
+    String export_region;
+    int export_tile_size = 16;
+    bool export_without_wires = false;
+    String diff_path;
+    String patch_path;
+    String generate_size;
+    int generate_seed = 0;
+    String generate_blocks;
+    int generate_wire_density = 5;
+    int generate_objects = 0;
+    bool benchmark = false;
+    String script_path;
+    String record_path;
+    String replay_path;
+    bool replay_offscreen = false;
+    String replay_times_path;
 
     args_parser.add_positional_argument(world_path, "Path to the world file", "world", Core::ArgsParser::Required::No);
+    args_parser.add_option(export_path, "Export the world to a PNG and exit, without opening a window", "export", 0,
+                           "path");
+    args_parser.add_option(export_region, "Only export this region of tiles", "export-region", 0, "x,y,width,height");
+    args_parser.add_option(export_tile_size, "Pixels per tile when exporting, from 1 to 16", "export-tile-size", 0,
+                           "size");
+    args_parser.add_option(export_without_wires, "Don't draw wires when exporting", "export-without-wires", 0);
+    args_parser.add_option(diff_path, "Compare the world with another one and exit, without opening a window", "diff",
+                           0, "other world");
+    args_parser.add_option(patch_path, "When comparing (or running a script), write a patch that turns the world into "
+                           "the other one (or the one the script made)", "write-patch", 0, "path");
+    args_parser.add_option(generate_size, "Generate a world instead of opening one, to export or benchmark",
+                           "generate", 0, "widthxheight");
+    args_parser.add_option(generate_seed, "Seed for the generator, the same seed always gives the same world", "seed",
+                           0, "seed");
+    args_parser.add_option(generate_blocks, "What the generated ground is made of", "generate-blocks", 0,
+                           "block:weight,...");
+    args_parser.add_option(generate_wire_density, "How many tiles in a thousand get a wire", "generate-wire-density",
+                           0, "tiles");
+    args_parser.add_option(generate_objects, "How many objects to place in the generated world", "generate-objects",
+                           0, "count");
+    args_parser.add_option(benchmark, "Time how long the editor takes to work on the whole world, then exit",
+                           "benchmark", 0);
+    args_parser.add_option(script_path, "Run a Lua script on the world without opening a window, then export it or "
+                           "write a patch if asked to", "script", 0, "path");
+    args_parser.add_option(record_path, "Record everything the mouse and keyboard do, to replay later", "record", 0,
+                           "path");
+    args_parser.add_option(replay_path, "Replay a recording as fast as we can draw it, then print how long every "
+                           "frame took and exit", "replay", 0, "path");
+    args_parser.add_option(replay_offscreen, "Replay without showing a window at all", "replay-offscreen", 0);
+    args_parser.add_option(replay_times_path, "Write how long every replayed frame took to a CSV file",
+                           "replay-times", 0, "path");
 
     if (!args_parser.parse(argc, argv))
         return 1;
 
+    RefPtr<Terraria::World> world;
+
+    if (!world_path.is_null())
+    {
+        auto world_or_error = WorldLoader::load(world_path);
+        if (world_or_error.is_error())
+        {
+            warnln("{}", world_or_error.error());
+            return 2;
+        }
+
+        world = world_or_error.release_value();
+    }
+
+    // Tiles for the headless commands to use instead of the world's own, like a generated world's
+    OwnPtr<ChunkedTileMap> headless_tiles;
+    if (!generate_size.is_null())
+    {
+        if (world)
+        {
+            warnln("Either open a world or generate one, not both");
+            return 1;
+        }
+
+        auto size = generate_size.split('x');
+        Optional<int> width;
+        Optional<int> height;
+        if (size.size() == 2)
+        {
+            width = size[0].to_int();
+            height = size[1].to_int();
+        }
+
+        if (!width.has_value() || !height.has_value() || *width <= 0 || *height <= 0 || *width > 65535 ||
+            *height > 65535)
+        {
+            warnln("Generated world size should look like 8400x2400, not {}", generate_size);
+            return 1;
+        }
+
+        WorldGenerator::Settings settings;
+        settings.width = *width;
+        settings.height = *height;
+        settings.seed = static_cast<u64>(generate_seed);
+        settings.wired_tiles_per_thousand = max(generate_wire_density, 0);
+        settings.object_count = max(generate_objects, 0);
+
+        if (!generate_blocks.is_null())
+        {
+            auto blocks_or_error = WorldGenerator::parse_blocks(generate_blocks);
+            if (blocks_or_error.is_error())
+            {
+                warnln("{}", blocks_or_error.error());
+                return 1;
+            }
+            settings.blocks = blocks_or_error.release_value();
+        }
+
+        if (settings.object_count > 0 && !Object::load_all_objects("Objects.txt"))
+            return 2;
+
+        auto start = std::chrono::steady_clock::now();
+        WorldGenerator generator(move(settings));
+        headless_tiles = generator.generate();
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+        outln("Generated a {}x{} world with {} objects in {:.2} s", *width, *height,
+              generator.placed_object_count(), elapsed.count());
+
+        // We have no way to save worlds yet, so there's nothing else to do with one
+        if (export_path.is_null() && !benchmark)
+        {
+            warnln("A generated world can only be exported or benchmarked");
+            return 1;
+        }
+    }
+
+    if (!script_path.is_null())
+    {
+        if (!world)
+        {
+            warnln("Running a script needs a world to run it on");
+            return 1;
+        }
+
+        // Placing objects is the only thing that needs them, so a script can still run without the catalog
+        if (!Object::load_all_objects("Objects.txt"))
+            warnln("Scripts won't be able to place any objects");
+
+        auto tiles = ChunkedTileMap::create_from_world(*world);
+        ScriptEngine engine(*world, *tiles);
+        auto start = std::chrono::steady_clock::now();
+        if (!engine.run_file(script_path))
+            return 5;
+
+        engine.frame_changes();
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+        outln("Ran {} in {:.2} s", script_path, elapsed.count());
+
+        // We can't save worlds yet, but we can save what the script did to one
+        if (!patch_path.is_null())
+        {
+            auto base_world_or_error = WorldLoader::load(world_path);
+            if (base_world_or_error.is_error())
+            {
+                warnln("{}", base_world_or_error.error());
+                return 2;
+            }
+
+            auto base_world = base_world_or_error.release_value();
+            auto base_tiles = ChunkedTileMap::create_from_world(*base_world);
+            // Scripts can't touch walls or liquids, so both worlds have the same ones
+            auto walls = WallLayer::create_from_world(*base_world);
+            auto liquids = LiquidLayer::create_from_world(*base_world);
+            auto diff_or_error = WorldDiff::compute(*base_world, *base_tiles, *walls, *liquids, *world, *tiles, *walls,
+                                                    *liquids);
+            if (diff_or_error.is_error())
+            {
+                warnln("Failed to compare worlds: {}", diff_or_error.error());
+                return 5;
+            }
+
+            if (!diff_or_error.value().save_patch(patch_path))
+                return 5;
+        }
+
+        headless_tiles = move(tiles);
+        if (export_path.is_null() && !benchmark)
+            return 0;
+    }
+
+    // Headless commands work on the world we opened, the one we generated, or the one a script changed
+    auto take_tiles = [&]() -> NonnullOwnPtr<ChunkedTileMap>
+    {
+        if (headless_tiles)
+            return headless_tiles.release_nonnull();
+
+        return ChunkedTileMap::create_from_world(*world);
+    };
+
+    if (benchmark)
+    {
+        if (!world && !headless_tiles)
+        {
+            warnln("Benchmarking needs a world, or a generated one");
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        OwnPtr<ChunkedTileMap> tiles = take_tiles();
+        if (world)
+        {
+            auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+            outln("Building the tile map: {:.1} ms", elapsed.count());
+        }
+
+        Benchmark::run(*tiles);
+
+        // Which is what closing a tab has to wait for
+        start = std::chrono::steady_clock::now();
+        tiles = nullptr;
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+        outln("Freeing the tile map: {:.1} ms", elapsed.count());
+        return 0;
+    }
+
+    if (!export_path.is_null())
+    {
+        if (!world && !headless_tiles)
+        {
+            warnln("Exporting needs a world to export");
+            return 1;
+        }
+
+        auto tiles = take_tiles();
+        WorldExporter::Region region{0, 0, tiles->width(), tiles->height()};
+        if (!export_region.is_null())
+        {
+            auto parts = export_region.split(',');
+            Vector<int> values;
+            for (auto& part : parts)
+            {
+                auto value = part.to_int();
+                if (!value.has_value())
+                    break;
+                values.append(*value);
+            }
+
+            if (values.size() != 4)
+            {
+                warnln("Export region should look like x,y,width,height, not {}", export_region);
+                return 1;
+            }
+
+            region = {values[0], values[1], values[2], values[3]};
+        }
+
+        // Generated worlds don't have any walls or liquids
+        OwnPtr<WallLayer> walls;
+        OwnPtr<LiquidLayer> liquids;
+        if (world)
+        {
+            walls = WallLayer::create_from_world(*world);
+            liquids = LiquidLayer::create_from_world(*world);
+        }
+
+        WorldExporter exporter(*tiles, walls.ptr(), liquids.ptr(), region, export_tile_size, !export_without_wires);
+        return exporter.export_png(export_path) ? 0 : 5;
+    }
+
+    if (!diff_path.is_null())
+    {
+        if (!world)
+        {
+            warnln("Comparing needs a world to compare with");
+            return 1;
+        }
+
+        auto other_world_or_error = WorldLoader::load(diff_path);
+        if (other_world_or_error.is_error())
+        {
+            warnln("{}", other_world_or_error.error());
+            return 2;
+        }
+
+        auto other_world = other_world_or_error.release_value();
+        auto tiles = ChunkedTileMap::create_from_world(*world);
+        auto walls = WallLayer::create_from_world(*world);
+        auto liquids = LiquidLayer::create_from_world(*world);
+        auto other_tiles = ChunkedTileMap::create_from_world(*other_world);
+        auto other_walls = WallLayer::create_from_world(*other_world);
+        auto other_liquids = LiquidLayer::create_from_world(*other_world);
+        auto diff_or_error = WorldDiff::compute(*world, *tiles, *walls, *liquids, *other_world, *other_tiles,
+                                                *other_walls, *other_liquids);
+        if (diff_or_error.is_error())
+        {
+            warnln("Failed to compare worlds: {}", diff_or_error.error());
+            return 5;
+        }
+
+        auto& diff = diff_or_error.value();
+        outln("{} tiles changed, in {} chunks", diff.tile_changes().size(), diff.changed_chunk_count());
+        outln("{} walls changed", diff.wall_changes().size());
+        outln("{} liquids changed", diff.liquid_changes().size());
+        outln("{} chests changed", diff.chest_changes().size());
+        outln("{} signs changed", diff.sign_changes().size());
+
+        if (!patch_path.is_null() && !diff.save_patch(patch_path))
+            return 5;
+
+        return 0;
+    }
+
+    if (!record_path.is_null() && !replay_path.is_null())
+    {
+        warnln("Either record or replay, not both");
+        return 1;
+    }
+
+    Optional<u32> world_checksum;
+    if (world && (!record_path.is_null() || !replay_path.is_null()))
+        world_checksum = checksum_file(world_path);
+
+    OwnPtr<InputPlayer> player;
+    if (!replay_path.is_null())
+    {
+        auto player_or_error = InputPlayer::load(replay_path);
+        if (player_or_error.is_error())
+        {
+            warnln("{}", player_or_error.error());
+            return 2;
+        }
+
+        player = player_or_error.release_value();
+
+        // It'll still replay, it just probably won't do what it did when it was recorded
+        auto recorded_checksum = player->world_checksum();
+        if (recorded_checksum.has_value() != world_checksum.has_value() ||
+            (recorded_checksum.has_value() && *recorded_checksum != *world_checksum))
+            warnln("This isn't the world the recording was made with, so it might not replay the same way");
+
+        // The offscreen driver needs no display, so replays can run on a machine without one
+        if (replay_offscreen)
+            SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER) < 0)
     {
         warnln("Failed to initialize SDL: {}", SDL_GetError());
@@ -58,12 +412,17 @@ int main(int argc, char** argv)
     SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
     SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 
-    constexpr auto window_flags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI;
-    auto* window = SDL_CreateWindow("Tadapt", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, window_flags);
+    // A replay starts with the window the recording did, so everything is in the same place
+    u32 window_flags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI;
+    if (player && replay_offscreen)
+        window_flags |= SDL_WINDOW_HIDDEN;
+    auto window_width = player ? player->window_width() : 1280;
+    auto window_height = player ? player->window_height() : 720;
+    auto* window = SDL_CreateWindow("Tadapt", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, window_width,
+                                    window_height, window_flags);
 
     auto gl_context = SDL_GL_CreateContext(window);
     SDL_GL_MakeCurrent(window, gl_context);
-    SDL_GL_SetSwapInterval(1); // Enable vsync
 
     auto glew_init_return = glewInit();
     if (glew_init_return != GLEW_OK)
@@ -72,39 +431,15 @@ int main(int argc, char** argv)
         return 2;
     }
 
-    RefPtr<Terraria::World> world;
-
-    if (!world_path.is_null())
-    {
-        auto file_or_error = Core::File::open(world_path, Core::OpenMode::ReadOnly);
-
-        if (file_or_error.is_error())
-        {
-            warnln("Failed to open world file: {}", file_or_error.error());
-            return 2;
-        }
-
-        auto file_bytes = file_or_error.value()->read_all();
-        auto bytes_stream = InputMemoryStream(file_bytes);
-
-        auto world_or_error = Terraria::World::try_load_world(bytes_stream);
-
-        if (world_or_error.is_error())
-        {
-            warnln("Failed to load world file: {}", world_or_error.error());
-            return 3;
-        }
-
-        world = world_or_error.release_value();
-    }
-
     if (NFD_Init() != NFD_OKAY)
     {
         warnln("Failed to initialize NFD");
         return 4;
     }
 
-    s_application = new Application(world);
+    s_application = new Application();
+    if (world)
+        s_application->open_world(world.release_nonnull(), LexicalPath(world_path).title());
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -112,27 +447,77 @@ int main(int argc, char** argv)
     ImGui::StyleColorsDark();
 
     ImGui_ImplSDL2_InitForOpenGL(window, gl_context);
-    ImGui_ImplOpenGL3_Init(glsl_version);
 
-    bool exit_requested;
+    OwnPtr<InputRecorder> recorder;
+    if (!record_path.is_null())
+    {
+        int width;
+        int height;
+        SDL_GetWindowSize(window, &width, &height);
+        auto recorder_or_error = InputRecorder::create(record_path, world_checksum, width, height);
+        if (recorder_or_error.is_error())
+        {
+            warnln("{}", recorder_or_error.error());
+            return 2;
+        }
+
+        recorder = recorder_or_error.release_value();
+    }
+
+    if (player)
+        player->set_window_id(SDL_GetWindowID(window));
+
+    // From here on the context belongs to the render thread, which sets up ImGui's OpenGL backend itself
+    SDL_GL_MakeCurrent(window, nullptr);
+
+    // Vsync is on, unless we're replaying, where we want to know how long frames really take (GPU and all) rather
+    // than wait for the screen
+    auto is_replaying = !player.is_null();
+    RenderThread render_thread(window, gl_context, glsl_version, !is_replaying, is_replaying);
+    s_application->set_render_thread(render_thread);
+
+    bool exit_requested = false;
+    auto process_event = [&](SDL_Event& event)
+    {
+        ImGui_ImplSDL2_ProcessEvent(&event);
+        s_application->process_event(&event);
+
+        if (event.type == SDL_QUIT)
+            exit_requested = true;
+    };
+
     SDL_Event event;
 
     while (!exit_requested)
     {
+        auto frame_start = std::chrono::steady_clock::now();
         while (SDL_PollEvent(&event) != 0)
         {
-            ImGui_ImplSDL2_ProcessEvent(&event);
-            s_application->process_event(&event);
-
-            if (event.type == SDL_QUIT)
+            // While replaying, the only thing we listen to is being asked to stop
+            if (player)
             {
-                exit_requested = true;
-                break;
+                if (event.type == SDL_QUIT)
+                    exit_requested = true;
+                continue;
             }
+
+            if (recorder)
+                recorder->record(event);
+
+            process_event(event);
+            if (exit_requested)
+                break;
         }
 
-        ImGui_ImplOpenGL3_NewFrame();
+        if (player && !exit_requested && !player->play_frame(process_event))
+            break;
+
+        if (recorder)
+            recorder->end_frame();
+
         ImGui_ImplSDL2_NewFrame();
+        if (player)
+            player->override_imgui_input(io);
         ImGui::NewFrame();
 
         if (show_metrics_window)
@@ -141,12 +526,22 @@ int main(int argc, char** argv)
         s_application->draw();
 
         ImGui::Render();
-        glViewport(0, 0, (int) io.DisplaySize.x, (int) io.DisplaySize.y);
-        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        render_thread.submit_frame(ImGui::GetDrawData());
 
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        SDL_GL_SwapWindow(window);
+        if (player)
+        {
+            // Make sure the GPU's part of the frame counts too
+            render_thread.wait_until_idle();
+            auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start);
+            player->add_frame_time(elapsed.count());
+        }
+    }
+
+    if (player)
+    {
+        player->print_frame_times();
+        if (!replay_times_path.is_null() && !player->save_frame_times(replay_times_path))
+            return 5;
     }
 
     // TODO: cleanup